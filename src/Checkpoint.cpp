@@ -0,0 +1,138 @@
+#include "Checkpoint.h"
+#include "log.h"
+#include <string.h>
+
+CheckpointWriter::CheckpointWriter(std::ostream &out) : out_(out)
+{
+
+}
+
+void CheckpointWriter::writeString(const std::string &value)
+{
+    writeVector(std::vector<char>(value.begin(), value.end()));
+}
+
+void CheckpointWriter::writeTag(const std::string &tag)
+{
+    writeString(tag);
+}
+
+void CheckpointWriter::writeRand(const RandomStream &rand)
+{
+    // the stream holds no pointers, so its state is its bytes
+    write(rand);
+}
+
+void CheckpointWriter::writeRng(const gsl_rng * rng)
+{
+    writeString(gsl_rng_name(rng));
+
+    const char * state = (const char *)gsl_rng_state(rng);
+
+    writeVector(std::vector<char>(state, state + gsl_rng_size(rng)));
+}
+
+bool CheckpointWriter::good() const
+{
+    return out_.good();
+}
+
+CheckpointReader::CheckpointReader(std::istream &in) : in_(in)
+{
+    end_ = std::streampos(-1);
+}
+
+bool CheckpointReader::readString(std::string &value)
+{
+    std::vector<char> characters;
+
+    if(readVector(characters) != true)
+    {
+        return false;
+    }
+
+    value.assign(characters.begin(), characters.end());
+
+    return true;
+}
+
+bool CheckpointReader::readTag(const std::string &tag)
+{
+    std::string value;
+
+    if(readString(value) != true || value != tag)
+    {
+        put_flog(LOG_ERROR, "expected %s in checkpoint", tag.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool CheckpointReader::readRand(RandomStream &rand)
+{
+    return read(rand);
+}
+
+bool CheckpointReader::readRng(gsl_rng * rng)
+{
+    std::string name;
+    std::vector<char> state;
+
+    if(readString(name) != true || readVector(state) != true)
+    {
+        return false;
+    }
+
+    if(name != gsl_rng_name(rng) || state.size() != gsl_rng_size(rng))
+    {
+        put_flog(LOG_ERROR, "checkpoint has a %s generator, expected %s", name.c_str(), gsl_rng_name(rng));
+        return false;
+    }
+
+    if(state.size() > 0)
+    {
+        memcpy(gsl_rng_state(rng), &state[0], state.size());
+    }
+
+    return true;
+}
+
+bool CheckpointReader::checkSize(boost::uint64_t size, size_t valueSize)
+{
+    std::streampos position = in_.tellg();
+
+    if(position == std::streampos(-1) || (end_ == std::streampos(-1) && findEnd() != true))
+    {
+        put_flog(LOG_ERROR, "could not find the size of the checkpoint");
+        return false;
+    }
+
+    // the stream may have been written to since the end was found
+    if(position > end_ || size > (boost::uint64_t)(end_ - position) / valueSize)
+    {
+        if(findEnd() != true || position > end_ || size > (boost::uint64_t)(end_ - position) / valueSize)
+        {
+            put_flog(LOG_ERROR, "size %llu is more than the rest of the checkpoint", (unsigned long long)size);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool CheckpointReader::good() const
+{
+    return in_.good();
+}
+
+bool CheckpointReader::findEnd()
+{
+    std::streampos position = in_.tellg();
+
+    in_.seekg(0, std::ios::end);
+    end_ = in_.tellg();
+    in_.seekg(position);
+
+    return end_ != std::streampos(-1) && in_.good();
+}
@@ -0,0 +1,124 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "models/RandomStream.h"
+#include <string>
+#include <vector>
+#include <iostream>
+#include <boost/cstdint.hpp>
+#include <gsl/gsl_rng.h>
+
+// binary streams for simulation checkpoints (see EpidemicSimulation::saveCheckpoint())
+// values are written in native byte order with no padding between them, so a checkpoint is restored
+// on the kind of machine that wrote it. the state of each object starts with a tag, so a checkpoint
+// from a different model or version is rejected instead of being misread
+
+class CheckpointWriter
+{
+    public:
+
+        CheckpointWriter(std::ostream &out);
+
+        // plain values, and vectors of them
+        template <class T> void write(const T &value)
+        {
+            out_.write((const char *)&value, sizeof(T));
+        }
+
+        template <class T> void writeVector(const std::vector<T> &values)
+        {
+            write((boost::uint64_t)values.size());
+
+            if(values.size() > 0)
+            {
+                out_.write((const char *)&values[0], values.size() * sizeof(T));
+            }
+        }
+
+        template <class T> void writeArray(const T * values, size_t size)
+        {
+            out_.write((const char *)values, size * sizeof(T));
+        }
+
+        void writeString(const std::string &value);
+        void writeTag(const std::string &tag);
+
+        // random number generator states
+        void writeRand(const RandomStream &rand);
+        void writeRng(const gsl_rng * rng);
+
+        bool good() const;
+
+    private:
+
+        std::ostream &out_;
+};
+
+class CheckpointReader
+{
+    public:
+
+        CheckpointReader(std::istream &in);
+
+        template <class T> bool read(T &value)
+        {
+            in_.read((char *)&value, sizeof(T));
+
+            return in_.good();
+        }
+
+        template <class T> bool readVector(std::vector<T> &values)
+        {
+            boost::uint64_t size;
+
+            if(read(size) != true || checkSize(size, sizeof(T)) != true)
+            {
+                return false;
+            }
+
+            values.resize((size_t)size);
+
+            if(size > 0)
+            {
+                in_.read((char *)&values[0], values.size() * sizeof(T));
+            }
+
+            return in_.good();
+        }
+
+        // a known number of values
+        template <class T> bool readArray(T * values, size_t size)
+        {
+            in_.read((char *)values, size * sizeof(T));
+
+            return in_.good();
+        }
+
+        bool readString(std::string &value);
+
+        // returns false if the next tag is not the given tag
+        bool readTag(const std::string &tag);
+
+        bool readRand(RandomStream &rand);
+
+        // rng must be of the same type as the generator that was written
+        bool readRng(gsl_rng * rng);
+
+        // whether <size> values of <valueSize> bytes can be in the rest of the stream
+        // sizes read from a checkpoint are checked before allocating for them, so a corrupt checkpoint fails instead of exhausting memory
+        bool checkSize(boost::uint64_t size, size_t valueSize);
+
+        bool good() const;
+
+    private:
+
+        std::istream &in_;
+
+        // end of the stream, found on the first checkSize() and again if the stream has grown
+        std::streampos end_;
+
+        // find end_; returns false if the stream can't seek
+        bool findEnd();
+};
+
+#endif
@@ -0,0 +1,64 @@
+#include "EpidemicBinaryOutputSink.h"
+#include <boost/cstdint.hpp>
+
+EpidemicBinaryOutputSink::EpidemicBinaryOutputSink(const std::string &varName, const std::string &filename) : EpidemicOutputSink(varName, filename)
+{
+
+}
+
+EpidemicBinaryOutputSink::~EpidemicBinaryOutputSink()
+{
+    close();
+}
+
+bool EpidemicBinaryOutputSink::writeHeader()
+{
+    out_.write("EPIOUT01", 8);
+
+    writeString(getVariableName());
+
+    writeInt((int)nodeIds_.size());
+
+    for(unsigned int i=0; i<nodeIds_.size(); i++)
+    {
+        writeInt(nodeIds_[i]);
+    }
+
+    for(unsigned int i=0; i<stratifications_.size(); i++)
+    {
+        writeInt((int)stratifications_[i].size());
+
+        for(unsigned int j=0; j<stratifications_[i].size(); j++)
+        {
+            writeString(stratifications_[i][j]);
+        }
+    }
+
+    return out_.good();
+}
+
+bool EpidemicBinaryOutputSink::writeTime(int time, const std::vector<float> &values)
+{
+    writeInt(time);
+
+    if(values.size() > 0)
+    {
+        out_.write((const char *)&values[0], values.size() * sizeof(float));
+    }
+
+    return out_.good();
+}
+
+void EpidemicBinaryOutputSink::writeInt(int value)
+{
+    boost::int32_t value32 = (boost::int32_t)value;
+
+    out_.write((const char *)&value32, sizeof(value32));
+}
+
+void EpidemicBinaryOutputSink::writeString(const std::string &value)
+{
+    writeInt((int)value.size());
+
+    out_.write(value.c_str(), value.size());
+}
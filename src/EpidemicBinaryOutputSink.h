@@ -0,0 +1,32 @@
+#ifndef EPIDEMIC_BINARY_OUTPUT_SINK_H
+#define EPIDEMIC_BINARY_OUTPUT_SINK_H
+
+#include "EpidemicOutputSink.h"
+
+// binary output, in native byte order
+// header:
+//   char[8] magic "EPIOUT01"
+//   int32 length and characters of the variable name
+//   int32 number of nodes, int32 node id for each node
+//   for each of the two stratifications: int32 number of values, then int32 length and characters of each value name
+// followed by a record for each time:
+//   int32 time, float32 values [stratification 0][stratification 1][node index]
+class EpidemicBinaryOutputSink : public EpidemicOutputSink
+{
+    public:
+
+        EpidemicBinaryOutputSink(const std::string &varName, const std::string &filename);
+        ~EpidemicBinaryOutputSink();
+
+    protected:
+
+        bool writeHeader();
+        bool writeTime(int time, const std::vector<float> &values);
+
+    private:
+
+        void writeInt(int value);
+        void writeString(const std::string &value);
+};
+
+#endif
@@ -0,0 +1,86 @@
+#include "EpidemicCases.h"
+#include "EpidemicDataSet.h"
+#include "log.h"
+#include <QtXmlPatterns>
+
+EpidemicCases::EpidemicCases()
+{
+    // defaults
+    num = 0;
+    nodeId = 0;
+
+    // default to second age group (first stratification); all other stratification values are zero
+    stratificationValues = std::vector<int>(NUM_STRATIFICATION_DIMENSIONS, 0);
+    stratificationValues[0] = 1;
+}
+
+std::vector<EpidemicCases> getDefaultEpidemicCases()
+{
+    int defaultNumCases = 10000;
+    std::vector<int> defaultNodeIds;
+
+    defaultNodeIds.push_back(453);
+    defaultNodeIds.push_back(113);
+    defaultNodeIds.push_back(201);
+    defaultNodeIds.push_back(141);
+    defaultNodeIds.push_back(375);
+
+    std::vector<EpidemicCases> casesVector;
+
+    for(unsigned int i=0; i<defaultNodeIds.size(); i++)
+    {
+        EpidemicCases cases;
+        cases.num = defaultNumCases;
+        cases.nodeId = defaultNodeIds[i];
+
+        casesVector.push_back(cases);
+    }
+
+    return casesVector;
+}
+
+bool loadEpidemicCasesXml(const std::string &filename, std::vector<EpidemicCases> &cases)
+{
+    QXmlQuery query;
+
+    if(query.setFocus(QUrl(filename.c_str())) == false)
+    {
+        put_flog(LOG_ERROR, "failed to load %s", filename.c_str());
+        return false;
+    }
+
+    // temp strings
+    char string[1024];
+    QString qstring;
+
+    // get number of initial cases
+    sprintf(string, "string(count(//cases))");
+    query.setQuery(string);
+    query.evaluateTo(&qstring);
+    int numCases = qstring.toInt();
+
+    put_flog(LOG_INFO, "%i entries", numCases);
+
+    cases.clear();
+
+    for(int i=1; i<=numCases; i++)
+    {
+        EpidemicCases c;
+
+        sprintf(string, "string(//cases[%i]/@num)", i);
+        query.setQuery(string);
+        query.evaluateTo(&qstring);
+        c.num = qstring.toInt();
+
+        sprintf(string, "string(//cases[%i]/@nodeId)", i);
+        query.setQuery(string);
+        query.evaluateTo(&qstring);
+        c.nodeId = qstring.toInt();
+
+        put_flog(LOG_INFO, "%i cases for nodeId %i", c.num, c.nodeId);
+
+        cases.push_back(c);
+    }
+
+    return true;
+}
@@ -0,0 +1,23 @@
+#ifndef EPIDEMIC_CASES_H
+#define EPIDEMIC_CASES_H
+
+#include <string>
+#include <vector>
+
+struct EpidemicCases
+{
+    EpidemicCases();
+
+    int num;
+    int nodeId;
+    std::vector<int> stratificationValues;
+};
+
+// default initial cases for a new simulation
+extern std::vector<EpidemicCases> getDefaultEpidemicCases();
+
+// load initial cases from an XML file; returns false on error
+// this does not require a GUI, so it can be used in batch mode
+extern bool loadEpidemicCasesXml(const std::string &filename, std::vector<EpidemicCases> &cases);
+
+#endif
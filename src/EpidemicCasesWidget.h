@@ -1,18 +1,12 @@
 #ifndef EPIDEMIC_CASES_WIDGET_H
 #define EPIDEMIC_CASES_WIDGET_H
 
+#include "EpidemicCases.h"
 #include <QtGui>
 #include <boost/shared_ptr.hpp>
 
 class EpidemicDataSet;
 
-struct EpidemicCases
-{
-    int num;
-    int nodeId;
-    std::vector<int> stratificationValues;
-};
-
 class EpidemicCasesWidget : public QGroupBox
 {
     public:
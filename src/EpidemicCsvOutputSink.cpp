@@ -0,0 +1,51 @@
+#include "EpidemicCsvOutputSink.h"
+
+EpidemicCsvOutputSink::EpidemicCsvOutputSink(const std::string &varName, const std::string &filename) : EpidemicOutputSink(varName, filename)
+{
+    // set maximum decimal precision
+    out_.precision(16);
+}
+
+EpidemicCsvOutputSink::~EpidemicCsvOutputSink()
+{
+    close();
+}
+
+bool EpidemicCsvOutputSink::writeHeader()
+{
+    out_ << "t,group";
+
+    // header: for each node
+    for(unsigned int i=0; i<nodeIds_.size(); i++)
+    {
+        out_ << "," << nodeIds_[i];
+    }
+
+    out_ << "\n";
+
+    return out_.good();
+}
+
+bool EpidemicCsvOutputSink::writeTime(int time, const std::vector<float> &values)
+{
+    unsigned int index = 0;
+
+    for(unsigned int s0=0; s0<stratifications_[0].size(); s0++)
+    {
+        for(unsigned int s1=0; s1<stratifications_[1].size(); s1++)
+        {
+            // group name
+            out_ << time << "," << stratifications_[0][s0] << " " << stratifications_[1][s1];
+
+            for(unsigned int n=0; n<nodeIds_.size(); n++)
+            {
+                out_ << "," << values[index];
+                index++;
+            }
+
+            out_ << "\n";
+        }
+    }
+
+    return out_.good();
+}
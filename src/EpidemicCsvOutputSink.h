@@ -0,0 +1,21 @@
+#ifndef EPIDEMIC_CSV_OUTPUT_SINK_H
+#define EPIDEMIC_CSV_OUTPUT_SINK_H
+
+#include "EpidemicOutputSink.h"
+
+// CSV output: a header row "t,group,<node ids...>", then a row for each time and
+// (stratification 0, stratification 1) pair, with the group named "<stratification 0> <stratification 1>"
+class EpidemicCsvOutputSink : public EpidemicOutputSink
+{
+    public:
+
+        EpidemicCsvOutputSink(const std::string &varName, const std::string &filename);
+        ~EpidemicCsvOutputSink();
+
+    protected:
+
+        bool writeHeader();
+        bool writeTime(int time, const std::vector<float> &values);
+};
+
+#endif
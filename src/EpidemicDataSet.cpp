@@ -1,57 +1,108 @@
 #include "EpidemicDataSet.h"
+#include "NetCdfVariableStore.h"
+#include "InputBundle.h"
+#include "Checkpoint.h"
 #include "main.h"
 #include "log.h"
 #include <fstream>
+#include <algorithm>
 #include <boost/tokenizer.hpp>
+#include <boost/thread/mutex.hpp>
 
 #if USE_NETCDF
-    #include <netcdfcpp.h>
+    #include <netcdf.h>
 #endif
 
+const size_t EpidemicDataSet::maxCachedBytes_ = 256 << 20;
+
 std::vector<std::string> EpidemicDataSet::stratificationNames_;
 std::vector<std::vector<std::string> > EpidemicDataSet::stratifications_;
 
-EpidemicDataSet::EpidemicDataSet(const char * filename)
+// input data shared by all data sets; see loadInputData()
+struct EpidemicDataSetInputData
 {
-    // defaults
-    isValid_ = false;
-    numTimes_ = 1;
-    numNodes_ = 0;
-
-    // load stratifications data
-    if(loadStratificationsFile() != true)
+    int numNodes;
+    std::vector<int> nodeIds;
+    std::map<int, int> nodeIdToIndex;
+    std::map<int, std::string> nodeIdToName;
+    std::map<int, std::string> nodeIdToGroupName;
+    std::map<std::string, std::vector<int> > groupNameToNodeIds;
+    EpidemicVariable population;
+    boost::shared_ptr<const blitz::Array<float, 2> > travel;
+    boost::shared_ptr<const SparseTravel> sparseTravel;
+};
+
+boost::shared_ptr<EpidemicDataSetInputData> g_inputData;
+boost::mutex g_inputDataMutex;
+
+// input text files in the data directory
+const char * g_nodeNameGroupFilename = "fips_county_names_HSRs.csv";
+const char * g_nodePopulationFilename = "fips_populations_stratified.csv";
+const char * g_nodeTravelFilename = "county_travel_fractions.csv";
+
+namespace
+{
+    // deletes a travel array referencing the data of an input bundle, keeping the bundle mapped until then
+    struct InputBundleTravelDeleter
     {
-        put_flog(LOG_ERROR, "could not load stratifications file");
-        return;
-    }
+        boost::shared_ptr<const InputBundle> bundle;
 
-    // load node name and group data
-    std::string nodeNameGroupFilename = g_dataDirectory + "/fips_county_names_HSRs.csv";
+        void operator()(const blitz::Array<float, 2> * travel)
+        {
+            delete travel;
+        }
+    };
+}
 
-    if(loadNodeNameGroupFile(nodeNameGroupFilename.c_str()) != true)
+#if USE_NETCDF
+// log a NetCDF library error; returns true if there was no error
+static bool netCdfSucceeded(int status)
+{
+    if(status != NC_NOERR)
     {
-        put_flog(LOG_ERROR, "could not load file %s", nodeNameGroupFilename.c_str());
-        return;
+        put_flog(LOG_ERROR, "NetCDF error: %s", nc_strerror(status));
+        return false;
     }
 
-    // population data
-    std::string nodePopulationFilename = g_dataDirectory + "/fips_populations_stratified.csv";
+    return true;
+}
+#endif
 
-    if(loadNodePopulationFile(nodePopulationFilename.c_str()) != true)
+// if stratificationValues only restrict the first two stratifications, the sum is a marginal (see EpidemicVariable)
+// this returns the first two stratification values in that case
+static bool getMarginalStratificationValues(const std::vector<int> &stratificationValues, int &s0, int &s1)
+{
+    for(unsigned int i=2; i<stratificationValues.size(); i++)
     {
-        put_flog(LOG_ERROR, "could not load file %s", nodePopulationFilename.c_str());
-        return;
+        if(stratificationValues[i] != STRATIFICATIONS_ALL)
+        {
+            return false;
+        }
     }
 
-    // travel data
-    std::string nodeTravelFilename = g_dataDirectory + "/county_travel_fractions.csv";
+    s0 = (stratificationValues.size() > 0 ? stratificationValues[0] : STRATIFICATIONS_ALL);
+    s1 = (stratificationValues.size() > 1 ? stratificationValues[1] : STRATIFICATIONS_ALL);
 
-    if(loadNodeTravelFile(nodeTravelFilename.c_str()) != true)
+    return true;
+}
+
+EpidemicDataSet::EpidemicDataSet(const char * filename)
+{
+    // defaults
+    isValid_ = false;
+    numTimes_ = 1;
+    numNodes_ = 0;
+    reservedNumTimes_ = 0;
+
+    // load stratifications, node, population and travel data
+    if(loadInputData() != true)
     {
-        put_flog(LOG_ERROR, "could not load file %s", nodeTravelFilename.c_str());
+        put_flog(LOG_ERROR, "could not load input data");
         return;
     }
 
+    indexGroups();
+
     // data set
     if(filename != NULL)
     {
@@ -61,8 +112,8 @@ EpidemicDataSet::EpidemicDataSet(const char * filename)
             return;
         }
 
-        // todo: for now, duplicate population data over all times, since this isn't stored in the data set
-        for(int time=1; time<numTimes_; time++)
+        // files without a population variable use the input population for all times
+        while(variables_["population"].getNumTimes() < numTimes_)
         {
             copyVariableToNewTimeStep("population");
         }
@@ -71,6 +122,39 @@ EpidemicDataSet::EpidemicDataSet(const char * filename)
     isValid_ = true;
 }
 
+EpidemicDataSet::EpidemicDataSet(EpidemicDataSet &dataSet)
+{
+    isValid_ = dataSet.isValid_;
+    numTimes_ = dataSet.numTimes_;
+    numNodes_ = dataSet.numNodes_;
+    nodeIds_ = dataSet.nodeIds_;
+    nodeIdToIndex_ = dataSet.nodeIdToIndex_;
+    nodeIdToName_ = dataSet.nodeIdToName_;
+    nodeIdToGroupName_ = dataSet.nodeIdToGroupName_;
+    groupNameToNodeIds_ = dataSet.groupNameToNodeIds_;
+    nodeGroupIndices_ = dataSet.nodeGroupIndices_;
+    groupNameToIndex_ = dataSet.groupNameToIndex_;
+    travel_ = dataSet.travel_;
+    sparseTravel_ = dataSet.sparseTravel_;
+    reservedNumTimes_ = dataSet.reservedNumTimes_;
+
+    std::map<std::string, EpidemicVariable>::iterator iter;
+
+    for(iter=dataSet.variables_.begin(); iter!=dataSet.variables_.end(); iter++)
+    {
+        variables_[iter->first] = iter->second.fork(reservedNumTimes_);
+    }
+
+    // handles of the data set are valid for the fork
+    handleVariableNames_ = dataSet.handleVariableNames_;
+    variableNameToHandleIndex_ = dataSet.variableNameToHandleIndex_;
+
+    for(unsigned int i=0; i<handleVariableNames_.size(); i++)
+    {
+        handleVariables_.push_back(&variables_[handleVariableNames_[i]]);
+    }
+}
+
 bool EpidemicDataSet::isValid()
 {
     return isValid_;
@@ -156,7 +240,7 @@ std::vector<std::string> EpidemicDataSet::getVariableNames()
     std::vector<std::string> variableNames;
 
     // regular variables
-    std::map<std::string, blitz::Array<float, 2+NUM_STRATIFICATION_DIMENSIONS> >::iterator iter;
+    std::map<std::string, EpidemicVariable>::iterator iter;
 
     for(iter=variables_.begin(); iter!=variables_.end(); iter++)
     {
@@ -210,7 +294,7 @@ float EpidemicDataSet::getTravel(int nodeId0, int nodeId1)
         return 0.;
     }
 
-    return travel_(nodeIdToIndex_[nodeId0], nodeIdToIndex_[nodeId1]);
+    return (*travel_)(nodeIdToIndex_[nodeId0], nodeIdToIndex_[nodeId1]);
 }
 
 float EpidemicDataSet::getValue(const std::string &varName, const int &time, const int &nodeId, const std::vector<int> &stratificationValues)
@@ -232,27 +316,39 @@ float EpidemicDataSet::getValue(const std::string &varName, const int &time, con
         return 0.;
     }
 
-    // the variable we're getting
-    blitz::Array<float, 2+NUM_STRATIFICATION_DIMENSIONS> variable = variables_[varName];
-
-    // the full domain
-    blitz::TinyVector<int, 2+NUM_STRATIFICATION_DIMENSIONS> lowerBound = variable.lbound();
-    blitz::TinyVector<int, 2+NUM_STRATIFICATION_DIMENSIONS> upperBound = variable.ubound();
-
     // make sure this variable is valid for the specified time
-    if(time < lowerBound(0) || time > upperBound(0))
+    if(time < 0 || time >= variables_[varName].getNumTimes())
     {
         put_flog(LOG_WARN, "variable %s not valid for time %i", varName.c_str(), time);
         return 0.;
     }
 
-    // limit by time
-    lowerBound(0) = upperBound(0) = time;
+    EpidemicVariable &epidemicVariable = variables_[varName];
+
+    // most sums are marginals, which are looked up rather than summed over the array
+    int s0, s1;
+
+    if(getMarginalStratificationValues(stratificationValues, s0, s1) == true)
+    {
+        if(nodeId != NODES_ALL)
+        {
+            return epidemicVariable.getMarginal(time, nodeIdToIndex_[nodeId], s0, s1);
+        }
+
+        return epidemicVariable.getGroupMarginal(time, nodeGroupIndices_, (int)groupNameToIndex_.size(), NODES_ALL, s0, s1);
+    }
+
+    // the variable we're getting, at the specified time
+    blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> variable = epidemicVariable.getTime(time);
+
+    // the full domain
+    blitz::TinyVector<int, 1+NUM_STRATIFICATION_DIMENSIONS> lowerBound = variable.lbound();
+    blitz::TinyVector<int, 1+NUM_STRATIFICATION_DIMENSIONS> upperBound = variable.ubound();
 
     // limit by node
     if(nodeId != NODES_ALL)
     {
-        lowerBound(1) = upperBound(1) = nodeIdToIndex_[nodeId];
+        lowerBound(0) = upperBound(0) = nodeIdToIndex_[nodeId];
     }
 
     // limit by stratification values
@@ -260,12 +356,12 @@ float EpidemicDataSet::getValue(const std::string &varName, const int &time, con
     {
         if(stratificationValues[i] != STRATIFICATIONS_ALL)
         {
-            lowerBound(2+i) = upperBound(2+i) = stratificationValues[i];
+            lowerBound(1+i) = upperBound(1+i) = stratificationValues[i];
         }
     }
 
     // the subdomain
-    blitz::RectDomain<2+NUM_STRATIFICATION_DIMENSIONS> subdomain(lowerBound, upperBound);
+    blitz::RectDomain<1+NUM_STRATIFICATION_DIMENSIONS> subdomain(lowerBound, upperBound);
 
     // return the sum of the array over the subdomain
     return blitz::sum(variable(subdomain));
@@ -296,7 +392,15 @@ float EpidemicDataSet::getValue(const std::string &varName, const int &time, con
         return 0.;
     }
 
-    std::vector<int> nodeIds = groupNameToNodeIds_[groupName];
+    // the sums of marginals over groups are looked up for regular variables
+    int s0, s1;
+
+    if(variables_.count(varName) != 0 && time >= 0 && time < variables_[varName].getNumTimes() && getMarginalStratificationValues(stratificationValues, s0, s1) == true)
+    {
+        return variables_[varName].getGroupMarginal(time, nodeGroupIndices_, (int)groupNameToIndex_.size(), groupNameToIndex_[groupName], s0, s1);
+    }
+
+    const std::vector<int> &nodeIds = groupNameToNodeIds_[groupName];
 
     float value = 0.;
 
@@ -308,6 +412,52 @@ float EpidemicDataSet::getValue(const std::string &varName, const int &time, con
     return value;
 }
 
+EpidemicVariableHandle EpidemicDataSet::getVariableHandle(const std::string &varName)
+{
+    EpidemicVariableHandle handle;
+
+    if(variables_.count(varName) == 0)
+    {
+        put_flog(LOG_ERROR, "no such variable %s", varName.c_str());
+        return handle;
+    }
+
+    if(variableNameToHandleIndex_.count(varName) == 0)
+    {
+        variableNameToHandleIndex_[varName] = (int)handleVariables_.size();
+
+        handleVariables_.push_back(&variables_[varName]);
+        handleVariableNames_.push_back(varName);
+    }
+
+    handle.index_ = variableNameToHandleIndex_[varName];
+
+    return handle;
+}
+
+std::string EpidemicDataSet::getVariableName(const EpidemicVariableHandle &handle)
+{
+    if(handle.isValid() != true || handle.index_ >= (int)handleVariableNames_.size())
+    {
+        put_flog(LOG_ERROR, "invalid handle");
+        return std::string();
+    }
+
+    return handleVariableNames_[handle.index_];
+}
+
+void EpidemicDataSet::reserveTimes(int numTimes)
+{
+    reservedNumTimes_ = numTimes;
+
+    std::map<std::string, EpidemicVariable>::iterator iter;
+
+    for(iter=variables_.begin(); iter!=variables_.end(); iter++)
+    {
+        iter->second.reserve(numTimes);
+    }
+}
+
 bool EpidemicDataSet::newVariable(std::string varName)
 {
     if(variables_.count(varName) != 0)
@@ -316,24 +466,17 @@ bool EpidemicDataSet::newVariable(std::string varName)
         return false;
     }
 
-    // full shape
-    blitz::TinyVector<int, 2+NUM_STRATIFICATION_DIMENSIONS> shape;
-    shape(0) = numTimes_;
-    shape(1) = numNodes_;
+    // shape of a time step
+    blitz::TinyVector<int, 1+NUM_STRATIFICATION_DIMENSIONS> shape;
+    shape(0) = numNodes_;
 
     for(int j=0; j<NUM_STRATIFICATION_DIMENSIONS; j++)
     {
-        shape(2 + j) = stratifications_[j].size();
+        shape(1 + j) = stratifications_[j].size();
     }
 
-    // create the variable
-    blitz::Array<float, 2+NUM_STRATIFICATION_DIMENSIONS> var(shape);
-
-    // initialize values to zero
-    var = 0.;
-
-    // add the variable to the vector
-    variables_[varName].reference(var);
+    // create the variable; values are initialized to zero
+    variables_[varName] = EpidemicVariable(shape, numTimes_, reservedNumTimes_);
 
     return true;
 }
@@ -352,9 +495,10 @@ bool EpidemicDataSet::copyVariable(std::string sourceVarName, std::string destVa
         return false;
     }
 
-    blitz::Array<float, 2+NUM_STRATIFICATION_DIMENSIONS> varCopy = variables_[sourceVarName].copy();
+    EpidemicVariable varCopy = variables_[sourceVarName].copy();
+    varCopy.reserve(reservedNumTimes_);
 
-    variables_[destVarName].reference(varCopy);
+    variables_[destVarName] = varCopy;
 
     return true;
 }
@@ -367,30 +511,8 @@ bool EpidemicDataSet::copyVariableToNewTimeStep(std::string varName)
         return false;
     }
 
-    // get current shape of variable
-    blitz::TinyVector<int, 2+NUM_STRATIFICATION_DIMENSIONS> shape = variables_[varName].shape();
-
-    // add a time step
-    shape(0) = shape(0) + 1;
-
-    // resize variable for the new shape
-    variables_[varName].resizeAndPreserve(shape);
-
-    // copy data to the new time step
-
-    // the full domain
-    blitz::TinyVector<int, 2+NUM_STRATIFICATION_DIMENSIONS> lowerBound = variables_[varName].lbound();
-    blitz::TinyVector<int, 2+NUM_STRATIFICATION_DIMENSIONS> upperBound = variables_[varName].ubound();
-
-    // domain for previous time and new time
-    lowerBound(0) = upperBound(0) = variables_[varName].extent(0) - 2;
-    blitz::RectDomain<2+NUM_STRATIFICATION_DIMENSIONS> subdomain0(lowerBound, upperBound);
-
-    lowerBound(0) = upperBound(0) = variables_[varName].extent(0) - 1;
-    blitz::RectDomain<2+NUM_STRATIFICATION_DIMENSIONS> subdomain1(lowerBound, upperBound);
-
-    // make the copy
-    variables_[varName](subdomain1) = variables_[varName](subdomain0);
+    // add a time step with a copy of the data; this does not move earlier time steps
+    variables_[varName].appendTime();
 
     return true;
 }
@@ -403,16 +525,17 @@ blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> EpidemicDataSet::getVariabl
         return blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS>();
     }
 
-    if(time >= variables_[varName].extent(0))
+    if(time >= variables_[varName].getNumTimes())
     {
-        put_flog(LOG_ERROR, "time %i >= time extent %i", time, variables_[varName].extent(0));
+        put_flog(LOG_ERROR, "time %i >= time extent %i", time, variables_[varName].getNumTimes());
         return blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS>();
     }
 
-    // this should produce a slice that references the data in the original variable array
-    blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> subVar = variables_[varName](time, blitz::Range::all(), BOOST_PP_ENUM(NUM_STRATIFICATION_DIMENSIONS, TEXT, blitz::Range::all()));
+    // this references the data in the original variable
+    // the array may be written to, so the time step's marginals are rebuilt when next used
+    variables_[varName].invalidateMarginals(time);
 
-    return subVar;
+    return variables_[varName].getTime(time);
 }
 
 blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> EpidemicDataSet::getVariableAtFinalTime(std::string varName)
@@ -423,12 +546,13 @@ blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> EpidemicDataSet::getVariabl
         return blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS>();
     }
 
-    // this should produce a slice that references the data in the original variable array
-    int finalTime = variables_[varName].extent(0) - 1;
+    // this references the data in the original variable
+    // the array may be written to, so the time step's marginals are rebuilt when next used
+    int finalTime = variables_[varName].getNumTimes() - 1;
 
-    blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> subVar = variables_[varName](finalTime, blitz::Range::all(), BOOST_PP_ENUM(NUM_STRATIFICATION_DIMENSIONS, TEXT, blitz::Range::all()));
+    variables_[varName].invalidateMarginals(finalTime);
 
-    return subVar;
+    return variables_[varName].getTime(finalTime);
 }
 
 boost::shared_ptr<StockpileNetwork> EpidemicDataSet::getStockpileNetwork()
@@ -436,150 +560,447 @@ boost::shared_ptr<StockpileNetwork> EpidemicDataSet::getStockpileNetwork()
     return stockpileNetwork_;
 }
 
-std::string EpidemicDataSet::getVariableSummaryNodeVsTime(const std::string &varName)
+bool EpidemicDataSet::writeCheckpoint(CheckpointWriter &out)
 {
-    if(variables_.count(varName) == 0)
+    out.writeTag("EpidemicDataSet");
+
+    out.write((boost::int32_t)numTimes_);
+    out.write((boost::int32_t)variables_.size());
+
+    std::map<std::string, EpidemicVariable>::iterator iter;
+
+    for(iter=variables_.begin(); iter!=variables_.end(); iter++)
     {
-        put_flog(LOG_ERROR, "no such variable %s", varName.c_str());
-        return std::string();
+        const EpidemicVariable &variable = iter->second;
+
+        out.writeString(iter->first);
+        out.write((boost::int32_t)variable.getNumTimes());
+
+        // time steps are stored in separate chunks, so they are written one at a time
+        blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> values(variable.getShape());
+
+        for(int t=0; t<variable.getNumTimes(); t++)
+        {
+            values = variable.getTime(t);
+
+            out.writeArray(values.data(), values.size());
+        }
+    }
+
+    return out.good();
+}
+
+bool EpidemicDataSet::readCheckpoint(CheckpointReader &in)
+{
+    boost::int32_t numTimes;
+    boost::int32_t numVariables;
+
+    if(in.readTag("EpidemicDataSet") != true || in.read(numTimes) != true || in.read(numVariables) != true)
+    {
+        return false;
     }
 
-    // nodeIds
-    std::vector<int> nodeIds = getNodeIds();
+    if(numVariables != (int)variables_.size())
+    {
+        put_flog(LOG_ERROR, "checkpoint has %i variables, expected %i", numVariables, variables_.size());
+        return false;
+    }
 
-    // generate the CSV
-    std::stringstream out;
+    // the current variables are only replaced once all variables are read
+    std::map<std::string, EpidemicVariable> variables;
 
-    // set maximum decimal precision for stringstream
-    out.precision(16);
+    for(int i=0; i<numVariables; i++)
+    {
+        std::string varName;
+        boost::int32_t varNumTimes;
 
-    // header
-    out << "t";
+        if(in.readString(varName) != true || in.read(varNumTimes) != true)
+        {
+            return false;
+        }
 
-    // header: for each node
-    for(unsigned int i=0; i<nodeIds.size(); i++)
+        if(variables_.count(varName) == 0 || variables.count(varName) != 0)
+        {
+            put_flog(LOG_ERROR, "unexpected variable %s in checkpoint", varName.c_str());
+            return false;
+        }
+
+        if(varNumTimes < 1 || varNumTimes > numTimes)
+        {
+            put_flog(LOG_ERROR, "variable %s has %i time steps in checkpoint", varName.c_str(), varNumTimes);
+            return false;
+        }
+
+        blitz::TinyVector<int, 1+NUM_STRATIFICATION_DIMENSIONS> shape = variables_[varName].getShape();
+
+        blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> values(shape);
+
+        if(in.checkSize((boost::uint64_t)varNumTimes * values.size(), sizeof(float)) != true)
+        {
+            put_flog(LOG_ERROR, "variable %s is truncated in checkpoint", varName.c_str());
+            return false;
+        }
+
+        EpidemicVariable variable(shape, varNumTimes, std::max(reservedNumTimes_, (int)varNumTimes));
+
+        for(int t=0; t<varNumTimes; t++)
+        {
+            if(in.readArray(values.data(), values.size()) != true)
+            {
+                put_flog(LOG_ERROR, "could not read variable %s in checkpoint", varName.c_str());
+                return false;
+            }
+
+            variable.getTime(t) = values;
+        }
+
+        variables[varName] = variable;
+    }
+
+    // assign to the existing entries, which variable handles point to
+    std::map<std::string, EpidemicVariable>::iterator iter;
+
+    for(iter=variables.begin(); iter!=variables.end(); iter++)
     {
-        out << "," << nodeIds[i];
+        variables_[iter->first] = iter->second;
     }
 
-    out << std::endl;
+    numTimes_ = numTimes;
+
+    return true;
+}
 
-    // row for each time
-    for(unsigned t=0; t<getNumTimes(); t++)
+bool EpidemicDataSet::loadInputData()
+{
+    boost::mutex::scoped_lock lock(g_inputDataMutex);
+
+    if(g_inputData == NULL)
     {
-        out << t;
+        // load stratifications data
+        if(loadStratificationsFile() != true)
+        {
+            put_flog(LOG_ERROR, "could not load stratifications file");
+            return false;
+        }
 
-        for(unsigned int n=0; n<nodeIds.size(); n++)
+        // a current input bundle replaces the text files
+        boost::shared_ptr<const InputBundle> bundle = InputBundle::getDataDirectoryBundle();
+
+        if(bundle == NULL || loadInputBundle(bundle) != true)
         {
-            out << "," << getValue(varName, t, nodeIds[n]);
+            if(bundle != NULL)
+            {
+                put_flog(LOG_WARN, "could not load input bundle, reading text files");
+            }
+
+            if(loadInputFiles() != true)
+            {
+                return false;
+            }
         }
 
-        out << std::endl;
+        // cache the loaded data for other data sets
+        boost::shared_ptr<EpidemicDataSetInputData> inputData(new EpidemicDataSetInputData());
+
+        inputData->numNodes = numNodes_;
+        inputData->nodeIds = nodeIds_;
+        inputData->nodeIdToIndex = nodeIdToIndex_;
+        inputData->nodeIdToName = nodeIdToName_;
+        inputData->nodeIdToGroupName = nodeIdToGroupName_;
+        inputData->groupNameToNodeIds = groupNameToNodeIds_;
+
+        // keep a private copy of the population, since simulations modify their population variable
+        inputData->population = variables_["population"].copy();
+
+        inputData->travel = travel_;
+        inputData->sparseTravel = sparseTravel_;
+
+        g_inputData = inputData;
+
+        return true;
     }
 
-    return out.str();
+    // copy the cached data
+    numNodes_ = g_inputData->numNodes;
+    nodeIds_ = g_inputData->nodeIds;
+    nodeIdToIndex_ = g_inputData->nodeIdToIndex;
+    nodeIdToName_ = g_inputData->nodeIdToName;
+    nodeIdToGroupName_ = g_inputData->nodeIdToGroupName;
+    groupNameToNodeIds_ = g_inputData->groupNameToNodeIds;
+
+    // the population variable is modified by simulations, so each data set has its own copy
+    variables_["population"] = g_inputData->population.copy();
+
+    // travel is read-only and can be shared
+    travel_ = g_inputData->travel;
+    sparseTravel_ = g_inputData->sparseTravel;
+
+    return true;
 }
 
-std::string EpidemicDataSet::getVariableStratified2NodeVsTime(const std::string &varName)
+void EpidemicDataSet::indexGroups()
 {
-    if(variables_.count(varName) == 0)
+    nodeGroupIndices_.assign(numNodes_, -1);
+    groupNameToIndex_.clear();
+
+    for(std::map<std::string, std::vector<int> >::iterator it=groupNameToNodeIds_.begin(); it!=groupNameToNodeIds_.end(); it++)
     {
-        put_flog(LOG_ERROR, "no such variable %s", varName.c_str());
-        return std::string();
+        int groupIndex = (int)groupNameToIndex_.size();
+
+        groupNameToIndex_[it->first] = groupIndex;
+
+        for(unsigned int i=0; i<it->second.size(); i++)
+        {
+            int nodeIndex = nodeIdToIndex_[it->second[i]];
+
+            // the sums over groups assume each node is in one group, as in the node name and group data
+            if(nodeGroupIndices_[nodeIndex] != -1)
+            {
+                put_flog(LOG_WARN, "node %i is in more than one group", it->second[i]);
+            }
+
+            nodeGroupIndices_[nodeIndex] = groupIndex;
+        }
     }
+}
 
-    // make sure we have at least two stratifications
-    std::vector<std::vector<std::string> > stratifications = getStratifications();
+bool EpidemicDataSet::loadInputFiles()
+{
+    // load node name and group data
+    std::string nodeNameGroupFilename = g_dataDirectory + "/" + g_nodeNameGroupFilename;
 
-    if(stratifications.size() < 2)
+    if(loadNodeNameGroupFile(nodeNameGroupFilename.c_str()) != true)
     {
-        put_flog(LOG_ERROR, "need at least 2 stratifications");
-        return std::string();
+        put_flog(LOG_ERROR, "could not load file %s", nodeNameGroupFilename.c_str());
+        return false;
     }
 
-    // nodeIds
-    std::vector<int> nodeIds = getNodeIds();
+    // population data
+    std::string nodePopulationFilename = g_dataDirectory + "/" + g_nodePopulationFilename;
 
-    // generate the CSV
-    std::stringstream out;
+    if(loadNodePopulationFile(nodePopulationFilename.c_str()) != true)
+    {
+        put_flog(LOG_ERROR, "could not load file %s", nodePopulationFilename.c_str());
+        return false;
+    }
 
-    // set maximum decimal precision for stringstream
-    out.precision(16);
+    // travel data
+    std::string nodeTravelFilename = g_dataDirectory + "/" + g_nodeTravelFilename;
 
-    // header
-    out << "t,group";
+    if(loadNodeTravelFile(nodeTravelFilename.c_str()) != true)
+    {
+        put_flog(LOG_ERROR, "could not load file %s", nodeTravelFilename.c_str());
+        return false;
+    }
 
-    // header: for each node
-    for(unsigned int i=0; i<nodeIds.size(); i++)
+    return true;
+}
+
+bool EpidemicDataSet::loadInputBundle(boost::shared_ptr<const InputBundle> bundle)
+{
+    if(stratifications_.size() < 2)
     {
-        out << "," << nodeIds[i];
+        put_flog(LOG_ERROR, "need at least 2 stratification, got %i", (int)stratifications_.size());
+        return false;
     }
 
-    out << std::endl;
+    // nodes
+    std::vector<int> nodeIds;
+    std::vector<std::string> nodeNames;
+    std::vector<std::string> nodeGroupNames;
+
+    if(bundle->getValues("nodes.ids", nodeIds) != true || bundle->getStrings("nodes.names", nodeNames) != true || bundle->getStrings("nodes.groups", nodeGroupNames) != true
+        || nodeNames.size() != nodeIds.size() || nodeGroupNames.size() != nodeIds.size())
+    {
+        put_flog(LOG_ERROR, "invalid nodes in input bundle");
+        return false;
+    }
 
-    // row for each time and stratification value combination
-    std::vector<int> stratificationValues(2, 0);
+    numNodes_ = (int)nodeIds.size();
+    nodeIds_ = nodeIds;
+    nodeIdToIndex_.clear();
+    nodeIdToName_.clear();
+    nodeIdToGroupName_.clear();
+    groupNameToNodeIds_.clear();
 
-    for(unsigned t=0; t<getNumTimes(); t++)
+    for(int i=0; i<numNodes_; i++)
     {
-        for(unsigned int s1=0; s1<stratifications[0].size(); s1++)
-        {
-            stratificationValues[0] = s1;
+        nodeIdToIndex_[nodeIds[i]] = i;
+        nodeIdToName_[nodeIds[i]] = nodeNames[i];
+        nodeIdToGroupName_[nodeIds[i]] = nodeGroupNames[i];
+        groupNameToNodeIds_[nodeGroupNames[i]].push_back(nodeIds[i]);
+    }
+
+    // population, ordered by [node][stratification 0][stratification 1]
+    int numStratification0 = (int)stratifications_[0].size();
+    int numStratification1 = (int)stratifications_[1].size();
+
+    std::vector<float> populationValues;
+
+    if(bundle->getValues("population", populationValues) != true || (int)populationValues.size() != numNodes_ * numStratification0 * numStratification1)
+    {
+        put_flog(LOG_ERROR, "invalid population in input bundle");
+        return false;
+    }
+
+    blitz::TinyVector<int, 2+NUM_STRATIFICATION_DIMENSIONS> shape;
+    shape(0) = 1; // one time step
+    shape(1) = numNodes_;
 
-            for(unsigned int s2=0; s2<stratifications[1].size(); s2++)
+    for(int j=0; j<NUM_STRATIFICATION_DIMENSIONS; j++)
+    {
+        shape(2 + j) = stratifications_[j].size();
+    }
+
+    blitz::Array<float, 2+NUM_STRATIFICATION_DIMENSIONS> population(shape);
+
+    population = 0.;
+
+    for(int n=0; n<numNodes_; n++)
+    {
+        for(int i=0; i<numStratification0; i++)
+        {
+            for(int j=0; j<numStratification1; j++)
             {
-                stratificationValues[1] = s2;
+                // all other stratification indices are zero
+                blitz::TinyVector<int, 2+NUM_STRATIFICATION_DIMENSIONS> index(0);
+
+                index(1) = n;
+                index(2) = i;
+                index(3) = j;
+
+                population(index) = populationValues[(n * numStratification0 + i) * numStratification1 + j];
+            }
+        }
+    }
+
+    variables_["population"] = EpidemicVariable(population);
+
+    // travel is used in place
+    size_t travelSize;
+    const char * travelData = bundle->getSection("travel", travelSize);
+
+    if(travelData == NULL || travelSize != (size_t)numNodes_ * numNodes_ * sizeof(float))
+    {
+        put_flog(LOG_ERROR, "invalid travel in input bundle");
+        return false;
+    }
+
+    InputBundleTravelDeleter deleter;
+    deleter.bundle = bundle;
+
+    blitz::Array<float, 2> * travel = new blitz::Array<float, 2>((float *)travelData, blitz::shape(numNodes_, numNodes_), blitz::neverDeleteData);
+
+    travel_ = boost::shared_ptr<const blitz::Array<float, 2> >(travel, deleter);
+    sparseTravel_ = boost::shared_ptr<const SparseTravel>(new SparseTravel(*travel));
+
+    return true;
+}
+
+bool EpidemicDataSet::addInputData(InputBundle &bundle)
+{
+    if(loadStratificationsFile() != true || loadInputFiles() != true)
+    {
+        return false;
+    }
+
+    bundle.addSource(g_dataDirectory, STRATIFICATIONS_FILENAME);
+    bundle.addSource(g_dataDirectory, g_nodeNameGroupFilename);
+    bundle.addSource(g_dataDirectory, g_nodePopulationFilename);
+    bundle.addSource(g_dataDirectory, g_nodeTravelFilename);
+
+    // nodes
+    std::vector<std::string> nodeNames;
+    std::vector<std::string> nodeGroupNames;
+
+    for(int i=0; i<numNodes_; i++)
+    {
+        nodeNames.push_back(nodeIdToName_[nodeIds_[i]]);
+        nodeGroupNames.push_back(nodeIdToGroupName_[nodeIds_[i]]);
+    }
 
-                // group name
-                std::string groupName = stratifications[0][s1] + " " + stratifications[1][s2];
+    bundle.addValues("nodes.ids", nodeIds_);
+    bundle.addStrings("nodes.names", nodeNames);
+    bundle.addStrings("nodes.groups", nodeGroupNames);
 
-                out << t << "," << groupName;
+    // population, ordered by [node][stratification 0][stratification 1]
+    blitz::Array<float, 2+NUM_STRATIFICATION_DIMENSIONS> population = variables_["population"].getArray();
 
-                for(unsigned int n=0; n<nodeIds.size(); n++)
-                {
-                    out << "," << getValue(varName, t, nodeIds[n], stratificationValues);
-                }
+    std::vector<float> populationValues;
 
-                out << std::endl;
+    for(int n=0; n<numNodes_; n++)
+    {
+        for(unsigned int i=0; i<stratifications_[0].size(); i++)
+        {
+            for(unsigned int j=0; j<stratifications_[1].size(); j++)
+            {
+                blitz::TinyVector<int, 2+NUM_STRATIFICATION_DIMENSIONS> index(0);
+
+                index(1) = n;
+                index(2) = i;
+                index(3) = j;
+
+                populationValues.push_back(population(index));
             }
         }
     }
 
-    return out.str();
+    bundle.addValues("population", populationValues);
+
+    // travel, ordered by [node][node]
+    std::vector<float> travelValues;
+    travelValues.reserve(numNodes_ * numNodes_);
+
+    for(int i=0; i<numNodes_; i++)
+    {
+        for(int j=0; j<numNodes_; j++)
+        {
+            travelValues.push_back((*travel_)(i, j));
+        }
+    }
+
+    bundle.addValues("travel", travelValues);
+
+    return true;
 }
 
 bool EpidemicDataSet::loadNetCdfFile(const char * filename)
 {
-#if USE_NETCDF // TODO: should handle this differently
-    // change netcdf library error behavior
-    NcError err(NcError::verbose_nonfatal);
-
+#if USE_NETCDF
     // open the netcdf file
-    NcFile ncFile(filename, NcFile::ReadOnly);
+    int ncId;
 
-    if(!ncFile.is_valid())
+    if(netCdfSucceeded(nc_open(filename, NC_NOWRITE, &ncId)) != true)
     {
         put_flog(LOG_FATAL, "invalid file %s", filename);
         return false;
     }
 
+    // variables are read on demand, so the file stays open until the last variable reading from it is destroyed
+    boost::shared_ptr<NetCdfFile> ncFile(new NetCdfFile(ncId));
+
     // get dimensions
-    NcDim * timeDim = ncFile.get_dim("time");
-    NcDim * nodesDim = ncFile.get_dim("nodes");
-    NcDim * stratificationsDim = ncFile.get_dim("stratifications");
+    int timeDimId, nodesDimId, stratificationsDimId;
 
-    if(timeDim == NULL || nodesDim == NULL || stratificationsDim == NULL)
+    if(nc_inq_dimid(ncId, "time", &timeDimId) != NC_NOERR || nc_inq_dimid(ncId, "nodes", &nodesDimId) != NC_NOERR || nc_inq_dimid(ncId, "stratifications", &stratificationsDimId) != NC_NOERR)
     {
         put_flog(LOG_FATAL, "could not find a required dimension");
         return false;
     }
 
-    numTimes_ = timeDim->size();
+    size_t numTimes, numNodes, numStratifications;
+
+    if(netCdfSucceeded(nc_inq_dimlen(ncId, timeDimId, &numTimes)) != true || netCdfSucceeded(nc_inq_dimlen(ncId, nodesDimId, &numNodes)) != true || netCdfSucceeded(nc_inq_dimlen(ncId, stratificationsDimId, &numStratifications)) != true)
+    {
+        return false;
+    }
+
+    numTimes_ = (int)numTimes;
 
     // make sure we have the expected number of nodes
-    if(nodesDim->size() != numNodes_)
+    if((int)numNodes != numNodes_)
     {
-        put_flog(LOG_FATAL, "got %i nodes, expected %i", nodesDim->size(), numNodes_);
+        put_flog(LOG_FATAL, "got %i nodes, expected %i", (int)numNodes, numNodes_);
         return false;
     }
 
@@ -593,40 +1014,173 @@ bool EpidemicDataSet::loadNetCdfFile(const char * filename)
         numExpectedStratifications *= stratifications_[i].size();
     }
 
-    if(stratificationsDim->size() != numExpectedStratifications)
+    if((int)numStratifications != numExpectedStratifications)
     {
-        put_flog(LOG_FATAL, "got %i stratifications, expected %i", stratificationsDim->size(), numExpectedStratifications);
+        put_flog(LOG_FATAL, "got %i stratifications, expected %i", (int)numStratifications, numExpectedStratifications);
         return false;
     }
 
-    // get all float variables with dimensions (time, nodes, stratifications)
-    for(int i=0; i<ncFile.num_vars(); i++)
+    // find all float variables with dimensions (time, nodes, stratifications)
+    int numVars;
+
+    if(netCdfSucceeded(nc_inq_nvars(ncId, &numVars)) != true)
     {
-        NcVar * ncVar = ncFile.get_var(i);
+        return false;
+    }
 
-        if(ncVar->num_dims() == 3 && ncVar->type() == ncFloat && strcmp(ncVar->get_dim(0)->name(), "time") == 0 && strcmp(ncVar->get_dim(1)->name(), "nodes") == 0 && strcmp(ncVar->get_dim(2)->name(), "stratifications") == 0)
-        {
-            put_flog(LOG_INFO, "found variable: %s", ncVar->name());
+    std::vector<std::string> varNames;
+    std::vector<int> varIds;
 
-            // full shape
-            blitz::TinyVector<int, 2+NUM_STRATIFICATION_DIMENSIONS> shape;
-            shape(0) = numTimes_;
-            shape(1) = numNodes_;
+    for(int varId=0; varId<numVars; varId++)
+    {
+        char name[NC_MAX_NAME + 1];
+        nc_type type;
+        int numDims;
+        int dimIds[NC_MAX_VAR_DIMS];
 
-            for(int j=0; j<NUM_STRATIFICATION_DIMENSIONS; j++)
-            {
-                shape(2 + j) = stratifications_[j].size();
-            }
+        if(netCdfSucceeded(nc_inq_var(ncId, varId, name, &type, &numDims, dimIds, NULL)) != true)
+        {
+            return false;
+        }
 
-            blitz::Array<float, 2+NUM_STRATIFICATION_DIMENSIONS> var((float *)ncVar->values()->base(), shape, blitz::duplicateData);
+        if(numDims == 3 && type == NC_FLOAT && dimIds[0] == timeDimId && dimIds[1] == nodesDimId && dimIds[2] == stratificationsDimId)
+        {
+            put_flog(LOG_INFO, "found variable: %s", name);
 
-            variables_[std::string(ncVar->name())].reference(var);
+            varNames.push_back(std::string(name));
+            varIds.push_back(varId);
         }
     }
+
+    // shape of a time step
+    blitz::TinyVector<int, 1+NUM_STRATIFICATION_DIMENSIONS> shape;
+    shape(0) = numNodes_;
+
+    for(int j=0; j<NUM_STRATIFICATION_DIMENSIONS; j++)
+    {
+        shape(1 + j) = stratifications_[j].size();
+    }
+
+    // split the memory budget for cached time steps over the variables
+    size_t timeNumBytes = (size_t)numNodes_ * numExpectedStratifications * sizeof(float);
+    int cacheNumTimes = (int)(maxCachedBytes_ / std::max((size_t)1, varNames.size() * timeNumBytes));
+
+    put_flog(LOG_DEBUG, "caching up to %i time steps per variable", cacheNumTimes);
+
+    // nothing is read until it is used
+    for(unsigned int i=0; i<varNames.size(); i++)
+    {
+        boost::shared_ptr<EpidemicVariableStore> store(new NetCdfVariableStore(ncFile, varIds[i]));
+
+        variables_[varNames[i]] = EpidemicVariable(shape, numTimes_, store, cacheNumTimes);
+    }
 #endif
     return true;
 }
 
+bool EpidemicDataSet::saveNetCdfFile(const char * filename)
+{
+#if USE_NETCDF
+    int numStratifications = 1;
+
+    for(unsigned int i=0; i<NUM_STRATIFICATION_DIMENSIONS; i++)
+    {
+        numStratifications *= stratifications_[i].size();
+    }
+
+    // NetCDF-4 with the classic data model, as read by loadNetCdfFile()
+    int ncId;
+
+    if(netCdfSucceeded(nc_create(filename, NC_CLOBBER | NC_NETCDF4 | NC_CLASSIC_MODEL, &ncId)) != true)
+    {
+        put_flog(LOG_ERROR, "could not create file %s", filename);
+        return false;
+    }
+
+    bool success = true;
+
+    // dimensions (time, nodes, stratifications), where stratifications are flattened
+    int dimIds[3];
+
+    success = success && netCdfSucceeded(nc_def_dim(ncId, "time", numTimes_, &dimIds[0]));
+    success = success && netCdfSucceeded(nc_def_dim(ncId, "nodes", numNodes_, &dimIds[1]));
+    success = success && netCdfSucceeded(nc_def_dim(ncId, "stratifications", numStratifications, &dimIds[2]));
+
+    // node ids, as a coordinate variable
+    int nodesVarId;
+
+    success = success && netCdfSucceeded(nc_def_var(ncId, "nodes", NC_INT, 1, &dimIds[1], &nodesVarId));
+
+    // chunks of whole time steps, up to about 1MB
+    size_t chunkSizes[3];
+    chunkSizes[0] = std::max(1, std::min(numTimes_, (1 << 18) / std::max(1, numNodes_ * numStratifications)));
+    chunkSizes[1] = numNodes_;
+    chunkSizes[2] = numStratifications;
+
+    std::vector<std::string> varNames;
+    std::vector<int> varIds;
+
+    for(std::map<std::string, EpidemicVariable>::iterator iter=variables_.begin(); iter!=variables_.end() && success == true; iter++)
+    {
+        if(iter->second.getNumTimes() != numTimes_)
+        {
+            put_flog(LOG_WARN, "not saving variable %s with %i times (expected %i)", iter->first.c_str(), iter->second.getNumTimes(), numTimes_);
+            continue;
+        }
+
+        int varId;
+
+        success = success && netCdfSucceeded(nc_def_var(ncId, iter->first.c_str(), NC_FLOAT, 3, dimIds, &varId));
+        success = success && netCdfSucceeded(nc_def_var_chunking(ncId, varId, NC_CHUNKED, chunkSizes));
+
+        // the shuffle filter improves compression of float data
+        success = success && netCdfSucceeded(nc_def_var_deflate(ncId, varId, 1, 1, 4));
+
+        varNames.push_back(iter->first);
+        varIds.push_back(varId);
+    }
+
+    success = success && netCdfSucceeded(nc_enddef(ncId));
+
+    if(nodeIds_.size() > 0)
+    {
+        success = success && netCdfSucceeded(nc_put_var_int(ncId, nodesVarId, &nodeIds_[0]));
+    }
+
+    // write each time step of each variable
+    for(unsigned int i=0; i<varNames.size() && success == true; i++)
+    {
+        EpidemicVariable &variable = variables_[varNames[i]];
+
+        for(int t=0; t<numTimes_ && success == true; t++)
+        {
+            // contiguous copy of the time step: [node][stratifications...]
+            blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> timeArray = variable.getTime(t).copy();
+
+            size_t start[3] = { (size_t)t, 0, 0 };
+            size_t count[3] = { 1, (size_t)numNodes_, (size_t)numStratifications };
+
+            success = success && netCdfSucceeded(nc_put_vara_float(ncId, varIds[i], start, count, timeArray.data()));
+        }
+    }
+
+    success = netCdfSucceeded(nc_close(ncId)) && success;
+
+    if(success != true)
+    {
+        put_flog(LOG_ERROR, "could not save file %s", filename);
+        return false;
+    }
+
+    put_flog(LOG_INFO, "saved %i variables, %i time steps to %s", (int)varNames.size(), numTimes_, filename);
+
+    return true;
+#else
+    put_flog(LOG_ERROR, "NetCDF support not enabled, could not save file %s", filename);
+    return false;
+#endif
+}
+
 bool EpidemicDataSet::loadStratificationsFile()
 {
     std::string filename = g_dataDirectory + "/" + STRATIFICATIONS_FILENAME;
@@ -832,7 +1386,7 @@ bool EpidemicDataSet::loadNodePopulationFile(const char * filename)
     }
 
     // add to regular variables map
-    variables_["population"].reference(population);
+    variables_["population"] = EpidemicVariable(population);
 
     return true;
 }
@@ -894,7 +1448,8 @@ bool EpidemicDataSet::loadNodeTravelFile(const char * filename)
         return false;
     }
 
-    travel_.reference(travel);
+    travel_ = boost::shared_ptr<const blitz::Array<float, 2> >(new blitz::Array<float, 2>(travel));
+    sparseTravel_ = boost::shared_ptr<const SparseTravel>(new SparseTravel(travel));
 
     return true;
 }
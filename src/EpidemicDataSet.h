@@ -1,6 +1,9 @@
 #ifndef EPIDEMIC_DATA_SET_H
 #define EPIDEMIC_DATA_SET_H
 
+#include "stratifications.h"
+#include "EpidemicVariable.h"
+#include "SparseTravel.h"
 #include <map>
 #include <vector>
 #include <blitz/array.h>
@@ -8,13 +11,9 @@
 #include <boost/function.hpp>
 
 class StockpileNetwork;
-
-// must be defined at compile time, and match definition in stratifications file
-// stratifications: [age group][risk group][vaccinated]
-#define NUM_STRATIFICATION_DIMENSIONS 3
-#define STRATIFICATIONS_FILENAME "stratifications.csv"
-
-#define STRATIFICATIONS_ALL -1
+class InputBundle;
+class CheckpointWriter;
+class CheckpointReader;
 
 #define NODES_ALL -1
 
@@ -54,23 +53,42 @@ class EpidemicDataSet
         float getValue(const std::string &varName, const int &time, const int &nodeId, const std::vector<std::vector<int> > &stratificationValuesSet);
         float getValue(const std::string &varName, const int &time, const std::string &groupName, const std::vector<int> &stratificationValues=std::vector<int>());
 
+        // reserve storage for a total of numTimes time steps in all variables, including variables created later
+        // this is optional: storage otherwise grows geometrically as time steps are added
+        void reserveTimes(int numTimes);
+
+        // resolve a regular variable name to a handle; returns an invalid handle if there is no such variable
+        // handles remain valid for the lifetime of the data set
+        EpidemicVariableHandle getVariableHandle(const std::string &varName);
+        std::string getVariableName(const EpidemicVariableHandle &handle);
+
+        // the variable for a valid handle
+        EpidemicVariable & getVariable(const EpidemicVariableHandle &handle)
+        {
+            return *handleVariables_[handle.index_];
+        }
+
         bool newVariable(std::string varName);
         bool copyVariable(std::string sourceVarName, std::string destVarName);
         bool copyVariableToNewTimeStep(std::string varName);
 
         // both of these return arrays that reference the original data!
+        // the arrays remain valid when new time steps are added
         blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> getVariableAtTime(std::string varName, int time);
         blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> getVariableAtFinalTime(std::string varName);
 
         boost::shared_ptr<StockpileNetwork> getStockpileNetwork();
 
         // output
+        // for output of variables as a simulation progresses, see EpidemicOutputSink
 
-        // aggregated over all stratifications
-        std::string getVariableSummaryNodeVsTime(const std::string &varName);
+        // save all regular variables to a NetCDF-4 file readable by the constructor
+        // variables are chunked over time and deflate-compressed; requires USE_NETCDF
+        bool saveNetCdfFile(const char * filename);
 
-        // variable value enumerated over first two stratifications (age group, risk group)
-        std::string getVariableStratified2NodeVsTime(const std::string &varName);
+        // parse the input text files in the data directory, and add their node, population and travel data to a bundle
+        // this replaces the input data of this data set, so it should only be used for one constructed without a file
+        bool addInputData(InputBundle &bundle);
 
     protected:
 
@@ -99,11 +117,29 @@ class EpidemicDataSet
         // maps group name to node id's
         std::map<std::string, std::vector<int> > groupNameToNodeIds_;
 
+        // group index of each node index, and index of each group name
+        // the sums of regular variables over all nodes and groups are looked up by these; see EpidemicVariable::getGroupMarginal()
+        std::vector<int> nodeGroupIndices_;
+        std::map<std::string, int> groupNameToIndex_;
+
         // node -> node travel fractions
-        blitz::Array<float, 2> travel_;
+        // this is read-only and shared by all data sets (see loadInputData())
+        boost::shared_ptr<const blitz::Array<float, 2> > travel_;
+
+        // the same travel fractions in sparse format, for simulations
+        boost::shared_ptr<const SparseTravel> sparseTravel_;
+
+        // number of time steps reserved for variables
+        int reservedNumTimes_;
 
         // all regular variables
-        std::map<std::string, blitz::Array<float, 2+NUM_STRATIFICATION_DIMENSIONS> > variables_;
+        std::map<std::string, EpidemicVariable> variables_;
+
+        // variables resolved to handles, indexed by handle
+        // these point into variables_, whose entries are never moved or erased
+        std::vector<EpidemicVariable *> handleVariables_;
+        std::vector<std::string> handleVariableNames_;
+        std::map<std::string, int> variableNameToHandleIndex_;
 
         // all derived variables
         std::map<std::string, boost::function<float (int time, int nodeId, std::vector<int> stratificationValues)> > derivedVariables_;
@@ -111,6 +147,34 @@ class EpidemicDataSet
         // stockpile network
         boost::shared_ptr<StockpileNetwork> stockpileNetwork_;
 
+        // a fork of a data set: the input data and all time steps but the final one of each regular variable are shared
+        // (see EpidemicVariable::fork()), and the final time step is copied. derived variables and the stockpile network
+        // reference their data set, so subclasses create their own
+        EpidemicDataSet(EpidemicDataSet &dataSet);
+
+        // write or restore the state of the data set: all time steps of the regular variables
+        // a checkpoint can only be restored into a data set with the same variables and input data
+        // subclasses extend these with their own state, calling the base class first
+        virtual bool writeCheckpoint(CheckpointWriter &out);
+        virtual bool readCheckpoint(CheckpointReader &in);
+
+        // memory for time steps of variables read on demand from a file, over all variables
+        static const size_t maxCachedBytes_;
+
+        // load stratifications, nodes, populations and travel from the data directory
+        // the files are only read once per process; later data sets copy the cached data
+        // this is thread-safe, so multiple data sets can be constructed concurrently
+        bool loadInputData();
+
+        // index the groups of groupNameToNodeIds_ in nodeGroupIndices_ and groupNameToIndex_
+        void indexGroups();
+
+        // load nodes, populations and travel from the input text files, or from an input bundle made from them
+        // the bundle is kept mapped as long as the travel data references it
+        bool loadInputFiles();
+        bool loadInputBundle(boost::shared_ptr<const InputBundle> bundle);
+
+        // variables are read from the file on demand, a time step at a time
         bool loadNetCdfFile(const char * filename);
         static bool loadStratificationsFile();
         bool loadNodeNameGroupFile(const char * filename);
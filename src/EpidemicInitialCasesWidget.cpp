@@ -3,7 +3,6 @@
 #include "EpidemicSimulation.h"
 #include "EpidemicCasesWidget.h"
 #include "log.h"
-#include <QtXmlPatterns>
 
 EpidemicInitialCasesWidget::EpidemicInitialCasesWidget(MainWindow * mainWindow)
 {
@@ -87,25 +86,17 @@ void EpidemicInitialCasesWidget::setDataSet(boost::shared_ptr<EpidemicDataSet> d
     // create defaults if this is a simulation
     if(simulation != NULL && simulation->getNumTimes() == 1)
     {
-        // todo: this should be handled somewhere else
-        int defaultNumCases = 10000;
-        std::vector<int> defaultNodeIds;
+        std::vector<EpidemicCases> defaultCases = getDefaultEpidemicCases();
 
-        defaultNodeIds.push_back(453);
-        defaultNodeIds.push_back(113);
-        defaultNodeIds.push_back(201);
-        defaultNodeIds.push_back(141);
-        defaultNodeIds.push_back(375);
-
-        for(unsigned int i=0; i<defaultNodeIds.size(); i++)
+        for(unsigned int i=0; i<defaultCases.size(); i++)
         {
             EpidemicCasesWidget * casesWidget = new EpidemicCasesWidget(simulation);
 
             casesWidgets_.push_back(casesWidget);
             layout_.addWidget(casesWidget);
 
-            casesWidget->setNumCases(defaultNumCases);
-            casesWidget->setNodeId(defaultNodeIds[i]);
+            casesWidget->setNumCases(defaultCases[i].num);
+            casesWidget->setNodeId(defaultCases[i].nodeId);
         }
     }
 }
@@ -129,49 +120,23 @@ void EpidemicInitialCasesWidget::loadXmlData(const std::string &filename)
     // clear existing cases
     clearCases();
 
-    QXmlQuery query;
+    std::vector<EpidemicCases> cases;
 
-    if(query.setFocus(QUrl(filename.c_str())) == false)
+    if(loadEpidemicCasesXml(filename, cases) != true)
     {
-        put_flog(LOG_ERROR, "failed to load %s", filename.c_str());
         QMessageBox::warning(this, "Error", "Could not load file", QMessageBox::Ok, QMessageBox::Ok);
         return;
     }
 
-    // temp strings
-    char string[1024];
-    QString qstring;
-
-    // get number of initial cases
-    sprintf(string, "string(count(//cases))");
-    query.setQuery(string);
-    query.evaluateTo(&qstring);
-    int numCases = qstring.toInt();
-
-    put_flog(LOG_INFO, "%i entries", numCases);
-
-    // populate parameters for each tile
-    for(int i=1; i<=numCases; i++)
+    for(unsigned int i=0; i<cases.size(); i++)
     {
-        sprintf(string, "string(//cases[%i]/@num)", i);
-        query.setQuery(string);
-        query.evaluateTo(&qstring);
-        int num = qstring.toInt();
-
-        sprintf(string, "string(//cases[%i]/@nodeId)", i);
-        query.setQuery(string);
-        query.evaluateTo(&qstring);
-        int nodeId = qstring.toInt();
-
-        put_flog(LOG_INFO, "%i cases for nodeId %i", num, nodeId);
-
         EpidemicCasesWidget * casesWidget = new EpidemicCasesWidget(simulation);
 
         casesWidgets_.push_back(casesWidget);
         layout_.addWidget(casesWidget);
 
-        casesWidget->setNumCases(num);
-        casesWidget->setNodeId(nodeId);
+        casesWidget->setNumCases(cases[i].num);
+        casesWidget->setNodeId(cases[i].nodeId);
     }
 }
 
@@ -0,0 +1,240 @@
+#include "EpidemicOutputSink.h"
+#include "EpidemicCsvOutputSink.h"
+#include "EpidemicBinaryOutputSink.h"
+#include "EpidemicDataSet.h"
+#include "log.h"
+#include <boost/bind.hpp>
+
+const int EpidemicOutputSink::maxQueuedTimes_ = 8;
+
+EpidemicOutputSink::EpidemicOutputSink(const std::string &varName, const std::string &filename)
+{
+    varName_ = varName;
+    filename_ = filename;
+    isOpen_ = false;
+    closing_ = false;
+    error_ = false;
+}
+
+EpidemicOutputSink::~EpidemicOutputSink()
+{
+    if(isOpen_ == true)
+    {
+        put_flog(LOG_ERROR, "sink for %s was not closed", filename_.c_str());
+    }
+}
+
+std::string EpidemicOutputSink::getVariableName()
+{
+    return varName_;
+}
+
+std::string EpidemicOutputSink::getFilename()
+{
+    return filename_;
+}
+
+bool EpidemicOutputSink::open(const std::vector<int> &nodeIds, const std::vector<std::vector<std::string> > &stratifications)
+{
+    if(isOpen_ == true)
+    {
+        put_flog(LOG_ERROR, "%s is already open", filename_.c_str());
+        return false;
+    }
+
+    if(stratifications.size() < 2)
+    {
+        put_flog(LOG_ERROR, "need at least 2 stratifications");
+        return false;
+    }
+
+    nodeIds_ = nodeIds;
+    stratifications_ = std::vector<std::vector<std::string> >(stratifications.begin(), stratifications.begin() + 2);
+
+    // the buffer must be set before the file is opened
+    buffer_.resize(1 << 20);
+    out_.rdbuf()->pubsetbuf(&buffer_[0], buffer_.size());
+
+    out_.open(filename_.c_str(), std::ios::out | std::ios::binary);
+
+    if(out_.is_open() != true)
+    {
+        put_flog(LOG_ERROR, "could not open file %s", filename_.c_str());
+        return false;
+    }
+
+    if(writeHeader() != true)
+    {
+        put_flog(LOG_ERROR, "could not write header to %s", filename_.c_str());
+        out_.close();
+        return false;
+    }
+
+    isOpen_ = true;
+    closing_ = false;
+    error_ = false;
+
+    thread_ = boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&EpidemicOutputSink::writerThread, this)));
+
+    return true;
+}
+
+bool EpidemicOutputSink::open(EpidemicDataSet &dataSet)
+{
+    return open(dataSet.getNodeIds(), EpidemicDataSet::getStratifications());
+}
+
+bool EpidemicOutputSink::write(int time, const std::vector<float> &values)
+{
+    if(isOpen_ != true)
+    {
+        put_flog(LOG_ERROR, "%s is not open", filename_.c_str());
+        return false;
+    }
+
+    if(values.size() != stratifications_[0].size() * stratifications_[1].size() * nodeIds_.size())
+    {
+        put_flog(LOG_ERROR, "wrong number of values for %s: %i", filename_.c_str(), (int)values.size());
+        return false;
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+
+    while((int)queue_.size() >= maxQueuedTimes_ && error_ != true)
+    {
+        condition_.wait(lock);
+    }
+
+    if(error_ == true)
+    {
+        return false;
+    }
+
+    queue_.push_back(std::pair<int, std::vector<float> >(time, values));
+
+    condition_.notify_all();
+
+    return true;
+}
+
+bool EpidemicOutputSink::write(EpidemicDataSet &dataSet, int time)
+{
+    if(isOpen_ != true)
+    {
+        put_flog(LOG_ERROR, "%s is not open", filename_.c_str());
+        return false;
+    }
+
+    // values ordered as [stratification 0][stratification 1][node index]
+    std::vector<float> values;
+    values.reserve(stratifications_[0].size() * stratifications_[1].size() * nodeIds_.size());
+
+    std::vector<int> stratificationValues(2, 0);
+
+    for(unsigned int s0=0; s0<stratifications_[0].size(); s0++)
+    {
+        stratificationValues[0] = s0;
+
+        for(unsigned int s1=0; s1<stratifications_[1].size(); s1++)
+        {
+            stratificationValues[1] = s1;
+
+            for(unsigned int n=0; n<nodeIds_.size(); n++)
+            {
+                values.push_back(dataSet.getValue(varName_, time, nodeIds_[n], stratificationValues));
+            }
+        }
+    }
+
+    return write(time, values);
+}
+
+bool EpidemicOutputSink::close()
+{
+    if(isOpen_ != true)
+    {
+        return false;
+    }
+
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+
+        closing_ = true;
+
+        condition_.notify_all();
+    }
+
+    thread_->join();
+    thread_.reset();
+
+    out_.close();
+
+    isOpen_ = false;
+
+    if(error_ == true || out_.fail() == true)
+    {
+        put_flog(LOG_ERROR, "error writing %s", filename_.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+boost::shared_ptr<EpidemicOutputSink> EpidemicOutputSink::create(const std::string &varName, const std::string &filename)
+{
+    std::string extension = ".bin";
+
+    if(filename.size() >= extension.size() && filename.compare(filename.size() - extension.size(), extension.size(), extension) == 0)
+    {
+        return boost::shared_ptr<EpidemicOutputSink>(new EpidemicBinaryOutputSink(varName, filename));
+    }
+
+    return boost::shared_ptr<EpidemicOutputSink>(new EpidemicCsvOutputSink(varName, filename));
+}
+
+void EpidemicOutputSink::writerThread()
+{
+    while(true)
+    {
+        std::pair<int, std::vector<float> > entry;
+
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+
+            while(queue_.size() == 0 && closing_ != true)
+            {
+                condition_.wait(lock);
+            }
+
+            if(queue_.size() == 0)
+            {
+                return;
+            }
+
+            entry.first = queue_.front().first;
+            entry.second.swap(queue_.front().second);
+
+            queue_.pop_front();
+
+            // room for another time step
+            condition_.notify_all();
+        }
+
+        bool success = writeTime(entry.first, entry.second) && out_.good();
+
+        if(success != true)
+        {
+            boost::mutex::scoped_lock lock(mutex_);
+
+            put_flog(LOG_ERROR, "could not write time %i to %s", entry.first, filename_.c_str());
+
+            // discard the rest of the output
+            error_ = true;
+            queue_.clear();
+
+            condition_.notify_all();
+
+            return;
+        }
+    }
+}
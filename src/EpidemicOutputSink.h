@@ -0,0 +1,90 @@
+#ifndef EPIDEMIC_OUTPUT_SINK_H
+#define EPIDEMIC_OUTPUT_SINK_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+class EpidemicDataSet;
+
+// output of a variable, written one time step at a time as a simulation progresses
+// values are stratified by the first two stratifications for each node: [stratification 0][stratification 1][node index]
+// write() only copies the values of a time step; formatting and file I/O happen in a background thread,
+// so output overlaps with the simulation and only a few time steps are held in memory
+// subclasses implement the file format, and must call close() in their destructor
+class EpidemicOutputSink
+{
+    public:
+
+        EpidemicOutputSink(const std::string &varName, const std::string &filename);
+        virtual ~EpidemicOutputSink();
+
+        std::string getVariableName();
+        std::string getFilename();
+
+        // open the file and write the header
+        bool open(const std::vector<int> &nodeIds, const std::vector<std::vector<std::string> > &stratifications);
+
+        // same as above, for the nodes and stratifications of a data set
+        bool open(EpidemicDataSet &dataSet);
+
+        // queue a time step for output; time steps should be written in order
+        // this blocks while the background thread is maxQueuedTimes_ time steps behind
+        bool write(int time, const std::vector<float> &values);
+
+        // same as above, getting the values of the variable from a data set
+        bool write(EpidemicDataSet &dataSet, int time);
+
+        // wait for queued time steps to be written and close the file
+        // returns false if any write failed
+        bool close();
+
+        // a binary sink for filenames ending in ".bin", otherwise a CSV sink
+        static boost::shared_ptr<EpidemicOutputSink> create(const std::string &varName, const std::string &filename);
+
+    protected:
+
+        // buffered output file
+        std::ofstream out_;
+
+        std::vector<int> nodeIds_;
+
+        // the first two stratifications
+        std::vector<std::vector<std::string> > stratifications_;
+
+        // called by open()
+        virtual bool writeHeader() = 0;
+
+        // called from the background thread
+        virtual bool writeTime(int time, const std::vector<float> &values) = 0;
+
+    private:
+
+        // maximum number of time steps waiting to be written
+        static const int maxQueuedTimes_;
+
+        std::string varName_;
+        std::string filename_;
+
+        std::vector<char> buffer_;
+
+        bool isOpen_;
+
+        // state shared with the background thread
+        boost::mutex mutex_;
+        boost::condition_variable condition_;
+        std::deque<std::pair<int, std::vector<float> > > queue_;
+        bool closing_;
+        bool error_;
+
+        boost::shared_ptr<boost::thread> thread_;
+
+        void writerThread();
+};
+
+#endif
@@ -1,6 +1,16 @@
 #include "EpidemicSimulation.h"
 #include "StockpileNetwork.h"
+#include "Checkpoint.h"
+#include "Instrumentation.h"
 #include "log.h"
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+
+// checkpoint file header: magic, then version
+static const char checkpointMagic[8] = { 'E', 'P', 'I', 'C', 'K', 'P', 'T', '\0' };
+static const boost::uint32_t checkpointVersion = 6;
 
 EpidemicSimulation::EpidemicSimulation()
 {
@@ -16,6 +26,36 @@ EpidemicSimulation::EpidemicSimulation()
     // an empty exposed variable
     newVariable("exposed");
 
+    susceptibleHandle_ = getVariableHandle("susceptible");
+    exposedHandle_ = getVariableHandle("exposed");
+
+    createStockpileNetwork();
+}
+
+EpidemicSimulation::EpidemicSimulation(EpidemicSimulation &simulation) : EpidemicDataSet(simulation)
+{
+    put_flog(LOG_DEBUG, "");
+
+    susceptibleHandle_ = simulation.susceptibleHandle_;
+    exposedHandle_ = simulation.exposedHandle_;
+
+    // the network references its data set, so the fork gets a network of the same stockpiles with a copy of their state
+    createStockpileNetwork();
+
+    std::stringstream stream(std::ios::in | std::ios::out | std::ios::binary);
+
+    CheckpointWriter writer(stream);
+    CheckpointReader reader(stream);
+
+    if(simulation.stockpileNetwork_->writeCheckpoint(writer) != true || stockpileNetwork_->readCheckpoint(reader) != true)
+    {
+        put_flog(LOG_ERROR, "could not copy stockpile network");
+        isValid_ = false;
+    }
+}
+
+void EpidemicSimulation::createStockpileNetwork()
+{
     // create basic StockpileNetwork
     boost::shared_ptr<StockpileNetwork> stockpileNetwork(new StockpileNetwork(this));
 
@@ -42,7 +82,7 @@ EpidemicSimulation::EpidemicSimulation()
 
 int EpidemicSimulation::expose(int num, int nodeId, std::vector<int> stratificationValues)
 {
-    return transition(num, "susceptible", "exposed", nodeId, stratificationValues);
+    return transition(num, susceptibleHandle_, exposedHandle_, nodeIdToIndex_[nodeId], stratificationValues);
 }
 
 
@@ -53,44 +93,172 @@ void EpidemicSimulation::simulate()
     numTimes_++;
 
     // copy all variables to a new time
-    std::map<std::string, blitz::Array<float, 2+NUM_STRATIFICATION_DIMENSIONS> >::iterator iter;
-
-    for(iter=variables_.begin(); iter!=variables_.end(); iter++)
     {
-        copyVariableToNewTimeStep(iter->first);
+        InstrumentationTimer timer(instrumentation_.get(), "copy variables");
+
+        std::map<std::string, EpidemicVariable>::iterator iter;
+
+        for(iter=variables_.begin(); iter!=variables_.end(); iter++)
+        {
+            copyVariableToNewTimeStep(iter->first);
+        }
     }
 
     // evolve stockpile network
-    stockpileNetwork_->evolve(numTimes_-1);
+    {
+        InstrumentationTimer timer(instrumentation_.get(), "stockpile evolve");
+
+        stockpileNetwork_->evolve(numTimes_-1);
+    }
+}
+
+void EpidemicSimulation::setInstrumentation(boost::shared_ptr<Instrumentation> instrumentation)
+{
+    instrumentation_ = instrumentation;
+}
+
+bool EpidemicSimulation::saveCheckpoint(const std::string &filename)
+{
+    // write to a temporary file, so an interrupted write doesn't destroy an earlier checkpoint
+    std::string temporaryFilename = filename + ".tmp";
+
+    {
+        std::ofstream out(temporaryFilename.c_str(), std::ios::out | std::ios::binary);
+
+        if(out.is_open() != true)
+        {
+            put_flog(LOG_ERROR, "could not open file %s", temporaryFilename.c_str());
+            return false;
+        }
+
+        out.write(checkpointMagic, sizeof(checkpointMagic));
+
+        CheckpointWriter writer(out);
+
+        writer.write(checkpointVersion);
+
+        if(writeCheckpoint(writer) != true)
+        {
+            put_flog(LOG_ERROR, "could not write checkpoint %s", temporaryFilename.c_str());
+            return false;
+        }
+
+        out.close();
+
+        if(out.fail() == true)
+        {
+            put_flog(LOG_ERROR, "error writing %s", temporaryFilename.c_str());
+            return false;
+        }
+    }
+
+    // rename() doesn't replace existing files on all platforms
+    remove(filename.c_str());
+
+    if(rename(temporaryFilename.c_str(), filename.c_str()) != 0)
+    {
+        put_flog(LOG_ERROR, "could not rename %s to %s", temporaryFilename.c_str(), filename.c_str());
+        return false;
+    }
+
+    put_flog(LOG_INFO, "saved checkpoint at time %i to %s", numTimes_-1, filename.c_str());
+
+    return true;
+}
+
+bool EpidemicSimulation::loadCheckpoint(const std::string &filename)
+{
+    std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+
+    if(in.is_open() != true)
+    {
+        put_flog(LOG_ERROR, "could not open file %s", filename.c_str());
+        return false;
+    }
+
+    char magic[sizeof(checkpointMagic)];
+    in.read(magic, sizeof(magic));
+
+    CheckpointReader reader(in);
+
+    boost::uint32_t version;
+
+    if(in.good() != true || memcmp(magic, checkpointMagic, sizeof(magic)) != 0 || reader.read(version) != true || version != checkpointVersion)
+    {
+        put_flog(LOG_ERROR, "%s is not a checkpoint of version %i", filename.c_str(), checkpointVersion);
+        return false;
+    }
+
+    if(readCheckpoint(reader) != true)
+    {
+        put_flog(LOG_ERROR, "could not restore checkpoint %s", filename.c_str());
+        return false;
+    }
+
+    put_flog(LOG_INFO, "restored checkpoint at time %i from %s", numTimes_-1, filename.c_str());
+
+    return true;
+}
+
+bool EpidemicSimulation::writeCheckpoint(CheckpointWriter &out)
+{
+    if(EpidemicDataSet::writeCheckpoint(out) != true)
+    {
+        return false;
+    }
+
+    return stockpileNetwork_->writeCheckpoint(out);
+}
+
+bool EpidemicSimulation::readCheckpoint(CheckpointReader &in)
+{
+    if(EpidemicDataSet::readCheckpoint(in) != true)
+    {
+        return false;
+    }
+
+    return stockpileNetwork_->readCheckpoint(in);
 }
 
 int EpidemicSimulation::transition(int num, std::string sourceVarName, std::string destVarName, int nodeId, std::vector<int> stratificationValues)
 {
-    blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> sourceVarAtFinalTime = getVariableAtFinalTime(sourceVarName);
-    blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> destVarAtFinalTime = getVariableAtFinalTime(destVarName);
+    EpidemicVariableHandle sourceVar = getVariableHandle(sourceVarName);
+    EpidemicVariableHandle destVar = getVariableHandle(destVarName);
 
-    if(sourceVarAtFinalTime.size() == 0 || destVarAtFinalTime.size() == 0)
+    return transition(num, sourceVar, destVar, nodeIdToIndex_[nodeId], stratificationValues);
+}
+
+int EpidemicSimulation::transition(int num, const EpidemicVariableHandle &sourceVar, const EpidemicVariableHandle &destVar, int nodeIndex, const std::vector<int> &stratificationValues)
+{
+    if(sourceVar.isValid() != true || destVar.isValid() != true)
     {
         put_flog(LOG_ERROR, "could not transition, one of the variables does not exist");
-        return 0.;
+        return 0;
     }
 
+    // transitions happen at the final time
+    EpidemicVariable &source = getVariable(sourceVar);
+    EpidemicVariable &dest = getVariable(destVar);
+
+    int time = source.getNumTimes() - 1;
+
     // todo: validate nodeIndex, stratification values are in bounds
 
-    int numSourceVar = sourceVarAtFinalTime(nodeIdToIndex_[nodeId], BOOST_PP_ENUM(NUM_STRATIFICATION_DIMENSIONS, VECTOR_TO_ARGS, stratificationValues));
+    int numSourceVar = (int)source(time, nodeIndex, BOOST_PP_ENUM(NUM_STRATIFICATION_DIMENSIONS, VECTOR_TO_ARGS, stratificationValues));
 
     int numTransition = num;
 
     if(numTransition > numSourceVar)
     {
-        put_flog(LOG_WARN, "bounding transition amount of %i to source quantity %i (%s -> %s)", num, numSourceVar, sourceVarName.c_str(), destVarName.c_str());
+        put_flog(LOG_WARN, "bounding transition amount of %i to source quantity %i (%s -> %s)", num, numSourceVar, getVariableName(sourceVar).c_str(), getVariableName(destVar).c_str());
 
         numTransition = numSourceVar;
     }
 
-    sourceVarAtFinalTime(nodeIdToIndex_[nodeId], BOOST_PP_ENUM(NUM_STRATIFICATION_DIMENSIONS, VECTOR_TO_ARGS, stratificationValues)) -= numTransition;
+    // add() keeps the variables' marginals current
+    source.add(time, nodeIndex, BOOST_PP_ENUM(NUM_STRATIFICATION_DIMENSIONS, VECTOR_TO_ARGS, stratificationValues), -(float)numTransition);
 
-    destVarAtFinalTime(nodeIdToIndex_[nodeId], BOOST_PP_ENUM(NUM_STRATIFICATION_DIMENSIONS, VECTOR_TO_ARGS, stratificationValues)) += numTransition;
+    dest.add(time, nodeIndex, BOOST_PP_ENUM(NUM_STRATIFICATION_DIMENSIONS, VECTOR_TO_ARGS, stratificationValues), (float)numTransition);
 
     return numTransition;
 }
@@ -3,6 +3,8 @@
 
 #include "EpidemicDataSet.h"
 
+class Instrumentation;
+
 class EpidemicSimulation : public EpidemicDataSet
 {
     public:
@@ -15,10 +17,45 @@ class EpidemicSimulation : public EpidemicDataSet
 
         virtual void simulate();
 
+        // time the phases of each time step and count what they do; NULL (the default) disables this
+        // a fork of the simulation has no instrumentation
+        void setInstrumentation(boost::shared_ptr<Instrumentation> instrumentation);
+
+        // save the complete state of the simulation to a binary checkpoint file
+        // this should be done between time steps; the file is replaced only once it is completely written
+        bool saveCheckpoint(const std::string &filename);
+
+        // restore a checkpoint into a newly constructed simulation of the same model, with the same input data and parameters
+        // the restored simulation continues exactly as the saved one would have
+        // on failure the simulation may be partially restored, and should be discarded
+        bool loadCheckpoint(const std::string &filename);
+
     protected:
 
+        // a fork of a simulation, sharing the history of its variables (see EpidemicDataSet)
+        // the stockpile network is copied
+        EpidemicSimulation(EpidemicSimulation &simulation);
+
+        boost::shared_ptr<Instrumentation> instrumentation_;
+
+        // handles for the generic variables
+        EpidemicVariableHandle susceptibleHandle_;
+        EpidemicVariableHandle exposedHandle_;
+
         int transition(int num, std::string sourceVarName, std::string destVarName, int nodeId, std::vector<int> stratificationValues);
 
+        // same as above, using variable handles and a node index (not a node id); this avoids all map lookups
+        int transition(int num, const EpidemicVariableHandle &sourceVar, const EpidemicVariableHandle &destVar, int nodeIndex, const std::vector<int> &stratificationValues);
+
+        // variables and the stockpile network
+        virtual bool writeCheckpoint(CheckpointWriter &out);
+        virtual bool readCheckpoint(CheckpointReader &in);
+
+    private:
+
+        // the central stockpile and a stockpile for each group
+        void createStockpileNetwork();
+
 };
 
 #endif
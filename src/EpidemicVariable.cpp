@@ -0,0 +1,476 @@
+#include "EpidemicVariable.h"
+#include "EpidemicDataSet.h"
+#include "log.h"
+
+const int EpidemicVariable::minimumChunkNumTimes_ = 32;
+
+EpidemicVariable::EpidemicVariable()
+{
+    shape_ = 0;
+    chunkStartTime_ = 0;
+    marginals_ = boost::shared_ptr<Marginals>(new Marginals());
+}
+
+EpidemicVariable::EpidemicVariable(const blitz::TinyVector<int, 1+NUM_STRATIFICATION_DIMENSIONS> &shape, int numTimes, int capacity)
+{
+    shape_ = shape;
+    chunkStartTime_ = 0;
+    marginals_ = boost::shared_ptr<Marginals>(new Marginals());
+
+    reserve(capacity > numTimes ? capacity : numTimes);
+
+    // new chunks are initialized to zero
+    for(int t=0; t<numTimes; t++)
+    {
+        addTime();
+    }
+}
+
+EpidemicVariable::EpidemicVariable(const blitz::Array<float, 2+NUM_STRATIFICATION_DIMENSIONS> &array)
+{
+    for(int j=0; j<1+NUM_STRATIFICATION_DIMENSIONS; j++)
+    {
+        shape_(j) = array.extent(1 + j);
+    }
+
+    chunkStartTime_ = 0;
+    marginals_ = boost::shared_ptr<Marginals>(new Marginals());
+
+    reserve(array.extent(0));
+
+    for(int t=0; t<array.extent(0); t++)
+    {
+        addTime();
+
+        times_[t] = array(t, blitz::Range::all(), BOOST_PP_ENUM(NUM_STRATIFICATION_DIMENSIONS, TEXT, blitz::Range::all()));
+    }
+}
+
+EpidemicVariable::EpidemicVariable(const blitz::TinyVector<int, 1+NUM_STRATIFICATION_DIMENSIONS> &shape, int numTimes, boost::shared_ptr<EpidemicVariableStore> store, int cacheNumTimes)
+{
+    shape_ = shape;
+    chunkStartTime_ = 0;
+    marginals_ = boost::shared_ptr<Marginals>(new Marginals());
+
+    storeCache_ = boost::shared_ptr<StoreCache>(new StoreCache());
+    storeCache_->store = store;
+    storeCache_->times.resize(numTimes);
+    storeCache_->residentPositions.resize(numTimes, storeCache_->residentTimes.end());
+    storeCache_->cacheNumTimes = (cacheNumTimes > 0 ? cacheNumTimes : 1);
+    storeCache_->numCachedTimes = 0;
+
+    // marginals are built on first use
+    marginals_->valid.resize(numTimes, 0);
+    marginals_->values.resize(numTimes);
+}
+
+EpidemicVariable & EpidemicVariable::operator=(const EpidemicVariable &variable)
+{
+    if(this == &variable)
+    {
+        return *this;
+    }
+
+    shape_ = variable.shape_;
+
+    // copy-construct the time arrays so they reference the same data
+    std::vector<blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> > times(variable.times_);
+    times_.swap(times);
+
+    chunk_.reference(variable.chunk_);
+    chunkStartTime_ = variable.chunkStartTime_;
+
+    marginals_ = variable.marginals_;
+    storeCache_ = variable.storeCache_;
+    history_ = variable.history_;
+
+    return *this;
+}
+
+int EpidemicVariable::getNumTimes() const
+{
+    if(storeCache_ != NULL)
+    {
+        return (int)storeCache_->times.size();
+    }
+
+    return (int)times_.size();
+}
+
+blitz::TinyVector<int, 1+NUM_STRATIFICATION_DIMENSIONS> EpidemicVariable::getShape() const
+{
+    return shape_;
+}
+
+void EpidemicVariable::reserve(int numTimes)
+{
+    // variables read on demand have a fixed number of time steps
+    if(storeCache_ != NULL)
+    {
+        return;
+    }
+
+    int capacity = chunkStartTime_ + chunk_.extent(0);
+
+    if(numTimes <= capacity)
+    {
+        return;
+    }
+
+    // a new chunk starts at the next time step; any unused time steps in the current chunk are not used
+    int chunkNumTimes = numTimes - getNumTimes();
+
+    blitz::TinyVector<int, 2+NUM_STRATIFICATION_DIMENSIONS> chunkShape;
+    chunkShape(0) = chunkNumTimes;
+
+    for(int j=0; j<1+NUM_STRATIFICATION_DIMENSIONS; j++)
+    {
+        chunkShape(1 + j) = shape_(j);
+    }
+
+    blitz::Array<float, 2+NUM_STRATIFICATION_DIMENSIONS> chunk(chunkShape);
+
+    chunk = 0.;
+
+    chunk_.reference(chunk);
+    chunkStartTime_ = getNumTimes();
+}
+
+void EpidemicVariable::appendTime()
+{
+    if(getNumTimes() == 0)
+    {
+        put_flog(LOG_ERROR, "no time step to copy");
+        return;
+    }
+
+    if(storeCache_ != NULL)
+    {
+        put_flog(LOG_ERROR, "cannot append to a variable read on demand");
+        return;
+    }
+
+    addTime();
+
+    int time = getNumTimes() - 1;
+
+    times_[time] = times_[time - 1];
+
+    // the copied values have the same marginals
+    if(marginals_->valid[time - 1] != 0)
+    {
+        marginals_->values[time] = marginals_->values[time - 1];
+        marginals_->valid[time] = marginals_->valid[time - 1];
+    }
+}
+
+EpidemicVariable EpidemicVariable::copy() const
+{
+    EpidemicVariable variable(shape_, 0, getNumTimes());
+
+    for(int t=0; t<getNumTimes(); t++)
+    {
+        variable.addTime();
+
+        variable.times_[t] = getTime(t);
+
+        variable.marginals_->valid[t] = marginals_->valid[t];
+        variable.marginals_->values[t] = marginals_->values[t];
+    }
+
+    return variable;
+}
+
+EpidemicVariable EpidemicVariable::fork(int capacity)
+{
+    // variables read on demand are read-only, but their cache can't be shared
+    if(storeCache_ != NULL)
+    {
+        return copy();
+    }
+
+    if(getNumTimes() == 0)
+    {
+        return EpidemicVariable(shape_, 0, capacity);
+    }
+
+    int finalTime = getNumTimes() - 1;
+    int numHistoryTimes = (history_ != NULL ? history_->numTimes : 0);
+
+    // add the time steps since the last fork to the history, replacing their arrays with views
+    if(finalTime > numHistoryTimes)
+    {
+        boost::shared_ptr<History> history(new History());
+
+        history->previous = history_;
+        history->times.assign(times_.begin() + numHistoryTimes, times_.begin() + finalTime);
+        history->numTimes = finalTime;
+
+        for(int t=numHistoryTimes; t<finalTime; t++)
+        {
+            blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> view(times_[t].data(), shape_, blitz::neverDeleteData);
+
+            times_[t].reference(view);
+        }
+
+        history_ = history;
+    }
+
+    // the final time step is copied to a new chunk in both variables, so no later time step references a chunk of the history
+    if(chunkStartTime_ != finalTime)
+    {
+        moveFinalTime(chunkStartTime_ + chunk_.extent(0));
+    }
+
+    EpidemicVariable variable;
+
+    variable.shape_ = shape_;
+    variable.history_ = history_;
+
+    // the variable gets its own views of the shared time steps: a view still has a reference counted memory block,
+    // and the counts are not atomic, so copying this variable's views would share the counts between the variables
+    variable.times_.reserve(getNumTimes());
+
+    for(int t=0; t<finalTime; t++)
+    {
+        blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> view(times_[t].data(), shape_, blitz::neverDeleteData);
+
+        variable.times_.push_back(view);
+    }
+
+    // the final time step is copied to a chunk of its own below
+    variable.times_.push_back(times_[finalTime]);
+
+    // marginals of the shared time steps are built again when needed, since they are built lazily and per variable
+    variable.marginals_->valid.resize(getNumTimes(), 0);
+    variable.marginals_->values.resize(getNumTimes());
+
+    variable.marginals_->valid[finalTime] = marginals_->valid[finalTime];
+    variable.marginals_->values[finalTime] = marginals_->values[finalTime];
+
+    variable.moveFinalTime(capacity > getNumTimes() ? capacity : getNumTimes());
+
+    return variable;
+}
+
+blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> EpidemicVariable::getTime(int time) const
+{
+    if(storeCache_ != NULL)
+    {
+        return getStoredTime(time);
+    }
+
+    return times_[time];
+}
+
+blitz::Array<float, 2+NUM_STRATIFICATION_DIMENSIONS> EpidemicVariable::getArray() const
+{
+    blitz::TinyVector<int, 2+NUM_STRATIFICATION_DIMENSIONS> arrayShape;
+    arrayShape(0) = getNumTimes();
+
+    for(int j=0; j<1+NUM_STRATIFICATION_DIMENSIONS; j++)
+    {
+        arrayShape(1 + j) = shape_(j);
+    }
+
+    blitz::Array<float, 2+NUM_STRATIFICATION_DIMENSIONS> array(arrayShape);
+
+    for(int t=0; t<getNumTimes(); t++)
+    {
+        array(t, blitz::Range::all(), BOOST_PP_ENUM(NUM_STRATIFICATION_DIMENSIONS, TEXT, blitz::Range::all())) = getTime(t);
+    }
+
+    return array;
+}
+
+float EpidemicVariable::getGroupMarginal(int time, const std::vector<int> &nodeGroups, int numGroups, int group, int s0, int s1)
+{
+    int nodeSize = getMarginalsNodeSize();
+
+    // the sums over groups follow the marginals of the nodes
+    int groupsOffset = shape_(0) * nodeSize;
+    int size = groupsOffset + (numGroups + 1) * nodeSize;
+
+    if(marginals_->valid[time] != 2 || (int)marginals_->values[time].size() != size)
+    {
+        if(marginals_->valid[time] == 0)
+        {
+            buildMarginals(time);
+        }
+
+        std::vector<float> &values = marginals_->values[time];
+
+        // sum in double precision, as for many nodes the sums are much larger than the marginals of a node
+        std::vector<double> sums((numGroups + 1) * nodeSize, 0.);
+
+        for(int n=0; n<shape_(0); n++)
+        {
+            const float * nodeMarginals = &values[n * nodeSize];
+
+            double * allSums = &sums[numGroups * nodeSize];
+
+            for(int i=0; i<nodeSize; i++)
+            {
+                allSums[i] += nodeMarginals[i];
+            }
+
+            if(n < (int)nodeGroups.size() && nodeGroups[n] >= 0 && nodeGroups[n] < numGroups)
+            {
+                double * groupSums = &sums[nodeGroups[n] * nodeSize];
+
+                for(int i=0; i<nodeSize; i++)
+                {
+                    groupSums[i] += nodeMarginals[i];
+                }
+            }
+        }
+
+        values.resize(size);
+
+        for(unsigned int i=0; i<sums.size(); i++)
+        {
+            values[groupsOffset + i] = (float)sums[i];
+        }
+
+        marginals_->valid[time] = 2;
+    }
+
+    int g = (group == NODES_ALL ? numGroups : group);
+    int i0 = (s0 == STRATIFICATIONS_ALL ? shape_(1) : s0);
+    int i1 = (s1 == STRATIFICATIONS_ALL ? shape_(2) : s1);
+
+    return marginals_->values[time][groupsOffset + g * nodeSize + i0 * (shape_(2) + 1) + i1];
+}
+
+void EpidemicVariable::invalidateMarginals(int time)
+{
+    marginals_->valid[time] = 0;
+}
+
+void EpidemicVariable::buildMarginals(int time)
+{
+    int numS1 = shape_(2) + 1;
+
+    std::vector<float> &values = marginals_->values[time];
+
+    values.assign(shape_(0) * getMarginalsNodeSize(), 0.);
+
+    // accumulate each element into its four marginals
+    blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> timeArray = getTime(time);
+
+    for(blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS>::const_iterator iter=timeArray.begin(); iter!=timeArray.end(); iter++)
+    {
+        const blitz::TinyVector<int, 1+NUM_STRATIFICATION_DIMENSIONS> &position = iter.position();
+
+        float * nodeMarginals = &values[position(0) * getMarginalsNodeSize()];
+
+        nodeMarginals[position(1) * numS1 + position(2)] += *iter;
+        nodeMarginals[position(1) * numS1 + shape_(2)] += *iter;
+        nodeMarginals[shape_(1) * numS1 + position(2)] += *iter;
+        nodeMarginals[shape_(1) * numS1 + shape_(2)] += *iter;
+    }
+
+    marginals_->valid[time] = 1;
+}
+
+blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> & EpidemicVariable::getStoredTime(int time) const
+{
+    StoreCache &cache = *storeCache_;
+
+    if(cache.residentPositions[time] != cache.residentTimes.end())
+    {
+        // now the most recently used; splicing keeps the positions of all time steps valid
+        cache.residentTimes.splice(cache.residentTimes.begin(), cache.residentTimes, cache.residentPositions[time]);
+
+        return cache.times[time];
+    }
+
+    // evict the least recently used time step
+    // its marginals are discarded as well, so memory stays bounded by the cache size
+    if(cache.numCachedTimes >= cache.cacheNumTimes)
+    {
+        int evictTime = cache.residentTimes.back();
+
+        cache.residentTimes.pop_back();
+        cache.residentPositions[evictTime] = cache.residentTimes.end();
+
+        cache.times[evictTime].reference(blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS>());
+        cache.numCachedTimes--;
+
+        marginals_->valid[evictTime] = 0;
+        std::vector<float>().swap(marginals_->values[evictTime]);
+    }
+
+    blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> timeArray(shape_);
+
+    timeArray = 0.;
+
+    if(cache.store->readTime(time, timeArray) != true)
+    {
+        put_flog(LOG_ERROR, "could not read time %i, using zeros", time);
+    }
+
+    cache.times[time].reference(timeArray);
+    cache.residentTimes.push_front(time);
+    cache.residentPositions[time] = cache.residentTimes.begin();
+    cache.numCachedTimes++;
+
+    return cache.times[time];
+}
+
+void EpidemicVariable::addTime()
+{
+    int time = getNumTimes();
+
+    // grow geometrically: the new chunk at least doubles the capacity
+    if(time >= chunkStartTime_ + chunk_.extent(0))
+    {
+        int chunkNumTimes = time;
+
+        if(chunkNumTimes < minimumChunkNumTimes_)
+        {
+            chunkNumTimes = minimumChunkNumTimes_;
+        }
+
+        reserve(time + chunkNumTimes);
+    }
+
+    // this array references the chunk's data
+    blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> timeArray = chunk_(time - chunkStartTime_, blitz::Range::all(), BOOST_PP_ENUM(NUM_STRATIFICATION_DIMENSIONS, TEXT, blitz::Range::all()));
+
+    times_.push_back(timeArray);
+
+    // marginals are built on first use
+    marginals_->valid.push_back(0);
+    marginals_->values.push_back(std::vector<float>());
+}
+
+void EpidemicVariable::moveFinalTime(int capacity)
+{
+    int finalTime = getNumTimes() - 1;
+
+    blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> values = times_[finalTime];
+
+    char marginalsValid = marginals_->valid[finalTime];
+
+    std::vector<float> marginalValues;
+    marginalValues.swap(marginals_->values[finalTime]);
+
+    times_.pop_back();
+    marginals_->valid.pop_back();
+    marginals_->values.pop_back();
+
+    // start a new chunk at the final time step
+    chunk_.reference(blitz::Array<float, 2+NUM_STRATIFICATION_DIMENSIONS>());
+    chunkStartTime_ = finalTime;
+
+    reserve(capacity > finalTime + minimumChunkNumTimes_ ? capacity : finalTime + minimumChunkNumTimes_);
+
+    addTime();
+
+    // blitz array assignment copies the values
+    times_[finalTime] = values;
+
+    marginals_->valid[finalTime] = marginalsValid;
+    marginals_->values[finalTime].swap(marginalValues);
+}
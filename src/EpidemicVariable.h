@@ -0,0 +1,239 @@
+#ifndef EPIDEMIC_VARIABLE_H
+#define EPIDEMIC_VARIABLE_H
+
+#include "stratifications.h"
+#include "EpidemicVariableStore.h"
+#include <vector>
+#include <list>
+#include <blitz/array.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/preprocessor/repetition/enum_params.hpp>
+
+// a variable stored over time: [time][node][stratifications...]
+// time steps are stored in chunks of contiguous memory. chunks grow geometrically and are never reallocated,
+// so appending a time step is amortized O(1) and arrays returned by getTime() stay valid across appends.
+// as with blitz arrays, copies of a variable reference the same data; use copy() for a deep copy.
+//
+// each time step also has marginals: sums over the remaining stratifications for every node and every
+// (first stratification, second stratification) pair, either of which may be STRATIFICATIONS_ALL.
+// marginals are built on first use and kept current by add(). writes through operator() or getTime()
+// are not tracked; call invalidateMarginals() after them. sums of the marginals over groups of nodes and
+// over all nodes are built from them on first use, and discarded when the time step is written.
+//
+// a variable may also be read on demand from a store, keeping only the most recently used time steps in memory.
+// such variables are read-only and cannot be extended. arrays returned by getTime() stay valid after their
+// time step is evicted, but references returned by operator() must not be kept.
+//
+// fork() shares all time steps but the final one between two variables, which then extend independently.
+class EpidemicVariable
+{
+    public:
+
+        EpidemicVariable();
+
+        // numTimes time steps of the given shape ([node][stratifications...]), initialized to zero
+        // storage is reserved for at least capacity time steps
+        EpidemicVariable(const blitz::TinyVector<int, 1+NUM_STRATIFICATION_DIMENSIONS> &shape, int numTimes, int capacity=0);
+
+        // from an array with dimensions [time][node][stratifications...]; the data is copied
+        EpidemicVariable(const blitz::Array<float, 2+NUM_STRATIFICATION_DIMENSIONS> &array);
+
+        // numTimes time steps of the given shape, read on demand from store
+        // at most cacheNumTimes time steps are kept in memory; the least recently used are evicted first
+        EpidemicVariable(const blitz::TinyVector<int, 1+NUM_STRATIFICATION_DIMENSIONS> &shape, int numTimes, boost::shared_ptr<EpidemicVariableStore> store, int cacheNumTimes);
+
+        // assignment references the other variable's data (blitz array assignment would copy values)
+        EpidemicVariable & operator=(const EpidemicVariable &variable);
+
+        int getNumTimes() const;
+
+        // shape of a single time step: [node][stratifications...]
+        blitz::TinyVector<int, 1+NUM_STRATIFICATION_DIMENSIONS> getShape() const;
+
+        // reserve storage for a total of numTimes time steps
+        void reserve(int numTimes);
+
+        // append a time step, copying the values of the final time step
+        void appendTime();
+
+        // deep copy
+        EpidemicVariable copy() const;
+
+        // a variable sharing all time steps but the final one with this variable, with its own copy of the final time step
+        // the shared time steps become read-only in both variables, and are freed once no variable shares them
+        // arrays returned by getTime() for shared time steps are only valid as long as a variable sharing them exists
+        // the two variables can then be used concurrently; storage is reserved for at least capacity time steps
+        EpidemicVariable fork(int capacity=0);
+
+        // array for a time step, referencing the stored data: [node][stratifications...]
+        blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> getTime(int time) const;
+
+        // copy of all time steps: [time][node][stratifications...]
+        blitz::Array<float, 2+NUM_STRATIFICATION_DIMENSIONS> getArray() const;
+
+        // element access; there is no bounds checking
+        float & operator()(int time, int node, BOOST_PP_ENUM_PARAMS(NUM_STRATIFICATION_DIMENSIONS, int s))
+        {
+            if(storeCache_ != NULL)
+            {
+                return getStoredTime(time)(node, BOOST_PP_ENUM_PARAMS(NUM_STRATIFICATION_DIMENSIONS, s));
+            }
+
+            return times_[time](node, BOOST_PP_ENUM_PARAMS(NUM_STRATIFICATION_DIMENSIONS, s));
+        }
+
+        // add value to an element, updating the marginals of its node
+        // this may run concurrently for different nodes
+        void add(int time, int node, BOOST_PP_ENUM_PARAMS(NUM_STRATIFICATION_DIMENSIONS, int s), float value)
+        {
+            (*this)(time, node, BOOST_PP_ENUM_PARAMS(NUM_STRATIFICATION_DIMENSIONS, s)) += value;
+
+            if(marginals_->valid[time] != 0)
+            {
+                float * nodeMarginals = &marginals_->values[time][node * getMarginalsNodeSize()];
+
+                int numS1 = shape_(2) + 1;
+
+                nodeMarginals[s0 * numS1 + s1] += value;
+                nodeMarginals[s0 * numS1 + shape_(2)] += value;
+                nodeMarginals[shape_(1) * numS1 + s1] += value;
+                nodeMarginals[shape_(1) * numS1 + shape_(2)] += value;
+
+                // the sums over groups are not kept current, since nodes of a group may be written concurrently
+                if(marginals_->valid[time] == 2)
+                {
+                    marginals_->valid[time] = 1;
+                }
+            }
+        }
+
+        // sum over a node at a time, for first and second stratification values s0 and s1 (or STRATIFICATIONS_ALL)
+        // this builds the marginals of the time step if needed, so it must not run concurrently with writes to that time step
+        float getMarginal(int time, int node, int s0, int s1)
+        {
+            if(marginals_->valid[time] == 0)
+            {
+                buildMarginals(time);
+            }
+
+            int i0 = (s0 == STRATIFICATIONS_ALL ? shape_(1) : s0);
+            int i1 = (s1 == STRATIFICATIONS_ALL ? shape_(2) : s1);
+
+            return marginals_->values[time][node * getMarginalsNodeSize() + i0 * (shape_(2) + 1) + i1];
+        }
+
+        // sum over a group of nodes at a time, for first and second stratification values s0 and s1 (or STRATIFICATIONS_ALL)
+        // nodeGroups gives the group of each node in [0, numGroups), or -1 for none; group may be NODES_ALL for all nodes
+        // the sums of all groups are built together on first use, so the same nodeGroups must be given for all calls
+        // as for getMarginal(), this must not run concurrently with writes to the time step
+        float getGroupMarginal(int time, const std::vector<int> &nodeGroups, int numGroups, int group, int s0, int s1);
+
+        // discard the marginals of a time step after untracked writes; they are rebuilt when next used
+        void invalidateMarginals(int time);
+
+    private:
+
+        // minimum number of time steps in a chunk
+        static const int minimumChunkNumTimes_;
+
+        // shape of a single time step
+        blitz::TinyVector<int, 1+NUM_STRATIFICATION_DIMENSIONS> shape_;
+
+        // array for each time step, referencing the chunk it is stored in
+        std::vector<blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> > times_;
+
+        // the chunk new time steps are stored in: [time - chunkStartTime_][node][stratifications...]
+        // earlier chunks are kept alive by the arrays in times_
+        blitz::Array<float, 2+NUM_STRATIFICATION_DIMENSIONS> chunk_;
+        int chunkStartTime_;
+
+        // marginals for each time step: [node][first stratification or all][second stratification or all]
+        // once the sums over groups are built, these follow: [group or all nodes][first ...][second ...]
+        // these are shared by copies referencing the same data, like the data itself
+        struct Marginals
+        {
+            // 0: not built, 1: built for nodes, 2: built for nodes and groups
+            std::vector<char> valid;
+            std::vector<std::vector<float> > values;
+        };
+
+        boost::shared_ptr<Marginals> marginals_;
+
+        int getMarginalsNodeSize() const
+        {
+            return (shape_(1) + 1) * (shape_(2) + 1);
+        }
+
+        void buildMarginals(int time);
+
+        // time steps of variables read on demand; NULL for other variables
+        // this is shared by copies referencing the same data, like the data itself
+        struct StoreCache
+        {
+            boost::shared_ptr<EpidemicVariableStore> store;
+
+            // time steps in memory; empty arrays for time steps not in memory
+            std::vector<blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> > times;
+
+            // time steps in memory, most recently used first; the least recently used is evicted from the back
+            std::list<int> residentTimes;
+
+            // position of each time step in residentTimes; residentTimes.end() for time steps not in memory
+            std::vector<std::list<int>::iterator> residentPositions;
+
+            int cacheNumTimes;
+            int numCachedTimes;
+        };
+
+        boost::shared_ptr<StoreCache> storeCache_;
+
+        // time steps shared by forked variables: [0, numTimes)
+        // the arrays in times_ for these time steps are views, which don't reference count the chunks; only the history does.
+        // each variable has its own views, since the reference counts of blitz arrays are not atomic: arrays copied from
+        // them (e.g. by getTime()) only change counts of the variable's own views, so variables sharing the time steps can be
+        // used concurrently
+        struct History
+        {
+            // time steps shared by an earlier fork
+            boost::shared_ptr<const History> previous;
+
+            // arrays referencing the chunks of the time steps since the earlier fork
+            std::vector<blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> > times;
+
+            int numTimes;
+        };
+
+        boost::shared_ptr<const History> history_;
+
+        // array of a time step of a variable read on demand, reading it from the store if needed
+        blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> & getStoredTime(int time) const;
+
+        // add a time step at the end of the current chunk, growing storage if needed
+        void addTime();
+
+        // copy the final time step to a new chunk with room for a total of capacity time steps
+        void moveFinalTime(int capacity);
+};
+
+// handle to a regular variable of a data set; see EpidemicDataSet::getVariableHandle()
+// resolving a variable name once and indexing through its handle avoids string lookups in the simulation hot path
+class EpidemicVariableHandle
+{
+    public:
+
+        EpidemicVariableHandle() : index_(-1) { }
+
+        bool isValid() const
+        {
+            return index_ >= 0;
+        }
+
+    private:
+
+        friend class EpidemicDataSet;
+
+        // index into the data set's handle table
+        int index_;
+};
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef EPIDEMIC_VARIABLE_STORE_H
+#define EPIDEMIC_VARIABLE_STORE_H
+
+#include "stratifications.h"
+#include <blitz/array.h>
+
+// backing store of the time steps of a variable that is read on demand (see EpidemicVariable)
+class EpidemicVariableStore
+{
+    public:
+
+        virtual ~EpidemicVariableStore() { }
+
+        // read a time step into array, which has the shape of a time step ([node][stratifications...]) and contiguous storage
+        virtual bool readTime(int time, blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> &array) = 0;
+};
+
+#endif
@@ -2,6 +2,7 @@
 #include "EpidemicDataSet.h"
 #include "models/disease/StochasticSEATIRD.h"
 #include "MapShape.h"
+#include <algorithm>
 
 IliMapWidget::IliMapWidget()
 {
@@ -17,12 +18,16 @@ void IliMapWidget::setTime(int time)
     // recolor counties
     if(dataSet_ != NULL)
     {
+        // data sets without ILI reports (such as deterministic simulations) are rendered as having no providers
+        std::vector<std::string> variableNames = dataSet_->getVariableNames();
+        bool hasIli = (std::find(variableNames.begin(), variableNames.end(), "ILI reports") != variableNames.end());
+
         std::map<int, boost::shared_ptr<MapShape> >::iterator iter;
 
         for(iter=counties_.begin(); iter!=counties_.end(); iter++)
         {
             // render grayed out if county has no providers
-            bool hasProvider = true;
+            bool hasProvider = hasIli;
 
             boost::shared_ptr<StochasticSEATIRD> simulation = boost::dynamic_pointer_cast<StochasticSEATIRD>(dataSet_);
 
@@ -0,0 +1,409 @@
+#include "InputBundle.h"
+#include "main.h"
+#include "log.h"
+#include <fstream>
+#include <string.h>
+#include <sys/stat.h>
+#include <boost/crc.hpp>
+#include <boost/thread/mutex.hpp>
+
+const boost::uint32_t InputBundle::version_ = 1;
+
+// file layout: header, section table, then the data of each section at an 8-byte aligned offset
+struct InputBundleHeader
+{
+    char magic[8];
+
+    boost::uint32_t version;
+
+    // written as 0x01020304, to detect bundles written with another byte order
+    boost::uint32_t byteOrder;
+
+    boost::uint32_t numSections;
+
+    // CRC-32 of everything following the header
+    boost::uint32_t checksum;
+
+    boost::uint64_t fileSize;
+};
+
+struct InputBundleSection
+{
+    char name[48];
+    boost::uint64_t offset;
+    boost::uint64_t size;
+};
+
+static const char inputBundleMagic[8] = { 'E', 'P', 'I', 'B', 'N', 'D', 'L', '\0' };
+static const boost::uint32_t inputBundleByteOrder = 0x01020304;
+
+// the data directory bundle; see getDataDirectoryBundle()
+bool g_dataDirectoryBundleOpened = false;
+boost::shared_ptr<const InputBundle> g_dataDirectoryBundle;
+boost::mutex g_dataDirectoryBundleMutex;
+
+static size_t getAlignedOffset(size_t offset)
+{
+    return (offset + 7) & ~(size_t)7;
+}
+
+InputBundle::InputBundle()
+{
+
+}
+
+InputBundle::~InputBundle()
+{
+    // the sections reference the mapped region
+    sections_.clear();
+    region_.reset();
+    file_.reset();
+}
+
+bool InputBundle::open(const std::string &filename)
+{
+    sections_.clear();
+    region_.reset();
+    file_.reset();
+
+    // file_mapping throws if the file can't be opened
+    if(std::ifstream(filename.c_str()).is_open() != true)
+    {
+        return false;
+    }
+
+    try
+    {
+        file_ = boost::shared_ptr<boost::interprocess::file_mapping>(new boost::interprocess::file_mapping(filename.c_str(), boost::interprocess::read_only));
+        region_ = boost::shared_ptr<boost::interprocess::mapped_region>(new boost::interprocess::mapped_region(*file_, boost::interprocess::read_only));
+    }
+    catch(boost::interprocess::interprocess_exception &e)
+    {
+        put_flog(LOG_ERROR, "could not map file %s: %s", filename.c_str(), e.what());
+        region_.reset();
+        file_.reset();
+        return false;
+    }
+
+    const char * data = (const char *)region_->get_address();
+    size_t fileSize = region_->get_size();
+
+    if(fileSize < sizeof(InputBundleHeader))
+    {
+        put_flog(LOG_ERROR, "%s is too small", filename.c_str());
+        return false;
+    }
+
+    const InputBundleHeader * header = (const InputBundleHeader *)data;
+
+    if(memcmp(header->magic, inputBundleMagic, sizeof(inputBundleMagic)) != 0 || header->byteOrder != inputBundleByteOrder)
+    {
+        put_flog(LOG_ERROR, "%s is not an input bundle for this machine", filename.c_str());
+        return false;
+    }
+
+    if(header->version != version_)
+    {
+        put_flog(LOG_WARN, "%s has version %i, expected %i", filename.c_str(), (int)header->version, (int)version_);
+        return false;
+    }
+
+    if(header->fileSize != fileSize || sizeof(InputBundleHeader) + (size_t)header->numSections * sizeof(InputBundleSection) > fileSize)
+    {
+        put_flog(LOG_ERROR, "%s is truncated", filename.c_str());
+        return false;
+    }
+
+    boost::crc_32_type crc;
+    crc.process_bytes(data + sizeof(InputBundleHeader), fileSize - sizeof(InputBundleHeader));
+
+    if(crc.checksum() != header->checksum)
+    {
+        put_flog(LOG_ERROR, "%s failed its checksum", filename.c_str());
+        return false;
+    }
+
+    const InputBundleSection * sections = (const InputBundleSection *)(data + sizeof(InputBundleHeader));
+
+    for(unsigned int i=0; i<header->numSections; i++)
+    {
+        if(sections[i].offset > fileSize || sections[i].size > fileSize - sections[i].offset)
+        {
+            put_flog(LOG_ERROR, "section %i of %s is out of bounds", i, filename.c_str());
+            sections_.clear();
+            return false;
+        }
+
+        std::string name(sections[i].name, strnlen(sections[i].name, sizeof(sections[i].name)));
+
+        sections_[name] = std::pair<const char *, size_t>(data + sections[i].offset, (size_t)sections[i].size);
+    }
+
+    // source files
+    std::vector<std::string> sourceNames;
+    std::vector<boost::int64_t> sourceStamps;
+
+    if(getStrings("sources", sourceNames) != true || getValues("sources.stamps", sourceStamps) != true || sourceStamps.size() != 2 * sourceNames.size())
+    {
+        put_flog(LOG_ERROR, "%s has no valid list of sources", filename.c_str());
+        sections_.clear();
+        return false;
+    }
+
+    sourceNames_ = sourceNames;
+    sourceStamps_ = sourceStamps;
+
+    return true;
+}
+
+bool InputBundle::isCurrent(const std::string &directory) const
+{
+    for(unsigned int i=0; i<sourceNames_.size(); i++)
+    {
+        boost::int64_t size;
+        boost::int64_t modificationTime;
+
+        if(getSourceStamp(directory + "/" + sourceNames_[i], size, modificationTime) != true)
+        {
+            continue;
+        }
+
+        if(size != sourceStamps_[2*i] || modificationTime != sourceStamps_[2*i + 1])
+        {
+            put_flog(LOG_INFO, "%s changed since the input bundle was written", sourceNames_[i].c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+const char * InputBundle::getSection(const std::string &name, size_t &size) const
+{
+    std::map<std::string, std::pair<const char *, size_t> >::const_iterator it = sections_.find(name);
+
+    if(it == sections_.end())
+    {
+        size = 0;
+        return NULL;
+    }
+
+    size = it->second.second;
+
+    return it->second.first;
+}
+
+bool InputBundle::getStrings(const std::string &name, std::vector<std::string> &strings) const
+{
+    size_t size;
+    const char * data = getSection(name, size);
+
+    // each string is terminated by a null character
+    if(data == NULL || (size > 0 && data[size - 1] != '\0'))
+    {
+        return false;
+    }
+
+    strings.clear();
+
+    const char * end = data + size;
+
+    while(data < end)
+    {
+        strings.push_back(std::string(data));
+        data += strings.back().size() + 1;
+    }
+
+    return true;
+}
+
+void InputBundle::addSection(const std::string &name, const void * data, size_t size)
+{
+    if(name.size() >= sizeof(((InputBundleSection *)NULL)->name))
+    {
+        put_flog(LOG_ERROR, "section name %s is too long", name.c_str());
+        return;
+    }
+
+    newSectionNames_.push_back(name);
+    newSectionData_.push_back(std::vector<char>((const char *)data, (const char *)data + size));
+}
+
+void InputBundle::addStrings(const std::string &name, const std::vector<std::string> &strings)
+{
+    std::vector<char> data;
+
+    for(unsigned int i=0; i<strings.size(); i++)
+    {
+        data.insert(data.end(), strings[i].begin(), strings[i].end());
+        data.push_back('\0');
+    }
+
+    addValues(name, data);
+}
+
+bool InputBundle::addSource(const std::string &directory, const std::string &filename)
+{
+    boost::int64_t size;
+    boost::int64_t modificationTime;
+
+    if(getSourceStamp(directory + "/" + filename, size, modificationTime) != true)
+    {
+        put_flog(LOG_ERROR, "could not stat source file %s", filename.c_str());
+        return false;
+    }
+
+    sourceNames_.push_back(filename);
+    sourceStamps_.push_back(size);
+    sourceStamps_.push_back(modificationTime);
+
+    return true;
+}
+
+bool InputBundle::write(const std::string &filename)
+{
+    std::vector<std::string> names = newSectionNames_;
+    std::vector<const std::vector<char> *> sectionData;
+
+    for(unsigned int i=0; i<newSectionData_.size(); i++)
+    {
+        sectionData.push_back(&newSectionData_[i]);
+    }
+
+    // the sources are written as regular sections
+    std::vector<char> sourceNamesData;
+
+    for(unsigned int i=0; i<sourceNames_.size(); i++)
+    {
+        sourceNamesData.insert(sourceNamesData.end(), sourceNames_[i].begin(), sourceNames_[i].end());
+        sourceNamesData.push_back('\0');
+    }
+
+    std::vector<char> sourceStampsData(sourceStamps_.size() * sizeof(boost::int64_t));
+
+    if(sourceStamps_.size() > 0)
+    {
+        memcpy(&sourceStampsData[0], &sourceStamps_[0], sourceStampsData.size());
+    }
+
+    names.push_back("sources");
+    sectionData.push_back(&sourceNamesData);
+
+    names.push_back("sources.stamps");
+    sectionData.push_back(&sourceStampsData);
+
+    // lay out the file
+    std::vector<InputBundleSection> sections(names.size());
+
+    size_t offset = sizeof(InputBundleHeader) + sections.size() * sizeof(InputBundleSection);
+
+    for(unsigned int i=0; i<sections.size(); i++)
+    {
+        memset(sections[i].name, 0, sizeof(sections[i].name));
+        strncpy(sections[i].name, names[i].c_str(), sizeof(sections[i].name) - 1);
+
+        offset = getAlignedOffset(offset);
+
+        sections[i].offset = offset;
+        sections[i].size = sectionData[i]->size();
+
+        offset += sectionData[i]->size();
+    }
+
+    std::vector<char> data(offset, 0);
+
+    memcpy(&data[sizeof(InputBundleHeader)], &sections[0], sections.size() * sizeof(InputBundleSection));
+
+    for(unsigned int i=0; i<sections.size(); i++)
+    {
+        if(sectionData[i]->size() > 0)
+        {
+            memcpy(&data[sections[i].offset], &(*sectionData[i])[0], sectionData[i]->size());
+        }
+    }
+
+    InputBundleHeader header;
+    memset(&header, 0, sizeof(header));
+
+    memcpy(header.magic, inputBundleMagic, sizeof(inputBundleMagic));
+    header.version = version_;
+    header.byteOrder = inputBundleByteOrder;
+    header.numSections = (boost::uint32_t)sections.size();
+    header.fileSize = data.size();
+
+    boost::crc_32_type crc;
+    crc.process_bytes(&data[sizeof(InputBundleHeader)], data.size() - sizeof(InputBundleHeader));
+    header.checksum = crc.checksum();
+
+    memcpy(&data[0], &header, sizeof(header));
+
+    std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary);
+
+    if(out.is_open() != true)
+    {
+        put_flog(LOG_ERROR, "could not open file %s", filename.c_str());
+        return false;
+    }
+
+    out.write(&data[0], data.size());
+    out.close();
+
+    if(out.fail() == true)
+    {
+        put_flog(LOG_ERROR, "error writing %s", filename.c_str());
+        return false;
+    }
+
+    put_flog(LOG_INFO, "wrote %i sections, %i bytes to %s", (int)sections.size(), (int)data.size(), filename.c_str());
+
+    return true;
+}
+
+boost::shared_ptr<const InputBundle> InputBundle::getDataDirectoryBundle()
+{
+    boost::mutex::scoped_lock lock(g_dataDirectoryBundleMutex);
+
+    if(g_dataDirectoryBundleOpened == true)
+    {
+        return g_dataDirectoryBundle;
+    }
+
+    g_dataDirectoryBundleOpened = true;
+
+    boost::shared_ptr<InputBundle> bundle(new InputBundle());
+
+    std::string filename = g_dataDirectory + "/" + INPUT_BUNDLE_FILENAME;
+
+    if(bundle->open(filename) != true)
+    {
+        put_flog(LOG_DEBUG, "no valid input bundle %s, reading text files", filename.c_str());
+        return g_dataDirectoryBundle;
+    }
+
+    if(bundle->isCurrent(g_dataDirectory) != true)
+    {
+        put_flog(LOG_WARN, "input bundle %s is stale, reading text files", filename.c_str());
+        return g_dataDirectoryBundle;
+    }
+
+    put_flog(LOG_INFO, "using input bundle %s", filename.c_str());
+
+    g_dataDirectoryBundle = bundle;
+
+    return g_dataDirectoryBundle;
+}
+
+bool InputBundle::getSourceStamp(const std::string &filename, boost::int64_t &size, boost::int64_t &modificationTime)
+{
+    struct stat fileStat;
+
+    if(stat(filename.c_str(), &fileStat) != 0)
+    {
+        return false;
+    }
+
+    size = (boost::int64_t)fileStat.st_size;
+    modificationTime = (boost::int64_t)fileStat.st_mtime;
+
+    return true;
+}
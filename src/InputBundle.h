@@ -0,0 +1,97 @@
+#ifndef INPUT_BUNDLE_H
+#define INPUT_BUNDLE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <boost/shared_ptr.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#define INPUT_BUNDLE_FILENAME "inputs.bundle"
+
+// a versioned, checksummed binary file of named sections, holding input data that would otherwise be parsed from text files
+// a bundle is written once from the text files (see runBatch()) and memory mapped when read
+// it records the size and modification time of the files it was compiled from, so a stale bundle can be detected
+// values are stored in native byte order, so a bundle is only read on the kind of machine that wrote it
+class InputBundle
+{
+    public:
+
+        InputBundle();
+        ~InputBundle();
+
+        // map a bundle file; returns false if it is missing, of another version, or fails its checksum
+        bool open(const std::string &filename);
+
+        // returns false if any source file in directory changed since the bundle was written
+        // missing source files are ignored, so a bundle can be deployed without them
+        bool isCurrent(const std::string &directory) const;
+
+        // the data of a section and its size in bytes, or NULL if there is no such section
+        // the data is 8-byte aligned and remains valid as long as the bundle exists
+        const char * getSection(const std::string &name, size_t &size) const;
+
+        // copy a section of values; returns false if it is missing or not a whole number of values
+        template <class T> bool getValues(const std::string &name, std::vector<T> &values) const
+        {
+            size_t size;
+            const char * data = getSection(name, size);
+
+            if(data == NULL || size % sizeof(T) != 0)
+            {
+                return false;
+            }
+
+            values.assign((const T *)data, (const T *)(data + size));
+
+            return true;
+        }
+
+        bool getStrings(const std::string &name, std::vector<std::string> &strings) const;
+
+        // add sections to be written
+        void addSection(const std::string &name, const void * data, size_t size);
+
+        template <class T> void addValues(const std::string &name, const std::vector<T> &values)
+        {
+            addSection(name, values.size() > 0 ? &values[0] : NULL, values.size() * sizeof(T));
+        }
+
+        void addStrings(const std::string &name, const std::vector<std::string> &strings);
+
+        // record the size and modification time of a source file, relative to directory
+        bool addSource(const std::string &directory, const std::string &filename);
+
+        // write the added sections and sources
+        bool write(const std::string &filename);
+
+        // the bundle in the data directory, opened once per process
+        // NULL if there is none, or if it is invalid or stale; the text files should be used instead
+        static boost::shared_ptr<const InputBundle> getDataDirectoryBundle();
+
+    private:
+
+        // incremented whenever the file format or the contents of any section change
+        static const boost::uint32_t version_;
+
+        // mapped file, when opened
+        boost::shared_ptr<boost::interprocess::file_mapping> file_;
+        boost::shared_ptr<boost::interprocess::mapped_region> region_;
+
+        // section name -> (data, size)
+        std::map<std::string, std::pair<const char *, size_t> > sections_;
+
+        // added sections, when writing
+        std::vector<std::string> newSectionNames_;
+        std::vector<std::vector<char> > newSectionData_;
+
+        // source files: name relative to the data directory, and (size, modification time)
+        std::vector<std::string> sourceNames_;
+        std::vector<boost::int64_t> sourceStamps_;
+
+        static bool getSourceStamp(const std::string &filename, boost::int64_t &size, boost::int64_t &modificationTime);
+};
+
+#endif
@@ -0,0 +1,230 @@
+#include "Instrumentation.h"
+#include "log.h"
+#include <sstream>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+// escape a name for a JSON string
+static std::string getJsonString(const std::string &value)
+{
+    std::string string = "\"";
+
+    for(unsigned int i=0; i<value.size(); i++)
+    {
+        if(value[i] == '"' || value[i] == '\\')
+        {
+            string += '\\';
+        }
+
+        string += value[i];
+    }
+
+    return string + "\"";
+}
+
+Instrumentation::Instrumentation(int processId)
+{
+    processId_ = processId;
+    startMicroseconds_ = getEpochMicroseconds();
+    timeStepStartMicroseconds_ = 0;
+    jsonStarted_ = false;
+    traceStarted_ = false;
+}
+
+Instrumentation::~Instrumentation()
+{
+    // close the JSON arrays
+    if(jsonOut_.is_open() == true)
+    {
+        jsonOut_ << (jsonStarted_ == true ? "\n]\n" : "[]\n");
+    }
+
+    if(traceOut_.is_open() == true)
+    {
+        traceOut_ << (traceStarted_ == true ? "\n]\n" : "[]\n");
+    }
+}
+
+bool Instrumentation::open(const std::string &prefix)
+{
+    csvOut_.open((prefix + ".csv").c_str(), std::ios::out);
+    jsonOut_.open((prefix + ".json").c_str(), std::ios::out);
+    traceOut_.open((prefix + "-trace.json").c_str(), std::ios::out);
+
+    if(csvOut_.is_open() != true || jsonOut_.is_open() != true || traceOut_.is_open() != true)
+    {
+        put_flog(LOG_ERROR, "could not open instrumentation files %s", prefix.c_str());
+        return false;
+    }
+
+    csvOut_.precision(12);
+    jsonOut_.precision(12);
+
+    return true;
+}
+
+void Instrumentation::addPhase(const std::string &name, const boost::int64_t &startMicroseconds, const boost::int64_t &endMicroseconds)
+{
+    getValue(phases_, name) += (double)(endMicroseconds - startMicroseconds) * 1.e-6;
+
+    std::stringstream event;
+    event << "{\"name\":" << getJsonString(name) << ",\"cat\":\"phase\",\"ph\":\"X\",\"ts\":" << startMicroseconds << ",\"dur\":" << endMicroseconds - startMicroseconds << ",\"pid\":" << processId_ << ",\"tid\":0}";
+
+    writeTraceEvent(event.str());
+}
+
+void Instrumentation::addCount(const std::string &name, const double &value)
+{
+    getValue(counts_, name) += value;
+}
+
+void Instrumentation::setCount(const std::string &name, const double &value)
+{
+    getValue(counts_, name) = value;
+}
+
+void Instrumentation::endTimeStep(int time)
+{
+    // the columns are set by the first time step
+    if(csvColumns_.empty() == true)
+    {
+        csvOut_ << "t";
+
+        for(unsigned int i=0; i<phases_.size(); i++)
+        {
+            csvColumns_.push_back("phase " + phases_[i].first);
+        }
+
+        for(unsigned int i=0; i<counts_.size(); i++)
+        {
+            csvColumns_.push_back("count " + counts_[i].first);
+        }
+
+        for(unsigned int i=0; i<csvColumns_.size(); i++)
+        {
+            csvOut_ << "," << csvColumns_[i];
+        }
+
+        csvOut_ << "\n";
+    }
+
+    // values by column name
+    std::vector<std::pair<std::string, double> > values;
+
+    for(unsigned int i=0; i<phases_.size(); i++)
+    {
+        values.push_back(std::pair<std::string, double>("phase " + phases_[i].first, phases_[i].second));
+    }
+
+    for(unsigned int i=0; i<counts_.size(); i++)
+    {
+        values.push_back(std::pair<std::string, double>("count " + counts_[i].first, counts_[i].second));
+    }
+
+    csvOut_ << time;
+
+    for(unsigned int i=0; i<csvColumns_.size(); i++)
+    {
+        csvOut_ << "," << getValue(values, csvColumns_[i]);
+    }
+
+    csvOut_ << "\n";
+    csvOut_.flush();
+
+    // JSON: { "t": time, "phases": { name: seconds, ... }, "counts": { name: value, ... } }
+    jsonOut_ << (jsonStarted_ == true ? ",\n" : "[\n");
+    jsonOut_ << "{\"t\":" << time << ",\"phases\":" << getJsonObject(phases_) << ",\"counts\":" << getJsonObject(counts_) << "}";
+    jsonOut_.flush();
+
+    jsonStarted_ = true;
+
+    // the time step, on its own thread of the trace so it contains its phases; counters are shown as a track
+    boost::int64_t endMicroseconds = getMicroseconds();
+
+    std::stringstream timeStepEvent;
+    timeStepEvent << "{\"name\":\"time step\",\"cat\":\"time step\",\"ph\":\"X\",\"ts\":" << timeStepStartMicroseconds_ << ",\"dur\":" << endMicroseconds - timeStepStartMicroseconds_ << ",\"pid\":" << processId_ << ",\"tid\":1,\"args\":{\"t\":" << time << "}}";
+
+    writeTraceEvent(timeStepEvent.str());
+
+    std::stringstream countsEvent;
+    countsEvent << "{\"name\":\"counts\",\"ph\":\"C\",\"ts\":" << endMicroseconds << ",\"pid\":" << processId_ << ",\"args\":" << getJsonObject(counts_) << "}";
+
+    writeTraceEvent(countsEvent.str());
+    traceOut_.flush();
+
+    timeStepStartMicroseconds_ = endMicroseconds;
+
+    phases_.clear();
+    counts_.clear();
+}
+
+boost::int64_t Instrumentation::getMicroseconds() const
+{
+    return getEpochMicroseconds() - startMicroseconds_;
+}
+
+boost::int64_t Instrumentation::getEpochMicroseconds()
+{
+    static const boost::posix_time::ptime epoch(boost::gregorian::date(1970, 1, 1));
+
+    return (boost::posix_time::microsec_clock::universal_time() - epoch).total_microseconds();
+}
+
+double & Instrumentation::getValue(std::vector<std::pair<std::string, double> > &values, const std::string &name)
+{
+    // there are only a few values, so a linear search is fine
+    for(unsigned int i=0; i<values.size(); i++)
+    {
+        if(values[i].first == name)
+        {
+            return values[i].second;
+        }
+    }
+
+    values.push_back(std::pair<std::string, double>(name, 0.));
+
+    return values.back().second;
+}
+
+void Instrumentation::writeTraceEvent(const std::string &event)
+{
+    traceOut_ << (traceStarted_ == true ? ",\n" : "[\n") << event;
+
+    traceStarted_ = true;
+}
+
+std::string Instrumentation::getJsonObject(const std::vector<std::pair<std::string, double> > &values)
+{
+    std::stringstream object;
+    object.precision(12);
+
+    object << "{";
+
+    for(unsigned int i=0; i<values.size(); i++)
+    {
+        object << (i > 0 ? "," : "") << getJsonString(values[i].first) << ":" << values[i].second;
+    }
+
+    object << "}";
+
+    return object.str();
+}
+
+InstrumentationTimer::InstrumentationTimer(Instrumentation * instrumentation, const char * name)
+{
+    instrumentation_ = instrumentation;
+    name_ = name;
+    startMicroseconds_ = 0;
+
+    if(instrumentation_ != NULL)
+    {
+        startMicroseconds_ = instrumentation_->getMicroseconds();
+    }
+}
+
+InstrumentationTimer::~InstrumentationTimer()
+{
+    if(instrumentation_ != NULL)
+    {
+        instrumentation_->addPhase(name_, startMicroseconds_, instrumentation_->getMicroseconds());
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <boost/cstdint.hpp>
+
+// timing of the phases of a simulation's time steps, and counters, for finding where the time of a time step goes
+// each time step is written to <prefix>.csv (a row per time step) and <prefix>.json (an array of objects), and
+// the phases to <prefix>-trace.json, a Chrome trace (chrome://tracing, or ui.perfetto.dev)
+// an instrumentation is used by the thread running its simulation; concurrent parts of a simulation keep their own
+// counts and add them up afterwards
+// simulations without instrumentation have a NULL pointer, so the cost of disabled instrumentation is a pointer test
+class Instrumentation
+{
+    public:
+
+        // processId distinguishes simulations (e.g. realizations) in a combined trace
+        Instrumentation(int processId=0);
+        ~Instrumentation();
+
+        bool open(const std::string &prefix);
+
+        // add the duration of a phase of the current time step, in microseconds since the instrumentation was created
+        // phases of the same name within a time step are summed; see InstrumentationTimer
+        void addPhase(const std::string &name, const boost::int64_t &startMicroseconds, const boost::int64_t &endMicroseconds);
+
+        // counters of the current time step
+        void addCount(const std::string &name, const double &value);
+        void setCount(const std::string &name, const double &value);
+
+        // write the phases and counters of time step <time> and start a new time step
+        // the columns of the CSV file are those of the first time step; later additions are only in the JSON files
+        void endTimeStep(int time);
+
+        // microseconds since the instrumentation was created
+        boost::int64_t getMicroseconds() const;
+
+    private:
+
+        int processId_;
+
+        // microseconds since the epoch at creation
+        boost::int64_t startMicroseconds_;
+
+        // start of the current time step, in microseconds since creation
+        boost::int64_t timeStepStartMicroseconds_;
+
+        std::ofstream csvOut_;
+        std::ofstream jsonOut_;
+        std::ofstream traceOut_;
+
+        // whether any time step / trace event has been written
+        bool jsonStarted_;
+        bool traceStarted_;
+
+        // phase durations (seconds) and counters of the current time step, in order of first use
+        std::vector<std::pair<std::string, double> > phases_;
+        std::vector<std::pair<std::string, double> > counts_;
+
+        // CSV columns: "phase <name>" and "count <name>"
+        std::vector<std::string> csvColumns_;
+
+        static boost::int64_t getEpochMicroseconds();
+
+        static double & getValue(std::vector<std::pair<std::string, double> > &values, const std::string &name);
+
+        void writeTraceEvent(const std::string &event);
+
+        // JSON object of the values
+        static std::string getJsonObject(const std::vector<std::pair<std::string, double> > &values);
+};
+
+// times the scope it is declared in as a phase; does nothing for a NULL instrumentation
+class InstrumentationTimer
+{
+    public:
+
+        InstrumentationTimer(Instrumentation * instrumentation, const char * name);
+        ~InstrumentationTimer();
+
+    private:
+
+        Instrumentation * instrumentation_;
+        const char * name_;
+        boost::int64_t startMicroseconds_;
+};
+
+#endif
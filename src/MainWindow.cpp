@@ -7,6 +7,7 @@
 #include "TimelineWidget.h"
 #include "EpidemicSimulation.h"
 #include "EpidemicDataSet.h"
+#include "EpidemicCsvOutputSink.h"
 #include "ParametersWidget.h"
 #include "Parameters.h"
 #include "EpidemicInitialCasesWidget.h"
@@ -18,6 +19,7 @@
 #include "EpidemicChartWidget.h"
 #include "StockpileChartWidget.h"
 #include "models/disease/StochasticSEATIRD.h"
+#include "models/disease/DeterministicSEATIRD.h"
 #include "main.h"
 #include "log.h"
 
@@ -40,10 +42,17 @@ MainWindow::MainWindow()
     newSimulationAction->setStatusTip("New simulation");
     connect(newSimulationAction, SIGNAL(triggered()), this, SLOT(newSimulation()));
 
+    // new deterministic simulation action
+    QAction * newDeterministicSimulationAction = new QAction("New Deterministic Simulation", this);
+    newDeterministicSimulationAction->setStatusTip("New simulation of the mean field of the stochastic model");
+    connect(newDeterministicSimulationAction, SIGNAL(triggered()), this, SLOT(newDeterministicSimulation()));
+
+#if USE_NETCDF
     // open data set action
-    /*QAction * openDataSetAction = new QAction("Open Data Set", this);
+    QAction * openDataSetAction = new QAction("Open Data Set", this);
     openDataSetAction->setStatusTip("Open data set");
-    connect(openDataSetAction, SIGNAL(triggered()), this, SLOT(openDataSet()));*/
+    connect(openDataSetAction, SIGNAL(triggered()), this, SLOT(openDataSet()));
+#endif
 
     // new chart action
     QAction * newChartAction = new QAction("New Chart", this);
@@ -54,6 +63,12 @@ MainWindow::MainWindow()
     saveEpidemicDataCsvAction->setStatusTip("Save epidemic data (CSV)");
     connect(saveEpidemicDataCsvAction, SIGNAL(triggered()), this, SLOT(saveEpidemicDataCsv()));
 
+#if USE_NETCDF
+    QAction * saveDataSetNetCdfAction = new QAction("Save Data Set (NetCDF)", this);
+    saveDataSetNetCdfAction->setStatusTip("Save all variables of the data set (NetCDF)");
+    connect(saveDataSetNetCdfAction, SIGNAL(triggered()), this, SLOT(saveDataSetNetCdf()));
+#endif
+
     QAction * loadInitialCasesAction = new QAction("Load Initial Cases", this);
     loadInitialCasesAction->setStatusTip("Load initial cases");
     connect(loadInitialCasesAction, SIGNAL(triggered()), this, SLOT(loadInitialCases()));
@@ -76,9 +91,15 @@ MainWindow::MainWindow()
 
     // add actions to menus
     fileMenu->addAction(newSimulationAction);
-    // fileMenu->addAction(openDataSetAction);
+    fileMenu->addAction(newDeterministicSimulationAction);
+#if USE_NETCDF
+    fileMenu->addAction(openDataSetAction);
+#endif
     fileMenu->addAction(newChartAction);
     fileMenu->addAction(saveEpidemicDataCsvAction);
+#if USE_NETCDF
+    fileMenu->addAction(saveDataSetNetCdfAction);
+#endif
     fileMenu->addAction(loadInitialCasesAction);
     fileMenu->addAction(loadParametersAction);
 
@@ -89,7 +110,9 @@ MainWindow::MainWindow()
 
     // add actions to toolbar
     toolbar->addAction(newSimulationAction);
-    // toolbar->addAction(openDataSetAction);
+#if USE_NETCDF
+    toolbar->addAction(openDataSetAction);
+#endif
     toolbar->addAction(newChartAction);
 
     // make map widgets the main view
@@ -224,52 +247,6 @@ MainWindow::MainWindow()
 
     // show the window
     show();
-
-    // batch mode operations
-    if(g_batchMode == true)
-    {
-        put_flog(LOG_INFO, "starting batch mode");
-
-        // activate other map view
-        tabWidget->setCurrentIndex(1);
-
-        newSimulation();
-
-        if(g_batchInitialCasesFilename.empty() != true)
-        {
-            initialCasesWidget_->loadXmlData(g_batchInitialCasesFilename);
-        }
-
-        if(g_batchParametersFilename.empty() != true)
-        {
-            g_parameters.loadXmlData(g_batchParametersFilename);
-
-            // create a new ParametersWidget to reload these values in the UI
-            parametersDockWidget_->setWidget(new ParametersWidget());
-        }
-
-        // wait for any GUI events to be processed
-        // ignore: QCoreApplication::processEvents();
-
-        for(unsigned int i=0; i<g_batchNumTimesteps; i++)
-        {
-            nextTimestep();
-
-            // wait for any GUI events to be processed
-            // ignore: QCoreApplication::processEvents();
-        }
-
-        std::string out = dataSet_->getVariableStratified2NodeVsTime(g_batchOutputVariable);
-
-        {
-            std::ofstream ofs(g_batchOutputFilename.c_str());
-            ofs << out;
-        }
-
-        put_flog(LOG_INFO, "done with batch mode");
-
-        exit(0);
-    }
 }
 
 MainWindow::~MainWindow()
@@ -417,6 +394,15 @@ void MainWindow::newSimulation()
     emit(dataSetChanged(dataSet_));
 }
 
+void MainWindow::newDeterministicSimulation()
+{
+    boost::shared_ptr<EpidemicSimulation> simulation(new DeterministicSEATIRD());
+
+    dataSet_ = simulation;
+
+    emit(dataSetChanged(dataSet_));
+}
+
 void MainWindow::openDataSet()
 {
     QString filename = QFileDialog::getOpenFileName(this, "Open Data Set", "", "Simulation files (*.nc)");
@@ -490,28 +476,54 @@ void MainWindow::saveEpidemicDataCsv()
         return;
     }
 
-    std::string out = dataSet_->getVariableStratified2NodeVsTime(varName);
+    QString filename = QFileDialog::getSaveFileName(this, "Save Epidemic Data", "", "CSV files (*.csv)");
+
+    if(filename.isNull() == true)
+    {
+        return;
+    }
+
+    // write all time steps as CSV
+    EpidemicCsvOutputSink sink(varName, filename.toStdString());
+
+    bool success = sink.open(*dataSet_);
+
+    for(int t=0; success == true && t<dataSet_->getNumTimes(); t++)
+    {
+        success = sink.write(*dataSet_, t);
+    }
 
-    if(out.empty() == true)
+    if(sink.close() != true || success != true)
     {
-        put_flog(LOG_ERROR, "empty");
+        put_flog(LOG_ERROR, "could not write %s", filename.toStdString().c_str());
         QMessageBox::warning(this, "Error", "Could not generate output.", QMessageBox::Ok, QMessageBox::Ok);
         return;
     }
+}
 
-    QString filename = QFileDialog::getSaveFileName(this, "Save Epidemic Data", "", "CSV files (*.csv)");
+#if USE_NETCDF
+void MainWindow::saveDataSetNetCdf()
+{
+    if(dataSet_ == NULL)
+    {
+        put_flog(LOG_INFO, "NULL dataSet");
+        QMessageBox::warning(this, "Error", "No active data set or simulation.", QMessageBox::Ok, QMessageBox::Ok);
+        return;
+    }
+
+    QString filename = QFileDialog::getSaveFileName(this, "Save Data Set", "", "Simulation files (*.nc)");
 
     if(filename.isNull() == true)
     {
         return;
     }
 
-    // create output file
-    std::ofstream ofs(filename.toStdString().c_str());
-
-    // write data to file stream
-    ofs << out;
+    if(dataSet_->saveNetCdfFile(filename.toStdString().c_str()) != true)
+    {
+        QMessageBox::warning(this, "Error", "Could not save data set.", QMessageBox::Ok, QMessageBox::Ok);
+    }
 }
+#endif
 
 void MainWindow::loadInitialCases()
 {
@@ -529,7 +541,11 @@ void MainWindow::loadParameters()
 
     if(!filename.isEmpty())
     {
-        g_parameters.loadXmlData(filename.toStdString());
+        if(g_parameters.loadXmlData(filename.toStdString()) != true)
+        {
+            QMessageBox::warning(this, "Error", "Could not load file", QMessageBox::Ok, QMessageBox::Ok);
+            return;
+        }
 
         // create a new ParametersWidget to reload these values in the UI
         parametersDockWidget_->setWidget(new ParametersWidget());
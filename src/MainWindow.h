@@ -49,9 +49,13 @@ class MainWindow : public QMainWindow {
     private slots:
 
         void newSimulation();
+        void newDeterministicSimulation();
         void openDataSet();
         void newChart();
         void saveEpidemicDataCsv();
+#if USE_NETCDF
+        void saveDataSetNetCdf();
+#endif
         void loadInitialCases();
         void loadParameters();
         void resetTimeSlider();
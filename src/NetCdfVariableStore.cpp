@@ -0,0 +1,53 @@
+#include "NetCdfVariableStore.h"
+#include "log.h"
+
+#if USE_NETCDF
+
+#include <netcdf.h>
+
+NetCdfFile::NetCdfFile(int ncId)
+{
+    ncId_ = ncId;
+}
+
+NetCdfFile::~NetCdfFile()
+{
+    nc_close(ncId_);
+}
+
+int NetCdfFile::getId()
+{
+    return ncId_;
+}
+
+NetCdfVariableStore::NetCdfVariableStore(boost::shared_ptr<NetCdfFile> file, int varId)
+{
+    file_ = file;
+    varId_ = varId;
+}
+
+bool NetCdfVariableStore::readTime(int time, blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> &array)
+{
+    // the stratifications are flattened in the file
+    int numStratifications = 1;
+
+    for(int j=1; j<1+NUM_STRATIFICATION_DIMENSIONS; j++)
+    {
+        numStratifications *= array.extent(j);
+    }
+
+    size_t start[3] = { (size_t)time, 0, 0 };
+    size_t count[3] = { 1, (size_t)array.extent(0), (size_t)numStratifications };
+
+    int status = nc_get_vara_float(file_->getId(), varId_, start, count, array.data());
+
+    if(status != NC_NOERR)
+    {
+        put_flog(LOG_ERROR, "could not read time %i: %s", time, nc_strerror(status));
+        return false;
+    }
+
+    return true;
+}
+
+#endif
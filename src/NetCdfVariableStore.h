@@ -0,0 +1,42 @@
+#ifndef NET_CDF_VARIABLE_STORE_H
+#define NET_CDF_VARIABLE_STORE_H
+
+#include "EpidemicVariableStore.h"
+#include <boost/shared_ptr.hpp>
+
+#if USE_NETCDF
+
+// an open NetCDF file, closed when this is destroyed
+class NetCdfFile
+{
+    public:
+
+        NetCdfFile(int ncId);
+        ~NetCdfFile();
+
+        int getId();
+
+    private:
+
+        int ncId_;
+};
+
+// time steps of a float variable with dimensions (time, nodes, stratifications) in a NetCDF file
+// the file stays open as long as any store reading from it exists
+class NetCdfVariableStore : public EpidemicVariableStore
+{
+    public:
+
+        NetCdfVariableStore(boost::shared_ptr<NetCdfFile> file, int varId);
+
+        bool readTime(int time, blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> &array);
+
+    private:
+
+        boost::shared_ptr<NetCdfFile> file_;
+        int varId_;
+};
+
+#endif
+
+#endif
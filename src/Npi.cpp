@@ -1,7 +1,5 @@
 #include "Npi.h"
 
-MTRand Npi::rand_;
-
 Npi::Npi(std::string name, int executionTime, int duration, std::vector<double> ageEffectiveness, std::vector<int> nodeIds)
 {
     name_ = name;
@@ -86,11 +84,11 @@ double Npi::getNpiEffectiveness(std::vector<boost::shared_ptr<Npi> > npis, int n
 }
 
 // static method
-bool Npi::isNpiEffective(std::vector<boost::shared_ptr<Npi> > npis, int nodeId, int time, int ageI, int ageJ)
+bool Npi::isNpiEffective(std::vector<boost::shared_ptr<Npi> > npis, int nodeId, int time, int ageI, int ageJ, RandomStream &rand)
 {
     double effectiveness = Npi::getNpiEffectiveness(npis, nodeId, time, ageI, ageJ);
 
-    if(Npi::rand_.rand() <= effectiveness)
+    if(rand.rand() <= effectiveness)
     {
         return true;
     }
@@ -4,7 +4,7 @@
 #include <string>
 #include <vector>
 #include <boost/shared_ptr.hpp>
-#include "models/MersenneTwister.h"
+#include "models/RandomStream.h"
 
 class Npi
 {
@@ -22,7 +22,8 @@ class Npi
         static double getNpiEffectiveness(std::vector<boost::shared_ptr<Npi> > npis, int nodeId, int time, int ageI, int ageJ);
 
         // using the above, determine is all Npis combined are effective in stopping a contact
-        static bool isNpiEffective(std::vector<boost::shared_ptr<Npi> > npis, int nodeId, int time, int ageI, int ageJ);
+        // the random number generator is owned by the caller, so simulations can run concurrently
+        static bool isNpiEffective(std::vector<boost::shared_ptr<Npi> > npis, int nodeId, int time, int ageI, int ageJ, RandomStream &rand);
 
     private:
 
@@ -31,9 +32,6 @@ class Npi
         int duration_;
         std::vector<double> ageEffectiveness_;
         std::vector<int> nodeIds_;
-
-        // random number generator
-        static MTRand rand_;
 };
 
 #endif
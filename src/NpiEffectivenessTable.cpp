@@ -0,0 +1,82 @@
+#include "NpiEffectivenessTable.h"
+#include "log.h"
+#include <algorithm>
+
+NpiEffectivenessTable::NpiEffectivenessTable()
+{
+    time_ = -1;
+    npisVersion_ = -1;
+    numAgeGroups_ = 0;
+}
+
+void NpiEffectivenessTable::update(const std::vector<boost::shared_ptr<Npi> > &npis, int npisVersion, int time, const std::map<int, int> &nodeIdToIndex, int numNodes, int numAgeGroups)
+{
+    int size = numNodes * numAgeGroups * numAgeGroups;
+
+    if(time == time_ && npisVersion == npisVersion_ && (int)effectiveness_.size() == size)
+    {
+        return;
+    }
+
+    time_ = time;
+    npisVersion_ = npisVersion;
+    numAgeGroups_ = numAgeGroups;
+
+    // the probability of a contact being kept by all active Npis
+    std::vector<double> probKeep(size, 1.);
+
+    for(unsigned int i=0; i<npis.size(); i++)
+    {
+        // if the Npi is active during this time
+        if(time < npis[i]->getExecutionTime() || time >= npis[i]->getExecutionTime() + npis[i]->getDuration())
+        {
+            continue;
+        }
+
+        std::vector<double> ageEffectiveness = npis[i]->getAgeEffectiveness();
+
+        if((int)ageEffectiveness.size() < numAgeGroups)
+        {
+            put_flog(LOG_ERROR, "Npi %s has %i age effectiveness values, expected %i", npis[i]->getName().c_str(), (int)ageEffectiveness.size(), numAgeGroups);
+            continue;
+        }
+
+        // a node listed more than once is only covered once
+        std::vector<int> nodeIds = npis[i]->getNodeIds();
+
+        std::sort(nodeIds.begin(), nodeIds.end());
+        nodeIds.erase(std::unique(nodeIds.begin(), nodeIds.end()), nodeIds.end());
+
+        for(unsigned int n=0; n<nodeIds.size(); n++)
+        {
+            std::map<int, int>::const_iterator it = nodeIdToIndex.find(nodeIds[n]);
+
+            if(it == nodeIdToIndex.end())
+            {
+                continue;
+            }
+
+            double * nodeProbKeep = &probKeep[it->second * numAgeGroups * numAgeGroups];
+
+            for(int a=0; a<numAgeGroups; a++)
+            {
+                for(int b=0; b<numAgeGroups; b++)
+                {
+                    double probDeleteI = ageEffectiveness[a];
+                    double probDeleteJ = ageEffectiveness[b];
+
+                    double probDeleteCombined = probDeleteI + probDeleteJ - probDeleteI*probDeleteJ;
+
+                    nodeProbKeep[a * numAgeGroups + b] *= (1. - probDeleteCombined);
+                }
+            }
+        }
+    }
+
+    effectiveness_.resize(size);
+
+    for(int i=0; i<size; i++)
+    {
+        effectiveness_[i] = 1. - probKeep[i];
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef NPI_EFFECTIVENESS_TABLE_H
+#define NPI_EFFECTIVENESS_TABLE_H
+
+#include "Npi.h"
+#include <map>
+#include <vector>
+
+// combined effectiveness of a collection of Npis for one time, tabulated by [node index][age group I][age group J]
+// this gives the same values as Npi::getNpiEffectiveness() without searching the Npis for every contact
+class NpiEffectivenessTable
+{
+    public:
+
+        NpiEffectivenessTable();
+
+        // rebuild the table if the time or the Npis (identified by their version) changed
+        void update(const std::vector<boost::shared_ptr<Npi> > &npis, int npisVersion, int time, const std::map<int, int> &nodeIdToIndex, int numNodes, int numAgeGroups);
+
+        double getNpiEffectiveness(int nodeIndex, int ageI, int ageJ) const
+        {
+            return effectiveness_[(nodeIndex * numAgeGroups_ + ageI) * numAgeGroups_ + ageJ];
+        }
+
+        // determine if all Npis combined are effective in stopping a contact
+        // this always takes one draw from the random number generator
+        bool isNpiEffective(int nodeIndex, int ageI, int ageJ, RandomStream &rand) const
+        {
+            return (rand.rand() <= getNpiEffectiveness(nodeIndex, ageI, ageJ));
+        }
+
+    private:
+
+        // time and Npis version of the table; -1 before the first update
+        int time_;
+        int npisVersion_;
+
+        int numAgeGroups_;
+
+        std::vector<double> effectiveness_;
+};
+
+#endif
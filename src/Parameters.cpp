@@ -48,6 +48,8 @@ Parameters::Parameters()
     vaccineLatencyPeriod_ = 14;
     vaccineAdherence_ = 0.8;
     vaccineCapacity_ = 0.001;
+
+    npisVersion_ = 0;
 }
 
 double Parameters::getR0()
@@ -136,6 +138,11 @@ std::vector<boost::shared_ptr<Npi> > Parameters::getNpis()
     return npis_;
 }
 
+int Parameters::getNpisVersion()
+{
+    return npisVersion_;
+}
+
 boost::shared_ptr<PriorityGroupSelections> Parameters::getAntiviralPriorityGroupSelections()
 {
     return antiviralPriorityGroupSelections_;
@@ -146,15 +153,14 @@ boost::shared_ptr<PriorityGroupSelections> Parameters::getVaccinePriorityGroupSe
     return vaccinePriorityGroupSelections_;
 }
 
-void Parameters::loadXmlData(const std::string &filename)
+bool Parameters::loadXmlData(const std::string &filename)
 {
     QXmlQuery query;
 
     if(query.setFocus(QUrl(filename.c_str())) == false)
     {
         put_flog(LOG_ERROR, "failed to load %s", filename.c_str());
-        QMessageBox::warning(NULL, "Error", "Could not load file", QMessageBox::Ok, QMessageBox::Ok);
-        return;
+        return false;
     }
 
     // temp values
@@ -293,6 +299,8 @@ void Parameters::loadXmlData(const std::string &filename)
         value = qstring.toDouble();
         setVaccineCapacity(value);
     }
+
+    return true;
 }
 
 void Parameters::setR0(double value)
@@ -435,11 +443,13 @@ void Parameters::addPriorityGroup(boost::shared_ptr<PriorityGroup> priorityGroup
 void Parameters::clearNpis()
 {
     npis_.clear();
+    npisVersion_++;
 }
 
 void Parameters::addNpi(boost::shared_ptr<Npi> npi)
 {
     npis_.push_back(npi);
+    npisVersion_++;
 
     emit(npiAdded(npi));
 }
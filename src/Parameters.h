@@ -1,8 +1,10 @@
 #ifndef PARAMETERS_H
 #define PARAMETERS_H
 
+#include <string>
+#include <vector>
 #include <boost/shared_ptr.hpp>
-#include <QtGui>
+#include <QtCore>
 
 class PriorityGroup;
 class Npi;
@@ -36,6 +38,9 @@ class Parameters : public QObject
 
         std::vector<boost::shared_ptr<Npi> > getNpis();
 
+        // incremented whenever the set of NPIs changes, so users can cache values derived from the NPIs
+        int getNpisVersion();
+
         boost::shared_ptr<PriorityGroupSelections> getAntiviralPriorityGroupSelections();
         boost::shared_ptr<PriorityGroupSelections> getVaccinePriorityGroupSelections();
 
@@ -48,7 +53,7 @@ class Parameters : public QObject
 
     public slots:
 
-        void loadXmlData(const std::string &filename);
+        bool loadXmlData(const std::string &filename);
 
         void setR0(double value);
         void setBetaScale(double value);
@@ -133,6 +138,7 @@ class Parameters : public QObject
 
         // NPIs
         std::vector<boost::shared_ptr<Npi> > npis_;
+        int npisVersion_;
 
         // antiviral priority group selections
         boost::shared_ptr<PriorityGroupSelections> antiviralPriorityGroupSelections_;
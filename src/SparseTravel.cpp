@@ -0,0 +1,42 @@
+#include "SparseTravel.h"
+#include "log.h"
+
+SparseTravel::SparseTravel(const blitz::Array<float, 2> &travel)
+{
+    int numNodes = travel.extent(0);
+
+    if(travel.extent(1) != numNodes)
+    {
+        put_flog(LOG_ERROR, "travel matrix is not square (%i x %i)", travel.extent(0), travel.extent(1));
+        numNodes = 0;
+    }
+
+    rowStarts_.push_back(0);
+
+    for(int i=0; i<numNodes; i++)
+    {
+        for(int j=0; j<numNodes; j++)
+        {
+            if(i != j && (travel(i, j) > 0. || travel(j, i) > 0.))
+            {
+                columns_.push_back(j);
+                travelIJ_.push_back(travel(i, j));
+                travelJI_.push_back(travel(j, i));
+            }
+        }
+
+        rowStarts_.push_back((int)columns_.size());
+    }
+
+    put_flog(LOG_DEBUG, "%i nodes, %i entries", numNodes, getNumEntries());
+}
+
+int SparseTravel::getNumNodes() const
+{
+    return (int)rowStarts_.size() - 1;
+}
+
+int SparseTravel::getNumEntries() const
+{
+    return (int)columns_.size();
+}
@@ -0,0 +1,52 @@
+#ifndef SPARSE_TRAVEL_H
+#define SPARSE_TRAVEL_H
+
+#include <blitz/array.h>
+#include <vector>
+
+// node -> node travel fractions in compressed sparse row (CSR) format
+// row i lists the other nodes j with travel(i, j) > 0 or travel(j, i) > 0,
+// with both fractions stored, so both directions of a node pair are visited once
+// the diagonal (travel within a node) is not included
+class SparseTravel
+{
+    public:
+
+        SparseTravel(const blitz::Array<float, 2> &travel);
+
+        int getNumNodes() const;
+        int getNumEntries() const;
+
+        // the entries of row i are [getRowStart(i), getRowStart(i+1))
+        int getRowStart(int i) const
+        {
+            return rowStarts_[i];
+        }
+
+        // node index j of an entry
+        int getColumn(int entry) const
+        {
+            return columns_[entry];
+        }
+
+        // travel(i, j) of an entry
+        float getTravelIJ(int entry) const
+        {
+            return travelIJ_[entry];
+        }
+
+        // travel(j, i) of an entry
+        float getTravelJI(int entry) const
+        {
+            return travelJI_[entry];
+        }
+
+    private:
+
+        std::vector<int> rowStarts_;
+        std::vector<int> columns_;
+        std::vector<float> travelIJ_;
+        std::vector<float> travelJI_;
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "Stockpile.h"
+#include "Checkpoint.h"
 #include "log.h"
 
 Stockpile::Stockpile(std::string name)
@@ -58,6 +59,40 @@ void Stockpile::copyToNewTimeStep()
     num_.push_back(num_.back());
 }
 
+bool Stockpile::writeCheckpoint(CheckpointWriter &out)
+{
+    out.writeTag("Stockpile");
+
+    out.writeString(name_);
+    out.writeVector(num_);
+    out.writeVector(nodeIds_);
+
+    return out.good();
+}
+
+bool Stockpile::readCheckpoint(CheckpointReader &in)
+{
+    std::string name;
+    std::vector<boost::array<int, NUM_STOCKPILE_TYPES> > num;
+    std::vector<int> nodeIds;
+
+    if(in.readTag("Stockpile") != true || in.readString(name) != true || in.readVector(num) != true || in.readVector(nodeIds) != true)
+    {
+        return false;
+    }
+
+    if(name != name_ || num.size() == 0)
+    {
+        put_flog(LOG_ERROR, "checkpoint has stockpile %s, expected %s", name.c_str(), name_.c_str());
+        return false;
+    }
+
+    num_ = num;
+    nodeIds_ = nodeIds;
+
+    return true;
+}
+
 void Stockpile::setNum(int time, int num, STOCKPILE_TYPE type)
 {
     if(time >= (int)num_.size())
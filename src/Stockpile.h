@@ -1,11 +1,14 @@
 #ifndef STOCKPILE_H
 #define STOCKPILE_H
 
-#include <QtGui>
+#include <QtCore>
 #include <string>
 #include <vector>
 #include <boost/array.hpp>
 
+class CheckpointWriter;
+class CheckpointReader;
+
 enum STOCKPILE_TYPE { STOCKPILE_ANTIVIRALS, STOCKPILE_VACCINES, NUM_STOCKPILE_TYPES };
 
 class Stockpile : public QObject
@@ -27,6 +30,11 @@ class Stockpile : public QObject
 
         void copyToNewTimeStep();
 
+        // the quantities at all times and the nodes served; see EpidemicSimulation::saveCheckpoint()
+        // a checkpoint is only restored into a stockpile of the same name
+        bool writeCheckpoint(CheckpointWriter &out);
+        bool readCheckpoint(CheckpointReader &in);
+
     public slots:
 
         void setNum(int time, int num, STOCKPILE_TYPE type);
@@ -1,6 +1,7 @@
 #include "StockpileNetwork.h"
 #include "EpidemicDataSet.h"
 #include "StockpileNetworkDistribution.h"
+#include "Checkpoint.h"
 #include "log.h"
 #include <boost/lexical_cast.hpp>
 
@@ -91,3 +92,89 @@ void StockpileNetwork::evolve(int nowTime)
         distributions_[i]->apply(nowTime);
     }
 }
+
+bool StockpileNetwork::writeCheckpoint(CheckpointWriter &out)
+{
+    out.writeTag("StockpileNetwork");
+
+    std::vector<boost::shared_ptr<Stockpile> > stockpiles = getAllStockpiles();
+
+    out.write((boost::int32_t)stockpiles.size());
+
+    for(unsigned int i=0; i<stockpiles.size(); i++)
+    {
+        stockpiles[i]->writeCheckpoint(out);
+    }
+
+    out.write((boost::int32_t)distributions_.size());
+
+    for(unsigned int i=0; i<distributions_.size(); i++)
+    {
+        distributions_[i]->writeCheckpoint(out, stockpiles);
+    }
+
+    return out.good();
+}
+
+bool StockpileNetwork::readCheckpoint(CheckpointReader &in)
+{
+    std::vector<boost::shared_ptr<Stockpile> > stockpiles = getAllStockpiles();
+
+    boost::int32_t numStockpiles;
+
+    if(in.readTag("StockpileNetwork") != true || in.read(numStockpiles) != true)
+    {
+        return false;
+    }
+
+    if(numStockpiles != (int)stockpiles.size())
+    {
+        put_flog(LOG_ERROR, "checkpoint has %i stockpiles, expected %i", numStockpiles, stockpiles.size());
+        return false;
+    }
+
+    for(unsigned int i=0; i<stockpiles.size(); i++)
+    {
+        if(stockpiles[i]->readCheckpoint(in) != true)
+        {
+            return false;
+        }
+    }
+
+    boost::int32_t numDistributions;
+
+    if(in.read(numDistributions) != true)
+    {
+        return false;
+    }
+
+    distributions_.clear();
+
+    for(int i=0; i<numDistributions; i++)
+    {
+        boost::shared_ptr<StockpileNetworkDistribution> distribution = StockpileNetworkDistribution::readCheckpoint(in, stockpiles);
+
+        if(distribution == NULL)
+        {
+            return false;
+        }
+
+        addDistribution(distribution);
+    }
+
+    return true;
+}
+
+std::vector<boost::shared_ptr<Stockpile> > StockpileNetwork::getAllStockpiles()
+{
+    std::vector<boost::shared_ptr<Stockpile> > stockpiles = stockpiles_;
+
+    std::map<int, boost::shared_ptr<Stockpile> >::iterator iter;
+
+    for(iter=nodeStockpiles_.begin(); iter!=nodeStockpiles_.end(); iter++)
+    {
+        stockpiles.push_back(iter->second);
+    }
+
+    return stockpiles;
+}
@@ -8,6 +8,8 @@
 
 class EpidemicDataSet;
 class StockpileNetworkDistribution;
+class CheckpointWriter;
+class CheckpointReader;
 
 class StockpileNetwork : public boost::enable_shared_from_this<StockpileNetwork>
 {
@@ -28,6 +30,11 @@ class StockpileNetwork : public boost::enable_shared_from_this<StockpileNetwork>
 
         void evolve(int nowTime);
 
+        // all stockpiles and distributions; see EpidemicSimulation::saveCheckpoint()
+        // the stockpiles must already exist, while distributions are replaced by those in the checkpoint
+        bool writeCheckpoint(CheckpointWriter &out);
+        bool readCheckpoint(CheckpointReader &in);
+
     private:
 
         // only a raw pointer since the data set owns this object
@@ -39,6 +46,9 @@ class StockpileNetwork : public boost::enable_shared_from_this<StockpileNetwork>
         // local stockpiles for each node
         // these stockpiles are made available for interventions
         std::map<int, boost::shared_ptr<Stockpile> > nodeStockpiles_;
+
+        // stockpiles_ followed by nodeStockpiles_ in node id order; distributions refer to stockpiles by index in this
+        std::vector<boost::shared_ptr<Stockpile> > getAllStockpiles();
 };
 
 #endif
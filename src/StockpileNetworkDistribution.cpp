@@ -1,6 +1,8 @@
 #include "StockpileNetworkDistribution.h"
 #include "StockpileNetwork.h"
 #include "EpidemicDataSet.h"
+#include "Checkpoint.h"
+#include <algorithm>
 #include "log.h"
 
 StockpileNetworkDistribution::StockpileNetworkDistribution(int time, boost::shared_ptr<Stockpile> sourceStockpile, boost::shared_ptr<Stockpile> destinationStockpile, STOCKPILE_TYPE type, int quantity, int transferTime)
@@ -245,3 +247,80 @@ int StockpileNetworkDistribution::getClampedQuantity(boost::shared_ptr<Stockpile
         return 0;
     }
 }
+
+// index of a stockpile in stockpiles, or -1 for a NULL stockpile
+int getStockpileIndex(const std::vector<boost::shared_ptr<Stockpile> > &stockpiles, boost::shared_ptr<Stockpile> stockpile)
+{
+    if(stockpile == NULL)
+    {
+        return -1;
+    }
+
+    return (int)(std::find(stockpiles.begin(), stockpiles.end(), stockpile) - stockpiles.begin());
+}
+
+bool StockpileNetworkDistribution::writeCheckpoint(CheckpointWriter &out, const std::vector<boost::shared_ptr<Stockpile> > &stockpiles)
+{
+    out.writeTag("StockpileNetworkDistribution");
+
+    out.write((boost::int32_t)time_);
+    out.write((boost::int32_t)getStockpileIndex(stockpiles, sourceStockpile_));
+    out.write((boost::int32_t)getStockpileIndex(stockpiles, destinationStockpile_));
+    out.write((boost::int32_t)type_);
+    out.write((boost::int32_t)quantity_);
+    out.write((boost::int32_t)transferTime_);
+    out.write((boost::int32_t)clampedQuantity_);
+
+    // (stockpile index, quantity) pairs
+    std::vector<boost::int32_t> clampedQuantities;
+
+    for(std::map<boost::shared_ptr<Stockpile>, int>::iterator it=clampedQuantities_.begin(); it!=clampedQuantities_.end(); it++)
+    {
+        clampedQuantities.push_back(getStockpileIndex(stockpiles, it->first));
+        clampedQuantities.push_back(it->second);
+    }
+
+    out.writeVector(clampedQuantities);
+
+    return out.good();
+}
+
+boost::shared_ptr<StockpileNetworkDistribution> StockpileNetworkDistribution::readCheckpoint(CheckpointReader &in, const std::vector<boost::shared_ptr<Stockpile> > &stockpiles)
+{
+    boost::int32_t values[7];
+    std::vector<boost::int32_t> clampedQuantities;
+
+    if(in.readTag("StockpileNetworkDistribution") != true || in.readArray(values, 7) != true || in.readVector(clampedQuantities) != true)
+    {
+        return boost::shared_ptr<StockpileNetworkDistribution>();
+    }
+
+    // all stockpile indices must be valid; only the source and destination may be NULL
+    bool valid = (values[1] >= -1 && values[1] < (int)stockpiles.size() && values[2] >= -1 && values[2] < (int)stockpiles.size()
+        && values[3] >= 0 && values[3] < NUM_STOCKPILE_TYPES && clampedQuantities.size() % 2 == 0);
+
+    for(unsigned int i=0; i<clampedQuantities.size() && valid == true; i+=2)
+    {
+        valid = (clampedQuantities[i] >= 0 && clampedQuantities[i] < (int)stockpiles.size());
+    }
+
+    if(valid != true)
+    {
+        put_flog(LOG_ERROR, "invalid distribution in checkpoint");
+        return boost::shared_ptr<StockpileNetworkDistribution>();
+    }
+
+    boost::shared_ptr<Stockpile> sourceStockpile = (values[1] >= 0 ? stockpiles[values[1]] : boost::shared_ptr<Stockpile>());
+    boost::shared_ptr<Stockpile> destinationStockpile = (values[2] >= 0 ? stockpiles[values[2]] : boost::shared_ptr<Stockpile>());
+
+    boost::shared_ptr<StockpileNetworkDistribution> distribution(new StockpileNetworkDistribution(values[0], sourceStockpile, destinationStockpile, (STOCKPILE_TYPE)values[3], values[4], values[5]));
+
+    distribution->clampedQuantity_ = values[6];
+
+    for(unsigned int i=0; i<clampedQuantities.size(); i+=2)
+    {
+        distribution->clampedQuantities_[stockpiles[clampedQuantities[i]]] = clampedQuantities[i+1];
+    }
+
+    return distribution;
+}
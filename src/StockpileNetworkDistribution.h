@@ -2,11 +2,14 @@
 #define STOCKPILE_NETWORK_DISTRIBUTION_H
 
 #include "Stockpile.h"
+#include <map>
 #include <boost/shared_ptr.hpp>
 #include <boost/weak_ptr.hpp>
-#include <QtGui>
+#include <QtCore>
 
 class StockpileNetwork;
+class CheckpointWriter;
+class CheckpointReader;
 
 class StockpileNetworkDistribution : public QObject
 {
@@ -35,6 +38,12 @@ class StockpileNetworkDistribution : public QObject
         bool hasDestinationStockpile(boost::shared_ptr<Stockpile> stockpile);
         int getClampedQuantity(boost::shared_ptr<Stockpile> destinationStockpile);
 
+        // stockpiles are written as indices into the given stockpiles (see StockpileNetwork::writeCheckpoint())
+        bool writeCheckpoint(CheckpointWriter &out, const std::vector<boost::shared_ptr<Stockpile> > &stockpiles);
+
+        // a new distribution from a checkpoint, or NULL on failure
+        static boost::shared_ptr<StockpileNetworkDistribution> readCheckpoint(CheckpointReader &in, const std::vector<boost::shared_ptr<Stockpile> > &stockpiles);
+
     signals:
 
         void applied(int clampedQuanity);
@@ -0,0 +1,706 @@
+#include "batch.h"
+#include "main.h"
+#include "EpidemicCases.h"
+#include "EpidemicOutputSink.h"
+#include "InputBundle.h"
+#include "Instrumentation.h"
+#include "Parameters.h"
+#include "models/disease/StochasticSEATIRD.h"
+#include "models/disease/DeterministicSEATIRD.h"
+#include "models/disease/iliView.h"
+#include "parallel.h"
+#include "log.h"
+#include <fstream>
+#include <algorithm>
+#include <time.h>
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+#include <QtCore>
+
+// globals shared by the GUI and headless executables
+bool g_batchMode = false;
+std::string g_batchModel = "stochastic";
+int g_batchNumTimesteps = 240;
+std::string g_batchInitialCasesFilename;
+std::string g_batchParametersFilename;
+std::string g_batchOutputVariable = "treatable";
+std::string g_batchOutputFilename = "treatable.csv";
+std::vector<std::pair<std::string, std::string> > g_batchOutputs;
+std::string g_batchNetCdfFilename;
+int g_batchNumRealizations = 1;
+int g_batchNumThreads = 0;
+int g_batchNumNodeThreads = -1;
+int g_batchTauLeapThreshold = 0;
+int g_batchSeed = -1;
+bool g_batchCompileInputs = false;
+std::string g_batchCheckpointFilename;
+int g_batchCheckpointInterval = 0;
+std::string g_batchRestoreFilename;
+std::string g_batchInstrumentationPrefix;
+
+std::string g_dataDirectory;
+
+void addBatchOptions(boost::program_options::options_description &programOptions)
+{
+    programOptions.add_options()
+        ("batch-model", boost::program_options::value<std::string>(), "model: stochastic (default), or deterministic for the mean field of the stochastic model in a single realization")
+        ("batch-numtimesteps", boost::program_options::value<int>(), "limit batch run to <n> time steps")
+        ("batch-initialcasesfilename", boost::program_options::value<std::string>(), "batch mode initial cases filename")
+        ("batch-parametersfilename", boost::program_options::value<std::string>(), "batch mode parameters filename")
+        ("batch-outputvariable", boost::program_options::value<std::string>(), "batch output variable")
+        ("batch-outputfilename", boost::program_options::value<std::string>(), "batch output filename")
+        ("batch-output", boost::program_options::value<std::vector<std::string> >()->composing(), "batch output <variable>:<filename>; may be repeated, replacing batch-outputvariable and batch-outputfilename. filenames ending in .bin are written in binary format")
+#if USE_NETCDF
+        ("batch-netcdffilename", boost::program_options::value<std::string>(), "save all variables to a compressed NetCDF file, which can be opened in the GUI")
+#endif
+        ("batch-numrealizations", boost::program_options::value<int>(), "run <n> stochastic realizations in one process")
+        ("batch-numthreads", boost::program_options::value<int>(), "number of threads for realizations (default: number of cores)")
+        ("batch-numnodethreads", boost::program_options::value<int>(), "number of threads for nodes within a realization (default: 1 with multiple realizations, otherwise number of cores)")
+        ("batch-tauleapthreshold", boost::program_options::value<int>(), "simulate nodes with at least <n> exposed and infected people by tau-leaping instead of individual events (default: 0, never)")
+        ("batch-seed", boost::program_options::value<int>(), "random seed; realization <i> uses the random number streams of (seed, <i>)")
+        ("batch-checkpointfilename", boost::program_options::value<std::string>(), "save a checkpoint of each realization at the end of the run, replacing it every batch-checkpointinterval time steps")
+        ("batch-checkpointinterval", boost::program_options::value<int>(), "save a checkpoint every <n> time steps (default: only at the end)")
+        ("batch-restorefilename", boost::program_options::value<std::string>(), "continue from a checkpoint instead of applying the initial cases; multiple realizations are reseeded after restoring")
+        ("batch-instrumentation", boost::program_options::value<std::string>(), "time the phases of each time step and count events, writing <prefix>.csv, <prefix>.json and the Chrome trace <prefix>-trace.json")
+        ("batch-compileinputs", "parse the input text files in the data directory into a binary bundle (" INPUT_BUNDLE_FILENAME "), read instead of the text files while they are unchanged")
+        ("schedulequeue", boost::program_options::value<std::string>(), "event schedule queue implementation: heap (default) or calendar")
+    ;
+}
+
+void setBatchOptions(const boost::program_options::variables_map &vm)
+{
+    if(vm.count("batch-model"))
+    {
+        g_batchModel = vm["batch-model"].as<std::string>();
+        put_flog(LOG_INFO, "got batch model %s", g_batchModel.c_str());
+    }
+
+    if(vm.count("batch-numtimesteps"))
+    {
+        g_batchNumTimesteps = vm["batch-numtimesteps"].as<int>();
+        put_flog(LOG_INFO, "got batch num time steps %i", g_batchNumTimesteps);
+    }
+
+    if(vm.count("batch-initialcasesfilename"))
+    {
+        g_batchInitialCasesFilename = vm["batch-initialcasesfilename"].as<std::string>();
+        put_flog(LOG_INFO, "got batch initial cases filename %s", g_batchInitialCasesFilename.c_str());
+    }
+
+    if(vm.count("batch-parametersfilename"))
+    {
+        g_batchParametersFilename = vm["batch-parametersfilename"].as<std::string>();
+        put_flog(LOG_INFO, "got batch parameters filename %s", g_batchParametersFilename.c_str());
+    }
+
+    if(vm.count("batch-outputvariable"))
+    {
+        g_batchOutputVariable = vm["batch-outputvariable"].as<std::string>();
+        put_flog(LOG_INFO, "got batch output variable %s", g_batchOutputVariable.c_str());
+    }
+
+    if(vm.count("batch-outputfilename"))
+    {
+        g_batchOutputFilename = vm["batch-outputfilename"].as<std::string>();
+        put_flog(LOG_INFO, "got batch output filename %s", g_batchOutputFilename.c_str());
+    }
+
+    if(vm.count("batch-output"))
+    {
+        std::vector<std::string> outputs = vm["batch-output"].as<std::vector<std::string> >();
+
+        for(unsigned int i=0; i<outputs.size(); i++)
+        {
+            // variable names do not contain ':', but filenames may
+            size_t separatorPosition = outputs[i].find(':');
+
+            if(separatorPosition == std::string::npos || separatorPosition == 0 || separatorPosition == outputs[i].size() - 1)
+            {
+                put_flog(LOG_ERROR, "invalid batch output %s, expected <variable>:<filename>", outputs[i].c_str());
+                continue;
+            }
+
+            g_batchOutputs.push_back(std::pair<std::string, std::string>(outputs[i].substr(0, separatorPosition), outputs[i].substr(separatorPosition + 1)));
+            put_flog(LOG_INFO, "got batch output variable %s, filename %s", g_batchOutputs.back().first.c_str(), g_batchOutputs.back().second.c_str());
+        }
+    }
+
+    if(vm.count("batch-netcdffilename"))
+    {
+        g_batchNetCdfFilename = vm["batch-netcdffilename"].as<std::string>();
+        put_flog(LOG_INFO, "got batch NetCDF filename %s", g_batchNetCdfFilename.c_str());
+    }
+
+    if(vm.count("batch-numrealizations"))
+    {
+        g_batchNumRealizations = vm["batch-numrealizations"].as<int>();
+        put_flog(LOG_INFO, "got batch num realizations %i", g_batchNumRealizations);
+    }
+
+    if(vm.count("batch-numthreads"))
+    {
+        g_batchNumThreads = vm["batch-numthreads"].as<int>();
+        put_flog(LOG_INFO, "got batch num threads %i", g_batchNumThreads);
+    }
+
+    if(vm.count("batch-numnodethreads"))
+    {
+        g_batchNumNodeThreads = vm["batch-numnodethreads"].as<int>();
+        put_flog(LOG_INFO, "got batch num node threads %i", g_batchNumNodeThreads);
+    }
+
+    if(vm.count("batch-tauleapthreshold"))
+    {
+        g_batchTauLeapThreshold = vm["batch-tauleapthreshold"].as<int>();
+        put_flog(LOG_INFO, "got batch tau-leap threshold %i", g_batchTauLeapThreshold);
+    }
+
+    if(vm.count("batch-seed"))
+    {
+        g_batchSeed = vm["batch-seed"].as<int>();
+        put_flog(LOG_INFO, "got batch seed %i", g_batchSeed);
+    }
+
+    if(vm.count("batch-checkpointfilename"))
+    {
+        g_batchCheckpointFilename = vm["batch-checkpointfilename"].as<std::string>();
+        put_flog(LOG_INFO, "got batch checkpoint filename %s", g_batchCheckpointFilename.c_str());
+    }
+
+    if(vm.count("batch-checkpointinterval"))
+    {
+        g_batchCheckpointInterval = vm["batch-checkpointinterval"].as<int>();
+        put_flog(LOG_INFO, "got batch checkpoint interval %i", g_batchCheckpointInterval);
+    }
+
+    if(vm.count("batch-restorefilename"))
+    {
+        g_batchRestoreFilename = vm["batch-restorefilename"].as<std::string>();
+        put_flog(LOG_INFO, "got batch restore filename %s", g_batchRestoreFilename.c_str());
+    }
+
+    if(vm.count("batch-instrumentation"))
+    {
+        g_batchInstrumentationPrefix = vm["batch-instrumentation"].as<std::string>();
+        put_flog(LOG_INFO, "got batch instrumentation prefix %s", g_batchInstrumentationPrefix.c_str());
+    }
+
+    if(vm.count("batch-compileinputs"))
+    {
+        g_batchCompileInputs = true;
+        put_flog(LOG_INFO, "got batch compile inputs");
+    }
+
+    if(vm.count("schedulequeue"))
+    {
+        std::string name = vm["schedulequeue"].as<std::string>();
+
+        EventTimeQueueType type;
+
+        if(EventTimeQueue::getTypeFromName(name, type) == true)
+        {
+            StochasticSEATIRDScheduleQueue::setDefaultType(type);
+            put_flog(LOG_INFO, "got schedule queue %s", name.c_str());
+        }
+        else
+        {
+            put_flog(LOG_ERROR, "unknown schedule queue %s, using %s", name.c_str(), EventTimeQueue::getTypeName(StochasticSEATIRDScheduleQueue::getDefaultType()).c_str());
+        }
+    }
+}
+
+std::string getApplicationDataDirectory()
+{
+    // get directory of application
+    QDir appDirectory = QDir(QCoreApplication::applicationDirPath());
+
+    // and data directory
+    QDir dataDirectory = appDirectory;
+
+#ifdef __APPLE__
+    dataDirectory.cdUp();
+    dataDirectory.cd("Resources");
+    dataDirectory.cd("data");
+#else // WIN32 or Linux
+    dataDirectory.cdUp();
+    dataDirectory.cd("data");
+#endif
+
+    return dataDirectory.absolutePath().toStdString();
+}
+
+// state shared by the realizations of a batch run
+struct BatchEnsemble
+{
+    std::vector<EpidemicCases> initialCases;
+
+    // seed of all realizations
+    int seed;
+
+    // number of threads for nodes within each realization
+    int numNodeThreads;
+
+    // (variable, filename) for each output
+    std::vector<std::pair<std::string, std::string> > outputs;
+
+    boost::mutex mutex;
+
+    int numCompleted;
+
+    // sum of each output variable over completed realizations: [time][stratification 0][stratification 1][node index]
+    std::vector<blitz::Array<double, 4> > sums;
+
+    // for output of the aggregate
+    std::vector<int> nodeIds;
+};
+
+std::string getRealizationFilename(const std::string &filename, const std::string &suffix)
+{
+    // insert the suffix before the extension, if any
+    size_t extensionPosition = filename.find_last_of('.');
+    size_t directoryPosition = filename.find_last_of("/\\");
+
+    if(extensionPosition == std::string::npos || (directoryPosition != std::string::npos && extensionPosition < directoryPosition))
+    {
+        return filename + "-" + suffix;
+    }
+
+    return filename.substr(0, extensionPosition) + "-" + suffix + filename.substr(extensionPosition);
+}
+
+void runBatchRealization(BatchEnsemble * ensemble, int realization)
+{
+    boost::shared_ptr<EpidemicSimulation> simulation;
+
+    // for the options of the stochastic model; NULL for the deterministic model
+    boost::shared_ptr<StochasticSEATIRD> stochasticSimulation;
+
+    if(g_batchModel == "deterministic")
+    {
+        simulation = boost::shared_ptr<EpidemicSimulation>(new DeterministicSEATIRD());
+    }
+    else
+    {
+        // use StochasticSEATIRD model
+        // realizations share the seed; the realization number selects independent random number streams
+        stochasticSimulation = boost::shared_ptr<StochasticSEATIRD>(new StochasticSEATIRD(ensemble->seed, realization));
+        simulation = stochasticSimulation;
+    }
+
+    if(simulation->isValid() != true)
+    {
+        put_flog(LOG_ERROR, "could not create simulation for realization %i (data directory %s)", realization, g_dataDirectory.c_str());
+        return;
+    }
+
+    // the number of time steps is known, so reserve storage for all of them
+    simulation->reserveTimes(g_batchNumTimesteps + 1);
+
+    if(stochasticSimulation != NULL)
+    {
+        stochasticSimulation->setNumNodeThreads(ensemble->numNodeThreads);
+        stochasticSimulation->setTauLeapThreshold(g_batchTauLeapThreshold);
+    }
+
+    // realization suffix for output filenames; a single realization keeps filenames unchanged
+    std::string suffix;
+
+    if(g_batchNumRealizations > 1)
+    {
+        char suffixString[32];
+        sprintf(suffixString, "%03d", realization);
+
+        suffix = suffixString;
+    }
+
+    if(g_batchInstrumentationPrefix.empty() != true)
+    {
+        std::string prefix = g_batchInstrumentationPrefix;
+
+        if(suffix.empty() != true)
+        {
+            prefix += "-" + suffix;
+        }
+
+        // realizations are separate processes of the trace
+        boost::shared_ptr<Instrumentation> instrumentation(new Instrumentation(realization));
+
+        if(instrumentation->open(prefix) != true)
+        {
+            return;
+        }
+
+        simulation->setInstrumentation(instrumentation);
+    }
+
+    if(g_batchRestoreFilename.empty() != true)
+    {
+        // a restored simulation already includes the initial cases
+        if(simulation->loadCheckpoint(g_batchRestoreFilename) != true)
+        {
+            put_flog(LOG_ERROR, "could not restore realization %i from %s", realization, g_batchRestoreFilename.c_str());
+            return;
+        }
+
+        // otherwise all realizations would continue identically
+        if(g_batchNumRealizations > 1 && stochasticSimulation != NULL)
+        {
+            stochasticSimulation->reseed(ensemble->seed, realization);
+        }
+    }
+    else
+    {
+        // apply the initial cases before the first time step
+        for(unsigned int i=0; i<ensemble->initialCases.size(); i++)
+        {
+            put_flog(LOG_DEBUG, "exposing %i people in %i", ensemble->initialCases[i].num, ensemble->initialCases[i].nodeId);
+
+            simulation->expose(ensemble->initialCases[i].num, ensemble->initialCases[i].nodeId, ensemble->initialCases[i].stratificationValues);
+        }
+    }
+
+    // time step the simulation starts from; after the final time step for a restored simulation
+    int startTime = simulation->getNumTimes() - 1;
+
+    if(startTime > g_batchNumTimesteps)
+    {
+        put_flog(LOG_ERROR, "restored time %i is after the final time step %i", startTime, g_batchNumTimesteps);
+        return;
+    }
+
+    std::string checkpointFilename = g_batchCheckpointFilename;
+
+    if(checkpointFilename.empty() != true && suffix.empty() != true)
+    {
+        checkpointFilename = getRealizationFilename(checkpointFilename, suffix);
+    }
+
+    // outputs are written as each time step completes
+    std::vector<boost::shared_ptr<EpidemicOutputSink> > sinks;
+
+    std::vector<std::string> variableNames = simulation->getVariableNames();
+
+    for(unsigned int i=0; i<ensemble->outputs.size(); i++)
+    {
+        if(std::find(variableNames.begin(), variableNames.end(), ensemble->outputs[i].first) == variableNames.end())
+        {
+            put_flog(LOG_ERROR, "could not generate output for variable %s", ensemble->outputs[i].first.c_str());
+            return;
+        }
+
+        std::string filename = ensemble->outputs[i].second;
+
+        if(suffix.empty() != true)
+        {
+            filename = getRealizationFilename(filename, suffix);
+        }
+
+        boost::shared_ptr<EpidemicOutputSink> sink = EpidemicOutputSink::create(ensemble->outputs[i].first, filename);
+
+        if(sink->open(*simulation) != true)
+        {
+            put_flog(LOG_ERROR, "could not open output %s", filename.c_str());
+            return;
+        }
+
+        sinks.push_back(sink);
+    }
+
+    // a time step is written once the following time step has been simulated,
+    // since some derived variables (ILI) for a time are computed while simulating the next time step
+    bool success = true;
+
+    // a restored simulation has all time steps up to the checkpoint
+    for(int t=0; t<startTime; t++)
+    {
+        for(unsigned int i=0; i<sinks.size(); i++)
+        {
+            success = sinks[i]->write(*simulation, t) && success;
+        }
+    }
+
+    for(int t=startTime; t<g_batchNumTimesteps; t++)
+    {
+        simulation->simulate();
+
+        for(unsigned int i=0; i<sinks.size(); i++)
+        {
+            success = sinks[i]->write(*simulation, t) && success;
+        }
+
+        // periodic checkpoints, so a failed run can continue from the latest one
+        if(checkpointFilename.empty() != true && g_batchCheckpointInterval > 0 && (t+1) % g_batchCheckpointInterval == 0 && t+1 < g_batchNumTimesteps)
+        {
+            success = simulation->saveCheckpoint(checkpointFilename) && success;
+        }
+    }
+
+    if(checkpointFilename.empty() != true)
+    {
+        success = simulation->saveCheckpoint(checkpointFilename) && success;
+    }
+
+    for(unsigned int i=0; i<sinks.size(); i++)
+    {
+        success = sinks[i]->write(*simulation, g_batchNumTimesteps) && success;
+        success = sinks[i]->close() && success;
+    }
+
+    if(success != true)
+    {
+        put_flog(LOG_ERROR, "could not write output for realization %i", realization);
+        return;
+    }
+
+    // all variables, in a separate file for each realization
+    if(g_batchNetCdfFilename.empty() != true)
+    {
+        std::string filename = g_batchNetCdfFilename;
+
+        if(suffix.empty() != true)
+        {
+            filename = getRealizationFilename(filename, suffix);
+        }
+
+        if(simulation->saveNetCdfFile(filename.c_str()) != true)
+        {
+            put_flog(LOG_ERROR, "could not save realization %i to %s", realization, filename.c_str());
+            return;
+        }
+    }
+
+    // values for the aggregate output, computed outside of the lock
+    std::vector<blitz::Array<double, 4> > values(ensemble->outputs.size());
+
+    std::vector<int> stratificationValues(2, 0);
+
+    for(unsigned int i=0; i<values.size(); i++)
+    {
+        values[i].resize(ensemble->sums[i].shape());
+
+        for(int t=0; t<values[i].extent(0); t++)
+        {
+            for(int s1=0; s1<values[i].extent(1); s1++)
+            {
+                stratificationValues[0] = s1;
+
+                for(int s2=0; s2<values[i].extent(2); s2++)
+                {
+                    stratificationValues[1] = s2;
+
+                    for(int n=0; n<values[i].extent(3); n++)
+                    {
+                        values[i](t, s1, s2, n) = simulation->getValue(ensemble->outputs[i].first, t, ensemble->nodeIds[n], stratificationValues);
+                    }
+                }
+            }
+        }
+    }
+
+    boost::mutex::scoped_lock lock(ensemble->mutex);
+
+    for(unsigned int i=0; i<values.size(); i++)
+    {
+        ensemble->sums[i] += values[i];
+    }
+
+    ensemble->numCompleted++;
+
+    put_flog(LOG_INFO, "completed realization %i (%i of %i)", realization, ensemble->numCompleted, g_batchNumRealizations);
+}
+
+bool writeBatchMean(BatchEnsemble &ensemble, int output, const std::string &filename)
+{
+    // same format as the output of each realization
+    boost::shared_ptr<EpidemicOutputSink> sink = EpidemicOutputSink::create(ensemble.outputs[output].first, filename);
+
+    if(sink->open(ensemble.nodeIds, EpidemicDataSet::getStratifications()) != true)
+    {
+        return false;
+    }
+
+    const blitz::Array<double, 4> &sum = ensemble.sums[output];
+
+    std::vector<float> values(sum.extent(1) * sum.extent(2) * sum.extent(3));
+
+    bool success = true;
+
+    for(int t=0; t<sum.extent(0); t++)
+    {
+        unsigned int index = 0;
+
+        for(int s1=0; s1<sum.extent(1); s1++)
+        {
+            for(int s2=0; s2<sum.extent(2); s2++)
+            {
+                for(int n=0; n<sum.extent(3); n++)
+                {
+                    values[index] = (float)(sum(t, s1, s2, n) / (double)ensemble.numCompleted);
+                    index++;
+                }
+            }
+        }
+
+        success = sink->write(t, values) && success;
+    }
+
+    return sink->close() && success;
+}
+
+int compileInputs()
+{
+    // the data set parses the text files again, even if a bundle exists
+    EpidemicDataSet dataSet;
+
+    InputBundle bundle;
+
+    if(dataSet.addInputData(bundle) != true || addIliData(bundle) != true)
+    {
+        put_flog(LOG_FATAL, "could not read input files in %s", g_dataDirectory.c_str());
+        return 1;
+    }
+
+    std::string filename = g_dataDirectory + "/" + INPUT_BUNDLE_FILENAME;
+
+    if(bundle.write(filename) != true)
+    {
+        put_flog(LOG_FATAL, "could not write input bundle %s", filename.c_str());
+        return 1;
+    }
+
+    return 0;
+}
+
+int runBatch()
+{
+    put_flog(LOG_INFO, "starting batch mode");
+
+    if(g_batchCompileInputs == true)
+    {
+        return compileInputs();
+    }
+
+    // parameters must be loaded before any events are scheduled
+    if(g_batchParametersFilename.empty() != true)
+    {
+        if(g_parameters.loadXmlData(g_batchParametersFilename) != true)
+        {
+            put_flog(LOG_FATAL, "could not load parameters file %s", g_batchParametersFilename.c_str());
+            return 1;
+        }
+    }
+
+    BatchEnsemble ensemble;
+
+    ensemble.initialCases = getDefaultEpidemicCases();
+
+    if(g_batchInitialCasesFilename.empty() != true)
+    {
+        if(loadEpidemicCasesXml(g_batchInitialCasesFilename, ensemble.initialCases) != true)
+        {
+            put_flog(LOG_FATAL, "could not load initial cases file %s", g_batchInitialCasesFilename.c_str());
+            return 1;
+        }
+    }
+
+    if(g_batchModel != "stochastic" && g_batchModel != "deterministic")
+    {
+        put_flog(LOG_FATAL, "unknown model %s", g_batchModel.c_str());
+        return 1;
+    }
+
+    if(g_batchNumRealizations < 1)
+    {
+        put_flog(LOG_FATAL, "invalid number of realizations %i", g_batchNumRealizations);
+        return 1;
+    }
+
+    // realizations of the deterministic model would all be the same
+    if(g_batchModel == "deterministic" && g_batchNumRealizations > 1)
+    {
+        put_flog(LOG_WARN, "the deterministic model has a single realization, not %i", g_batchNumRealizations);
+        g_batchNumRealizations = 1;
+    }
+
+    // realizations of an ensemble share a seed, so choose one if none was given; it is logged, so the run can be repeated
+    ensemble.seed = g_batchSeed;
+
+    if(ensemble.seed < 0)
+    {
+        ensemble.seed = (int)(time(NULL) & 0x7fffffff);
+    }
+
+    // realizations already run concurrently, so by default each one processes its nodes serially
+    ensemble.numNodeThreads = g_batchNumNodeThreads;
+
+    if(ensemble.numNodeThreads < 0)
+    {
+        ensemble.numNodeThreads = (g_batchNumRealizations > 1) ? 1 : 0;
+    }
+
+    put_flog(LOG_INFO, "running %i realizations, seed %i", g_batchNumRealizations, ensemble.seed);
+
+    // load the input data (stratifications, nodes, populations, travel) once, before starting any threads
+    EpidemicDataSet dataSet;
+
+    if(dataSet.isValid() != true)
+    {
+        put_flog(LOG_FATAL, "could not load input data (data directory %s)", g_dataDirectory.c_str());
+        return 1;
+    }
+
+    std::vector<std::vector<std::string> > stratifications = EpidemicDataSet::getStratifications();
+
+    if(stratifications.size() < 2)
+    {
+        put_flog(LOG_FATAL, "need at least 2 stratifications");
+        return 1;
+    }
+
+    ensemble.nodeIds = dataSet.getNodeIds();
+    ensemble.numCompleted = 0;
+
+    // batch-output options, or the single batch-outputvariable / batch-outputfilename output
+    ensemble.outputs = g_batchOutputs;
+
+    if(ensemble.outputs.size() == 0)
+    {
+        ensemble.outputs.push_back(std::pair<std::string, std::string>(g_batchOutputVariable, g_batchOutputFilename));
+    }
+
+    // the initial time plus one for each time step
+    ensemble.sums.resize(ensemble.outputs.size());
+
+    for(unsigned int i=0; i<ensemble.sums.size(); i++)
+    {
+        ensemble.sums[i].resize(g_batchNumTimesteps + 1, stratifications[0].size(), stratifications[1].size(), ensemble.nodeIds.size());
+        ensemble.sums[i] = 0.;
+    }
+
+    parallelFor(g_batchNumRealizations, g_batchNumThreads, boost::bind(&runBatchRealization, &ensemble, _1));
+
+    if(ensemble.numCompleted != g_batchNumRealizations)
+    {
+        put_flog(LOG_FATAL, "only %i of %i realizations completed", ensemble.numCompleted, g_batchNumRealizations);
+        return 1;
+    }
+
+    // aggregate output over all realizations
+    if(g_batchNumRealizations > 1)
+    {
+        for(unsigned int i=0; i<ensemble.outputs.size(); i++)
+        {
+            std::string meanFilename = getRealizationFilename(ensemble.outputs[i].second, "mean");
+
+            if(writeBatchMean(ensemble, i, meanFilename) != true)
+            {
+                put_flog(LOG_FATAL, "could not write aggregate output %s", meanFilename.c_str());
+                return 1;
+            }
+        }
+    }
+
+    put_flog(LOG_INFO, "done with batch mode");
+
+    return 0;
+}
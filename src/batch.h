@@ -0,0 +1,26 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <boost/program_options.hpp>
+
+// add the batch mode options to a program options description
+extern void addBatchOptions(boost::program_options::options_description &programOptions);
+
+// set the batch mode globals (see main.h) from parsed program options
+extern void setBatchOptions(const boost::program_options::variables_map &vm);
+
+// data directory relative to the application directory; requires a QCoreApplication instance
+extern std::string getApplicationDataDirectory();
+
+// run a simulation in batch mode and write its output
+// this only uses the simulation engine: no QApplication, MainWindow or display is required
+// with multiple realizations, the input data is loaded once and realizations run concurrently;
+// each realization writes <output>-<nnn>.<ext>, and the mean over realizations is written to <output>-mean.<ext>
+// outputs are written as the simulation progresses, one for each output variable (see EpidemicOutputSink)
+// realizations can be saved to checkpoints as they run, and continued from a checkpoint (see EpidemicSimulation::saveCheckpoint())
+// with g_batchCompileInputs, this instead writes the input bundle (see InputBundle) to the data directory
+// returns the process exit code
+extern int runBatch();
+
+#endif
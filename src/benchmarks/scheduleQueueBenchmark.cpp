@@ -0,0 +1,257 @@
+// benchmark of the schedule queue implementations (exercise-benchmark-schedulequeue)
+// compares a boost pairing heap against the EventTimeQueue heap and calendar backends, and the
+// StochasticSEATIRDScheduleQueue (schedules stored in place, with the registry) on each backend
+//
+// this is a "hold" model of the StochasticSEATIRD event loop: a fixed number of active schedules,
+// consumed in day-sized windows; each processed schedule is requeued at its next event time
+//
+// usage: exercise-benchmark-schedulequeue [numSchedules ...]
+
+#include "../models/EventTimeQueue.h"
+#include "../models/RandomStream.h"
+#include "../models/random.h"
+#include "../models/disease/StochasticSEATIRDScheduleQueue.h"
+#include "../models/disease/SEATIRDConstants.h"
+#include <boost/heap/pairing_heap.hpp>
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+// mean time between events of a schedule, in days
+#define BENCHMARK_MEAN_EVENT_INTERVAL 0.5
+
+// minimum number of events processed per run
+#define BENCHMARK_MIN_NUM_EVENTS 2000000
+
+struct BenchmarkResult
+{
+    double seconds;
+    long numEvents;
+
+    // order-dependent checksum of the processed indices
+    unsigned long checksum;
+};
+
+struct PairingHeapEntry
+{
+    double time;
+    int index;
+
+    bool operator<(const PairingHeapEntry &rhs) const
+    {
+        if(time != rhs.time)
+        {
+            return time > rhs.time;
+        }
+
+        return index > rhs.index;
+    }
+};
+
+// minimal queue interface over boost::heap::pairing_heap, matching EventTimeQueue
+class PairingHeapQueue
+{
+    public:
+
+        void push(const double &time, const int &index)
+        {
+            PairingHeapEntry entry;
+            entry.time = time;
+            entry.index = index;
+
+            heap_.push(entry);
+        }
+
+        bool empty() const
+        {
+            return heap_.empty();
+        }
+
+        int top() const
+        {
+            return heap_.top().index;
+        }
+
+        double getTopTime() const
+        {
+            return heap_.top().time;
+        }
+
+        void pop()
+        {
+            heap_.pop();
+        }
+
+    private:
+
+        boost::heap::pairing_heap<PairingHeapEntry> heap_;
+};
+
+template <class Queue> BenchmarkResult runBenchmark(Queue &queue, int numSchedules, unsigned long seed)
+{
+    RandomStream rand((boost::uint32_t)seed);
+
+    for(int i=0; i<numSchedules; i++)
+    {
+        queue.push(random_exponential(1. / BENCHMARK_MEAN_EVENT_INTERVAL, &rand), i);
+    }
+
+    BenchmarkResult result;
+    result.numEvents = 0;
+    result.checksum = 0;
+
+    clock_t start = clock();
+
+    for(int day=0; result.numEvents < BENCHMARK_MIN_NUM_EVENTS || result.numEvents < numSchedules; day++)
+    {
+        while(queue.empty() != true && queue.getTopTime() < (double)day + 1.)
+        {
+            double time = queue.getTopTime();
+            int index = queue.top();
+            queue.pop();
+
+            result.checksum = result.checksum * 31 + (unsigned long)index;
+            result.numEvents++;
+
+            queue.push(time + random_exponential(1. / BENCHMARK_MEAN_EVENT_INTERVAL, &rand), index);
+        }
+    }
+
+    result.seconds = (double)(clock() - start) / (double)CLOCKS_PER_SEC;
+
+    return result;
+}
+
+// the same model with schedules: each processed schedule pops its event and gets the next one, as contacts do
+BenchmarkResult runScheduleQueueBenchmark(const EventTimeQueueType &type, int numSchedules, unsigned long seed)
+{
+    RandomStream rand((boost::uint32_t)seed);
+
+    StochasticSEATIRDScheduleQueue::setDefaultType(type);
+
+    StochasticSEATIRDScheduleQueue queue;
+
+    // schedules are spread over the strata, so registration is exercised as in a simulation
+    std::vector<int> stratificationValues(NUM_STRATIFICATION_DIMENSIONS, 0);
+
+    for(int i=0; i<numSchedules; i++)
+    {
+        stratificationValues[0] = i % numAgeGroups;
+        stratificationValues[1] = (i / numAgeGroups) % numRiskGroups;
+
+        StochasticSEATIRDSchedule schedule;
+        schedule.changeStratificationValues(stratificationValues);
+        schedule.insertEvent(StochasticSEATIRDEvent::create(0., random_exponential(1. / BENCHMARK_MEAN_EVENT_INTERVAL, &rand), CONTACT, stratificationValues));
+
+        queue.insert(schedule);
+    }
+
+    BenchmarkResult result;
+    result.numEvents = 0;
+    result.checksum = 0;
+
+    clock_t start = clock();
+
+    for(int day=0; result.numEvents < BENCHMARK_MIN_NUM_EVENTS || result.numEvents < numSchedules; day++)
+    {
+        while(queue.empty() != true && queue.getTopTime() < (double)day + 1.)
+        {
+            double time = queue.getTopTime();
+            int index = queue.top();
+            queue.pop();
+
+            StochasticSEATIRDSchedule &schedule = queue.getSchedule(index);
+            StochasticSEATIRDEvent event = schedule.getTopEvent();
+            schedule.popTopEvent();
+
+            result.checksum = result.checksum * 31 + (unsigned long)index;
+            result.numEvents++;
+
+            schedule.insertEvent(StochasticSEATIRDEvent::create(time, time + random_exponential(1. / BENCHMARK_MEAN_EVENT_INTERVAL, &rand), CONTACT, event.getFromStratificationValues()));
+
+            queue.requeue(index);
+        }
+    }
+
+    result.seconds = (double)(clock() - start) / (double)CLOCKS_PER_SEC;
+
+    return result;
+}
+
+void printResult(const std::string &name, int numSchedules, const BenchmarkResult &result)
+{
+    printf("%-17s %10i schedules: %10li events in %8.3f s (%7.1f ns/event), checksum %lx\n", name.c_str(), numSchedules, result.numEvents, result.seconds, 1.e9 * result.seconds / (double)result.numEvents, result.checksum);
+}
+
+int main(int argc, char * argv[])
+{
+    std::vector<int> sizes;
+
+    for(int i=1; i<argc; i++)
+    {
+        sizes.push_back(atoi(argv[i]));
+    }
+
+    if(sizes.size() == 0)
+    {
+        sizes.push_back(10000);
+        sizes.push_back(1000000);
+        sizes.push_back(10000000);
+    }
+
+    bool identical = true;
+
+    for(unsigned int i=0; i<sizes.size(); i++)
+    {
+        unsigned long seed = 12345;
+
+        BenchmarkResult pairingHeapResult;
+        BenchmarkResult heapResult;
+        BenchmarkResult calendarResult;
+        BenchmarkResult scheduleHeapResult;
+        BenchmarkResult scheduleCalendarResult;
+
+        // each queue is destroyed before the next one runs, to limit memory use
+        {
+            PairingHeapQueue queue;
+            pairingHeapResult = runBenchmark(queue, sizes[i], seed);
+        }
+
+        {
+            EventTimeQueue queue(EVENT_TIME_QUEUE_HEAP);
+            heapResult = runBenchmark(queue, sizes[i], seed);
+        }
+
+        {
+            EventTimeQueue queue(EVENT_TIME_QUEUE_CALENDAR);
+            calendarResult = runBenchmark(queue, sizes[i], seed);
+        }
+
+        scheduleHeapResult = runScheduleQueueBenchmark(EVENT_TIME_QUEUE_HEAP, sizes[i], seed);
+        scheduleCalendarResult = runScheduleQueueBenchmark(EVENT_TIME_QUEUE_CALENDAR, sizes[i], seed);
+
+        printResult("pairing heap", sizes[i], pairingHeapResult);
+        printResult("heap", sizes[i], heapResult);
+        printResult("calendar", sizes[i], calendarResult);
+        printResult("schedule heap", sizes[i], scheduleHeapResult);
+        printResult("schedule calendar", sizes[i], scheduleCalendarResult);
+
+        // the heap and calendar backends must process events in exactly the same order
+        if(heapResult.checksum != calendarResult.checksum || heapResult.numEvents != calendarResult.numEvents)
+        {
+            std::cerr << "calendar order differs from heap order for " << sizes[i] << " schedules" << std::endl;
+            identical = false;
+        }
+
+        // schedules are processed in the same order as plain entries, on either backend
+        if(scheduleHeapResult.checksum != heapResult.checksum || scheduleCalendarResult.checksum != heapResult.checksum)
+        {
+            std::cerr << "schedule queue order differs from heap order for " << sizes[i] << " schedules" << std::endl;
+            identical = false;
+        }
+    }
+
+    return (identical == true) ? 0 : 1;
+}
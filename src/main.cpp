@@ -1,20 +1,15 @@
 #include "main.h"
 #include "MainWindow.h"
+#include "batch.h"
 #include "log.h"
 #include <QtGui>
 #include <QtNetwork/QTcpSocket>
 #include <vtkObject.h>
 #include <boost/program_options.hpp>
-
-bool g_batchMode = false;
-int g_batchNumTimesteps = 240;
-std::string g_batchInitialCasesFilename;
-std::string g_batchParametersFilename;
-std::string g_batchOutputVariable = "treatable";
-std::string g_batchOutputFilename = "treatable.csv";
+#include <cstring>
+#include <iostream>
 
 MainWindow * g_mainWindow = NULL;
-std::string g_dataDirectory;
 
 #if USE_DISPLAYCLUSTER
     DcSocket * g_dcSocket = NULL;
@@ -22,8 +17,28 @@ std::string g_dataDirectory;
 
 int main(int argc, char * argv[])
 {
+    // batch mode does not need a display, so check for it before creating the application object
+    bool batchMode = false;
+
+    for(int i=1; i<argc; i++)
+    {
+        if(strcmp(argv[i], "--batch") == 0)
+        {
+            batchMode = true;
+        }
+    }
+
     // parse Qt commandline options first
-    QApplication * app = new QApplication(argc, argv);
+    QCoreApplication * app = NULL;
+
+    if(batchMode == true)
+    {
+        app = new QCoreApplication(argc, argv);
+    }
+    else
+    {
+        app = new QApplication(argc, argv);
+    }
 
     // declare the supported options
     boost::program_options::options_description programOptions("Allowed options");
@@ -31,13 +46,10 @@ int main(int argc, char * argv[])
     programOptions.add_options()
         ("help", "produce help message")
         ("batch", "run in batch mode")
-        ("batch-numtimesteps", boost::program_options::value<int>(), "limit batch run to <n> time steps")
-        ("batch-initialcasesfilename", boost::program_options::value<std::string>(), "batch mode initial cases filename")
-        ("batch-parametersfilename", boost::program_options::value<std::string>(), "batch mode parameters filename")
-        ("batch-outputvariable", boost::program_options::value<std::string>(), "batch output variable")
-        ("batch-outputfilename", boost::program_options::value<std::string>(), "batch output filename")
     ;
 
+    addBatchOptions(programOptions);
+
     boost::program_options::variables_map vm;
     boost::program_options::store(boost::program_options::parse_command_line(argc, argv, programOptions), vm);
     boost::program_options::notify(vm);
@@ -55,56 +67,23 @@ int main(int argc, char * argv[])
         g_batchMode = true;
     }
 
-    if(vm.count("batch-numtimesteps"))
-    {
-        g_batchNumTimesteps = vm["batch-numtimesteps"].as<int>();
-        put_flog(LOG_INFO, "got batch num time steps %i", g_batchNumTimesteps);
-    }
-
-    if(vm.count("batch-initialcasesfilename"))
-    {
-        g_batchInitialCasesFilename = vm["batch-initialcasesfilename"].as<std::string>();
-        put_flog(LOG_INFO, "got batch initial cases filename %s", g_batchInitialCasesFilename.c_str());
-    }
-
-    if(vm.count("batch-parametersfilename"))
-    {
-        g_batchParametersFilename = vm["batch-parametersfilename"].as<std::string>();
-        put_flog(LOG_INFO, "got batch parameters filename %s", g_batchParametersFilename.c_str());
-    }
-
-    if(vm.count("batch-outputvariable"))
-    {
-        g_batchOutputVariable = vm["batch-outputvariable"].as<std::string>();
-        put_flog(LOG_INFO, "got batch output variable %s", g_batchOutputVariable.c_str());
-    }
-
-    if(vm.count("batch-outputfilename"))
-    {
-        g_batchOutputFilename = vm["batch-outputfilename"].as<std::string>();
-        put_flog(LOG_INFO, "got batch output filename %s", g_batchOutputFilename.c_str());
-    }
+    setBatchOptions(vm);
 
     // end argument parsing
 
-    // get directory of application
-    QDir appDirectory = QDir(QCoreApplication::applicationDirPath());
+    g_dataDirectory = getApplicationDataDirectory();
 
-    // and data directory
-    QDir dataDirectory = appDirectory;
+    put_flog(LOG_DEBUG, "data directory: %s", g_dataDirectory.c_str());
 
-#ifdef __APPLE__
-    dataDirectory.cdUp();
-    dataDirectory.cd("Resources");
-    dataDirectory.cd("data");
-#else // WIN32 or Linux
-    dataDirectory.cdUp();
-    dataDirectory.cd("data");
-#endif
+    // batch mode runs the simulation engine directly, without a MainWindow
+    if(g_batchMode == true)
+    {
+        int status = runBatch();
 
-    g_dataDirectory = dataDirectory.absolutePath().toStdString();
+        delete app;
 
-    put_flog(LOG_DEBUG, "data directory: %s", g_dataDirectory.c_str());
+        return status;
+    }
 
     // disable VTK console messages
     vtkObject::GlobalWarningDisplayOff();
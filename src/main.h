@@ -2,15 +2,30 @@
 #define MAIN_H
 
 #include <string>
+#include <vector>
+#include <utility>
 
 class MainWindow;
 
 extern bool g_batchMode;
+extern std::string g_batchModel;
 extern int g_batchNumTimesteps;
 extern std::string g_batchInitialCasesFilename;
 extern std::string g_batchParametersFilename;
 extern std::string g_batchOutputVariable;
 extern std::string g_batchOutputFilename;
+extern std::vector<std::pair<std::string, std::string> > g_batchOutputs;
+extern std::string g_batchNetCdfFilename;
+extern int g_batchNumRealizations;
+extern int g_batchNumThreads;
+extern int g_batchNumNodeThreads;
+extern int g_batchTauLeapThreshold;
+extern int g_batchSeed;
+extern bool g_batchCompileInputs;
+extern std::string g_batchCheckpointFilename;
+extern int g_batchCheckpointInterval;
+extern std::string g_batchRestoreFilename;
+extern std::string g_batchInstrumentationPrefix;
 
 extern MainWindow * g_mainWindow;
 extern std::string g_dataDirectory;
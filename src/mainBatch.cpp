@@ -0,0 +1,46 @@
+// entry point for the headless batch executable (exercise-batch)
+// this links only the simulation engine: no GUI, VTK or OpenGL
+
+#include "batch.h"
+#include "main.h"
+#include "log.h"
+#include <QtCore>
+#include <boost/program_options.hpp>
+#include <iostream>
+
+int main(int argc, char * argv[])
+{
+    // a core application is sufficient to locate the data directory; no display is needed
+    QCoreApplication app(argc, argv);
+
+    // declare the supported options
+    boost::program_options::options_description programOptions("Allowed options");
+
+    programOptions.add_options()
+        ("help", "produce help message")
+    ;
+
+    addBatchOptions(programOptions);
+
+    boost::program_options::variables_map vm;
+    boost::program_options::store(boost::program_options::parse_command_line(argc, argv, programOptions), vm);
+    boost::program_options::notify(vm);
+
+    if(vm.count("help"))
+    {
+        std::cout << programOptions << std::endl;
+        return 1;
+    }
+
+    g_batchMode = true;
+
+    setBatchOptions(vm);
+
+    // end argument parsing
+
+    g_dataDirectory = getApplicationDataDirectory();
+
+    put_flog(LOG_DEBUG, "data directory: %s", g_dataDirectory.c_str());
+
+    return runBatch();
+}
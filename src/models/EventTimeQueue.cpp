@@ -0,0 +1,209 @@
+#include "EventTimeQueue.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+EventTimeQueue::EventTimeQueue(EventTimeQueueType type)
+{
+    type_ = type;
+    size_ = 0;
+
+    currentBucket_ = 0;
+    numBucketEntries_ = 0;
+
+    if(type_ == EVENT_TIME_QUEUE_CALENDAR)
+    {
+        buckets_.resize(calendarNumBuckets_);
+    }
+}
+
+EventTimeQueueType EventTimeQueue::getType() const
+{
+    return type_;
+}
+
+void EventTimeQueue::push(const double &time, const int &index)
+{
+    Entry entry;
+    entry.time = time;
+    entry.index = index;
+
+    if(type_ == EVENT_TIME_QUEUE_HEAP)
+    {
+        heap_.push_back(entry);
+        std::push_heap(heap_.begin(), heap_.end());
+
+        size_++;
+
+        return;
+    }
+
+    int bucket = getBucket(time);
+
+    // an empty calendar can start anywhere
+    if(size_ == 0)
+    {
+        currentBucket_ = bucket;
+    }
+
+    if(bucket <= currentBucket_)
+    {
+        // earlier entries can only be added to the current bucket, which is ordered by time
+        std::vector<Entry> &current = buckets_[currentBucket_ % calendarNumBuckets_];
+
+        current.push_back(entry);
+        std::push_heap(current.begin(), current.end());
+
+        numBucketEntries_++;
+    }
+    else if(bucket - currentBucket_ < calendarNumBuckets_)
+    {
+        buckets_[bucket % calendarNumBuckets_].push_back(entry);
+
+        numBucketEntries_++;
+    }
+    else
+    {
+        overflow_.push_back(entry);
+        std::push_heap(overflow_.begin(), overflow_.end());
+    }
+
+    size_++;
+}
+
+bool EventTimeQueue::empty() const
+{
+    return (size_ == 0);
+}
+
+int EventTimeQueue::size() const
+{
+    return size_;
+}
+
+int EventTimeQueue::top() const
+{
+    if(type_ == EVENT_TIME_QUEUE_HEAP)
+    {
+        return heap_.front().index;
+    }
+
+    return buckets_[currentBucket_ % calendarNumBuckets_].front().index;
+}
+
+double EventTimeQueue::getTopTime() const
+{
+    if(type_ == EVENT_TIME_QUEUE_HEAP)
+    {
+        return heap_.front().time;
+    }
+
+    return buckets_[currentBucket_ % calendarNumBuckets_].front().time;
+}
+
+void EventTimeQueue::pop()
+{
+    if(type_ == EVENT_TIME_QUEUE_HEAP)
+    {
+        std::pop_heap(heap_.begin(), heap_.end());
+        heap_.pop_back();
+
+        size_--;
+
+        return;
+    }
+
+    std::vector<Entry> &current = buckets_[currentBucket_ % calendarNumBuckets_];
+
+    std::pop_heap(current.begin(), current.end());
+    current.pop_back();
+
+    numBucketEntries_--;
+    size_--;
+
+    advanceCalendar();
+}
+
+bool EventTimeQueue::getTypeFromName(const std::string &name, EventTimeQueueType &type)
+{
+    if(name == "heap")
+    {
+        type = EVENT_TIME_QUEUE_HEAP;
+        return true;
+    }
+    else if(name == "calendar")
+    {
+        type = EVENT_TIME_QUEUE_CALENDAR;
+        return true;
+    }
+
+    return false;
+}
+
+std::string EventTimeQueue::getTypeName(const EventTimeQueueType &type)
+{
+    if(type == EVENT_TIME_QUEUE_CALENDAR)
+    {
+        return "calendar";
+    }
+
+    return "heap";
+}
+
+int EventTimeQueue::getBucket(const double &time) const
+{
+    double bucket = floor(time * (double)calendarBucketsPerDay_);
+
+    // keep far future times representable; they stay in the overflow until the window reaches them
+    if(bucket > (double)(INT_MAX / 2))
+    {
+        return INT_MAX / 2;
+    }
+    else if(bucket < 0.)
+    {
+        return 0;
+    }
+
+    return (int)bucket;
+}
+
+void EventTimeQueue::advanceCalendar()
+{
+    if(size_ == 0)
+    {
+        return;
+    }
+
+    while(buckets_[currentBucket_ % calendarNumBuckets_].empty() == true)
+    {
+        if(numBucketEntries_ == 0)
+        {
+            // only overflow entries remain, so skip directly to the first of them
+            currentBucket_ = getBucket(overflow_.front().time);
+        }
+        else
+        {
+            currentBucket_++;
+        }
+
+        // move overflow entries that are now within the window into their buckets
+        while(overflow_.empty() != true && getBucket(overflow_.front().time) - currentBucket_ < calendarNumBuckets_)
+        {
+            Entry entry = overflow_.front();
+
+            std::pop_heap(overflow_.begin(), overflow_.end());
+            overflow_.pop_back();
+
+            buckets_[getBucket(entry.time) % calendarNumBuckets_].push_back(entry);
+
+            numBucketEntries_++;
+        }
+
+        std::vector<Entry> &current = buckets_[currentBucket_ % calendarNumBuckets_];
+
+        if(current.empty() != true)
+        {
+            std::make_heap(current.begin(), current.end());
+        }
+    }
+}
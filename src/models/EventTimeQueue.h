@@ -0,0 +1,89 @@
+#ifndef EVENT_TIME_QUEUE_H
+#define EVENT_TIME_QUEUE_H
+
+#include <string>
+#include <vector>
+
+enum EventTimeQueueType
+{
+    EVENT_TIME_QUEUE_HEAP,
+    EVENT_TIME_QUEUE_CALENDAR
+};
+
+// priority queue of (time, index) entries, with times in days
+// entries are popped in order of increasing time, with ties broken by increasing index
+// both implementations therefore give the same order for the same sequence of operations:
+// - heap: a binary heap
+// - calendar: a calendar queue of sub-day buckets; only the current bucket is kept ordered,
+//   which suits consumers that process events in day-sized windows
+class EventTimeQueue
+{
+    public:
+
+        EventTimeQueue(EventTimeQueueType type=EVENT_TIME_QUEUE_HEAP);
+
+        EventTimeQueueType getType() const;
+
+        void push(const double &time, const int &index);
+
+        bool empty() const;
+        int size() const;
+
+        // index and time of the next entry
+        int top() const;
+        double getTopTime() const;
+
+        void pop();
+
+        // type names for options: "heap" or "calendar"
+        static bool getTypeFromName(const std::string &name, EventTimeQueueType &type);
+        static std::string getTypeName(const EventTimeQueueType &type);
+
+    private:
+
+        struct Entry
+        {
+            double time;
+            int index;
+
+            // ordering for a min-heap on time; ties broken by index
+            bool operator<(const Entry &rhs) const
+            {
+                if(time != rhs.time)
+                {
+                    return time > rhs.time;
+                }
+
+                return index > rhs.index;
+            }
+        };
+
+        EventTimeQueueType type_;
+
+        int size_;
+
+        // heap
+        std::vector<Entry> heap_;
+
+        // calendar: a ring of buckets covering a window of days starting at the current bucket
+        // entries beyond the window are kept in an overflow heap until the window reaches them
+        static const int calendarBucketsPerDay_ = 64;
+        static const int calendarNumBuckets_ = 64 * 16;
+
+        std::vector<std::vector<Entry> > buckets_;
+
+        // absolute index of the current bucket; the current bucket is a heap, all others are unordered
+        int currentBucket_;
+
+        // number of entries in buckets_ (not including the overflow)
+        int numBucketEntries_;
+
+        std::vector<Entry> overflow_;
+
+        int getBucket(const double &time) const;
+
+        // move the current bucket forward to the next non-empty bucket
+        void advanceCalendar();
+};
+
+#endif
@@ -0,0 +1,121 @@
+#include "RandomStream.h"
+#include <new>
+
+// Philox4x32 round multipliers and key increments (Weyl sequence)
+static const boost::uint32_t philoxM0 = 0xD2511F53;
+static const boost::uint32_t philoxM1 = 0xCD9E8D57;
+static const boost::uint32_t philoxW0 = 0x9E3779B9;
+static const boost::uint32_t philoxW1 = 0xBB67AE85;
+
+static const int philoxNumRounds = 10;
+
+// gsl_rng type whose state is a RandomStream
+static void randomStreamGslSet(void * state, unsigned long int seed)
+{
+    new(state) RandomStream((boost::uint32_t)seed);
+}
+
+static unsigned long int randomStreamGslGet(void * state)
+{
+    return ((RandomStream *)state)->randInt();
+}
+
+static double randomStreamGslGetDouble(void * state)
+{
+    return ((RandomStream *)state)->randExc();
+}
+
+static const gsl_rng_type randomStreamGslRngType =
+{
+    "philox4x32-10",
+    0xffffffffUL,
+    0,
+    sizeof(RandomStream),
+    &randomStreamGslSet,
+    &randomStreamGslGet,
+    &randomStreamGslGetDouble
+};
+
+RandomStream::RandomStream(boost::uint32_t seed, boost::uint32_t realization, boost::uint32_t purpose, boost::uint32_t index)
+{
+    setKey(seed, realization, purpose, index);
+}
+
+void RandomStream::setKey(boost::uint32_t seed, boost::uint32_t realization, boost::uint32_t purpose, boost::uint32_t index)
+{
+    key_[0] = seed;
+    key_[1] = realization;
+
+    counter_[0] = 0;
+    counter_[1] = 0;
+    counter_[2] = purpose;
+    counter_[3] = index;
+
+    bufferPosition_ = 4;
+}
+
+gsl_rng * RandomStream::allocGslRng() const
+{
+    gsl_rng * rng = gsl_rng_alloc(&randomStreamGslRngType);
+
+    copyToGslRng(rng);
+
+    return rng;
+}
+
+void RandomStream::copyToGslRng(gsl_rng * rng) const
+{
+    *(RandomStream *)gsl_rng_state(rng) = *this;
+}
+
+gsl_rng RandomStream::getGslRng()
+{
+    gsl_rng rng;
+    rng.type = &randomStreamGslRngType;
+    rng.state = this;
+
+    return rng;
+}
+
+const gsl_rng_type * RandomStream::getGslRngType()
+{
+    return &randomStreamGslRngType;
+}
+
+void RandomStream::generate()
+{
+    boost::uint32_t c0 = counter_[0];
+    boost::uint32_t c1 = counter_[1];
+    boost::uint32_t c2 = counter_[2];
+    boost::uint32_t c3 = counter_[3];
+
+    boost::uint32_t k0 = key_[0];
+    boost::uint32_t k1 = key_[1];
+
+    for(int r=0; r<philoxNumRounds; r++)
+    {
+        boost::uint64_t product0 = (boost::uint64_t)philoxM0 * c0;
+        boost::uint64_t product1 = (boost::uint64_t)philoxM1 * c2;
+
+        c0 = (boost::uint32_t)(product1 >> 32) ^ c1 ^ k0;
+        c1 = (boost::uint32_t)product1;
+        c2 = (boost::uint32_t)(product0 >> 32) ^ c3 ^ k1;
+        c3 = (boost::uint32_t)product0;
+
+        k0 += philoxW0;
+        k1 += philoxW1;
+    }
+
+    buffer_[0] = c0;
+    buffer_[1] = c1;
+    buffer_[2] = c2;
+    buffer_[3] = c3;
+
+    bufferPosition_ = 0;
+
+    // the block number is the 64-bit position in the stream
+    if(++counter_[0] == 0)
+    {
+        counter_[1]++;
+    }
+}
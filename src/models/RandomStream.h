@@ -0,0 +1,117 @@
+#ifndef RANDOM_STREAM_H
+#define RANDOM_STREAM_H
+
+#include <cmath>
+#include <boost/cstdint.hpp>
+#include <gsl/gsl_rng.h>
+
+// a stream of random numbers from the counter-based Philox4x32-10 generator
+// (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", 2011)
+//
+// a stream is identified by a key: (seed, realization, purpose, index). each value is a function of the key
+// and its position in the stream only, so streams with different keys are independent, any number of them can
+// be created without seeding cost, and results don't depend on which thread draws from which stream.
+// the complete state is a few words, so streams are cheap to copy, fork and checkpoint.
+//
+// the interface follows MTRand for the distributions used by the models
+class RandomStream
+{
+    public:
+
+        RandomStream(boost::uint32_t seed=0, boost::uint32_t realization=0, boost::uint32_t purpose=0, boost::uint32_t index=0);
+
+        // restart the stream with another key
+        void setKey(boost::uint32_t seed, boost::uint32_t realization, boost::uint32_t purpose, boost::uint32_t index=0);
+
+        // integer in [0, 2^32-1]
+        boost::uint32_t randInt()
+        {
+            if(bufferPosition_ >= 4)
+            {
+                generate();
+            }
+
+            return buffer_[bufferPosition_++];
+        }
+
+        // integer in [0, n] for n < 2^32
+        boost::uint32_t randInt(boost::uint32_t n)
+        {
+            // find which bits are used in n
+            boost::uint32_t used = n;
+            used |= used >> 1;
+            used |= used >> 2;
+            used |= used >> 4;
+            used |= used >> 8;
+            used |= used >> 16;
+
+            // draw numbers until one is found in [0, n]
+            boost::uint32_t i;
+
+            do
+            {
+                i = randInt() & used;
+            }
+            while(i > n);
+
+            return i;
+        }
+
+        // real number in [0, 1]
+        double rand()
+        {
+            return (double)randInt() * (1. / 4294967295.);
+        }
+
+        // real number in [0, 1)
+        double randExc()
+        {
+            return (double)randInt() * (1. / 4294967296.);
+        }
+
+        // real number in (0, 1)
+        double randDblExc()
+        {
+            return ((double)randInt() + 0.5) * (1. / 4294967296.);
+        }
+
+        // normally distributed number, by the Box-Muller transformation
+        double randNorm(const double &mean=0., const double &stddev=1.)
+        {
+            double r = sqrt(-2. * log(1. - randDblExc())) * stddev;
+            double phi = 2. * 3.14159265358979323846264338328 * randExc();
+
+            return mean + r * cos(phi);
+        }
+
+        // a gsl_rng of type getGslRngType() drawing from a copy of this stream; free it with gsl_rng_free()
+        // for the gsl distributions. the stream is the complete state of the gsl_rng, so gsl_rng_clone() and
+        // gsl_rng_memcpy() copy it, and gsl_rng_set() restarts it with the seed as the only key
+        gsl_rng * allocGslRng() const;
+
+        // restart a gsl_rng of type getGslRngType() as a copy of this stream
+        void copyToGslRng(gsl_rng * rng) const;
+
+        static const gsl_rng_type * getGslRngType();
+
+        // a gsl_rng of type getGslRngType() drawing from this stream itself, not a copy
+        // it needs no freeing and is valid as long as the stream is
+        gsl_rng getGslRng();
+
+    private:
+
+        // key: (seed, realization)
+        boost::uint32_t key_[2];
+
+        // counter: (block low, block high, purpose, index)
+        boost::uint32_t counter_[4];
+
+        // values of the current block; bufferPosition_ is 4 when all are used
+        boost::uint32_t buffer_[4];
+        int bufferPosition_;
+
+        // fill the buffer with the next block of the stream
+        void generate();
+};
+
+#endif
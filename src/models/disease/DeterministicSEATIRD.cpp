@@ -0,0 +1,518 @@
+#include "DeterministicSEATIRD.h"
+#include "SEATIRDConstants.h"
+#include "../../Parameters.h"
+#include "../../Npi.h"
+#include "../../Checkpoint.h"
+#include "../../Instrumentation.h"
+#include "../../log.h"
+#include <algorithm>
+#include <cmath>
+
+// number of strata of a node: [age][risk][vaccinated]
+static const int numNodeStrata = numAgeGroups * numRiskGroups * numVaccinatedGroups;
+
+// number of strata of an age group
+static const int numAgeStrata = numRiskGroups * numVaccinatedGroups;
+
+// number of integration steps per time step
+static const int integrationStepsPerDay = 4;
+
+DeterministicSEATIRD::DeterministicSEATIRD()
+{
+    put_flog(LOG_DEBUG, "");
+}
+
+void DeterministicSEATIRD::simulate()
+{
+    // base class simulate(): copies variables to new time step (time_+1) and evolves stockpile network
+    EpidemicSimulation::simulate();
+
+    // apply treatments
+    applyTreatments();
+
+    // transitions during this time step use the Npis active at time_
+    npiEffectivenessTable_.update(g_parameters.getNpis(), g_parameters.getNpisVersion(), time_, nodeIdToIndex_, numNodes_, numAgeGroups);
+
+    {
+        InstrumentationTimer timer(instrumentation_.get(), "integrate");
+
+        integrate();
+    }
+
+    // travel between nodes
+    {
+        InstrumentationTimer timer(instrumentation_.get(), "travel");
+
+        travel();
+    }
+
+    if(instrumentation_ != NULL)
+    {
+        instrumentation_->endTimeStep(time_+1);
+    }
+
+    // increment current time
+    time_++;
+}
+
+bool DeterministicSEATIRD::writeCheckpoint(CheckpointWriter &out)
+{
+    if(SEATIRD::writeCheckpoint(out) != true)
+    {
+        return false;
+    }
+
+    // the model has no state besides that of SEATIRD
+    out.writeTag("DeterministicSEATIRD");
+
+    return out.good();
+}
+
+bool DeterministicSEATIRD::readCheckpoint(CheckpointReader &in)
+{
+    if(SEATIRD::readCheckpoint(in) != true || in.readTag("DeterministicSEATIRD") != true)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+float * DeterministicSEATIRD::getTimeData(const EpidemicVariableHandle &handle, int time)
+{
+    blitz::Array<float, 1+NUM_STRATIFICATION_DIMENSIONS> values = getVariable(handle).getTime(time);
+
+    // a time step is a slice of a contiguous chunk (see EpidemicVariable), which stays allocated after values goes out of scope
+    if(values.isStorageContiguous() != true || (int)values.size() != numNodes_ * numNodeStrata)
+    {
+        put_flog(LOG_ERROR, "values of %s are not contiguous", getVariableName(handle).c_str());
+        return NULL;
+    }
+
+    return values.data();
+}
+
+void DeterministicSEATIRD::applyAntiviralsToNode(int nodeIndex, const std::vector<std::vector<int> > &stratificationValuesSet, float totalAdherentTreatable, int stockpileAmountUsed)
+{
+    double antiviralEffectiveness = g_parameters.getAntiviralEffectiveness();
+    double antiviralAdherence = g_parameters.getAntiviralAdherence();
+
+    // apply antivirals pro-rata across all stratifications in priority group selections
+    for(unsigned int s=0; s<stratificationValuesSet.size(); s++)
+    {
+        int a = stratificationValuesSet[s][0];
+        int r = stratificationValuesSet[s][1];
+        int v = stratificationValuesSet[s][2];
+
+        float treatable = getVariable(treatableHandle_)(time_+1, nodeIndex, a, r, v) - getVariable(treatedIneffectiveDailyHandle_)(time_+1, nodeIndex, a, r, v);
+
+        if(treatable <= 0.)
+        {
+            continue;
+        }
+
+        // pro-rata by adherent treatable population
+        float numberTreated = antiviralAdherence * treatable / totalAdherentTreatable * (float)stockpileAmountUsed;
+
+        // considering effectiveness
+        float numberEffectivelyTreated = antiviralEffectiveness * numberTreated;
+
+        // transition those effectively treated from "treatable" to "recovered"
+        getVariable(treatableHandle_).add(time_+1, nodeIndex, a, r, v, -numberEffectivelyTreated);
+        getVariable(recoveredHandle_).add(time_+1, nodeIndex, a, r, v, numberEffectivelyTreated);
+
+        getVariable(treatedDailyHandle_).add(time_+1, nodeIndex, a, r, v, numberTreated);
+        getVariable(treatedIneffectiveDailyHandle_).add(time_+1, nodeIndex, a, r, v, numberTreated - numberEffectivelyTreated);
+        getVariable(treatedHandle_).add(time_+1, nodeIndex, a, r, v, numberTreated);
+    }
+}
+
+void DeterministicSEATIRD::applyVaccinesToNode(int nodeIndex, const std::vector<std::vector<int> > &stratificationValuesSet2, float totalAdherentUnvaccinated, int stockpileAmountUsed)
+{
+    double vaccineAdherence = g_parameters.getVaccineAdherence();
+
+    // vaccines apply to all compartments but deceased
+    EpidemicVariableHandle compartmentHandles[] = { susceptibleHandle_, exposedHandle_, asymptomaticHandle_, treatableHandle_, infectiousHandle_, recoveredHandle_ };
+    const int numCompartments = 6;
+
+    EpidemicVariable &population = getVariable(populationHandle_);
+
+    // apply vaccines pro-rata across (age group, risk group) and compartments
+    for(unsigned int s=0; s<stratificationValuesSet2.size(); s++)
+    {
+        int a = stratificationValuesSet2[s][0];
+        int r = stratificationValuesSet2[s][1];
+
+        float vaccinatedPopulation = population(time_+1, nodeIndex, a, r, 1);
+        float unvaccinatedPopulation = population(time_+1, nodeIndex, a, r, 0);
+
+        if(unvaccinatedPopulation <= 0.)
+        {
+            continue;
+        }
+
+        // adherent unvaccinated of the group, as a fraction of its unvaccinated; each compartment is vaccinated by this fraction
+        float adherentUnvaccinated = vaccineAdherence * (vaccinatedPopulation + unvaccinatedPopulation) - vaccinatedPopulation;
+
+        if(adherentUnvaccinated <= 0.)
+        {
+            continue;
+        }
+
+        float vaccinatedFraction = adherentUnvaccinated / totalAdherentUnvaccinated * (float)stockpileAmountUsed / unvaccinatedPopulation;
+
+        float numberVaccinated = 0.;
+
+        for(int c=0; c<numCompartments; c++)
+        {
+            EpidemicVariable &compartment = getVariable(compartmentHandles[c]);
+
+            float number = vaccinatedFraction * compartment(time_+1, nodeIndex, a, r, 0);
+
+            // move individuals from compartment unvaccinated to compartment vaccinated
+            compartment.add(time_+1, nodeIndex, a, r, 0, -number);
+            compartment.add(time_+1, nodeIndex, a, r, 1, number);
+
+            numberVaccinated += number;
+        }
+
+        // individuals are changing stratifications as well as state
+        population.add(time_+1, nodeIndex, a, r, 0, -numberVaccinated);
+        population.add(time_+1, nodeIndex, a, r, 1, numberVaccinated);
+
+        getVariable(vaccinatedDailyHandle_).add(time_+1, nodeIndex, a, r, 1, numberVaccinated);
+
+        // and of the number in the latency period, which includes today for a nonzero latency period
+        if(vaccineLatencyPeriod_ > 0)
+        {
+            getVariable(vaccinatedInLatencyPeriodHandle_).add(time_+1, nodeIndex, a, r, 1, numberVaccinated);
+        }
+    }
+}
+
+void DeterministicSEATIRD::integrate()
+{
+    int time = time_+1;
+
+    // all values are [node][age][risk][vaccinated], so the loops below run over contiguous arrays
+    float * S = getTimeData(susceptibleHandle_, time);
+    float * E = getTimeData(exposedHandle_, time);
+    float * A = getTimeData(asymptomaticHandle_, time);
+    float * T = getTimeData(treatableHandle_, time);
+    float * I = getTimeData(infectiousHandle_, time);
+    float * R = getTimeData(recoveredHandle_, time);
+    float * D = getTimeData(deceasedHandle_, time);
+
+    const float * population = getTimeData(populationHandle_, time);
+    const float * vaccinatedInLatencyPeriod = getTimeData(vaccinatedInLatencyPeriodHandle_, time);
+
+    if(S == NULL || E == NULL || A == NULL || T == NULL || I == NULL || R == NULL || D == NULL || population == NULL || vaccinatedInLatencyPeriod == NULL)
+    {
+        return;
+    }
+
+    // todo: beta should be age-specific considering PHA's
+    double beta = g_parameters.getR0() / g_parameters.getBetaScale();
+
+    // todo: should be age-specific
+    double vaccineEffectiveness = g_parameters.getVaccineEffectiveness();
+
+    double dt = 1. / (double)integrationStepsPerDay;
+
+    // rates of the transitions, as in StochasticSEATIRDSchedule
+    // the fixed treatable period is approximated by an exponential one with the same mean
+    double rateEtoA = 1. / g_parameters.getTau();
+    double rateAtoT = 1. / g_parameters.getKappa();
+    double rateTtoI = 1. / g_parameters.getChi();
+    double rateRecovery = 1. / g_parameters.getGamma();
+
+    // over a step, a fraction 1 - exp(-rate * dt) of a state leaves it, split between its exits by their rates
+    // unlike an Euler step, this never leaves a state negative
+    double leavingE = 1. - exp(-rateEtoA * dt);
+
+    // for each stratum of a node
+    std::vector<double> leavingA(numNodeStrata);
+    std::vector<double> leavingT(numNodeStrata);
+    std::vector<double> leavingI(numNodeStrata);
+    std::vector<double> fractionsAtoT(numNodeStrata);
+    std::vector<double> fractionsAtoR(numNodeStrata);
+    std::vector<double> fractionsTtoI(numNodeStrata);
+    std::vector<double> fractionsTtoR(numNodeStrata);
+    std::vector<double> fractionsItoR(numNodeStrata);
+
+    for(int k=0; k<numNodeStrata; k++)
+    {
+        // compute nu (rate) from nu (CFR)
+        double nu = -1./g_parameters.getGamma() * log(1. - g_parameters.getNu(k / numAgeStrata));
+
+        leavingA[k] = 1. - exp(-(rateAtoT + rateRecovery + nu) * dt);
+        leavingT[k] = 1. - exp(-(rateTtoI + rateRecovery + nu) * dt);
+        leavingI[k] = 1. - exp(-(rateRecovery + nu) * dt);
+
+        fractionsAtoT[k] = rateAtoT / (rateAtoT + rateRecovery + nu);
+        fractionsAtoR[k] = rateRecovery / (rateAtoT + rateRecovery + nu);
+        fractionsTtoI[k] = rateTtoI / (rateTtoI + rateRecovery + nu);
+        fractionsTtoR[k] = rateRecovery / (rateTtoI + rateRecovery + nu);
+        fractionsItoR[k] = rateRecovery / (rateRecovery + nu);
+    }
+
+    // exposure rates per susceptible for each infected of a node: [node][infected age group][susceptible age group]
+    // these are the rates of the contact events of StochasticSEATIRD, with the Npis active at time_
+    std::vector<double> contactRates(numNodes_ * numAgeGroups * numAgeGroups, 0.);
+
+    // relative susceptibility for each stratum of each node; less than one for effectively vaccinated
+    std::vector<double> susceptibilities(numNodes_ * numNodeStrata, 1.);
+
+    for(int n=0; n<numNodes_; n++)
+    {
+        double populationNode = 0.;
+
+        for(int k=0; k<numNodeStrata; k++)
+        {
+            populationNode += population[n * numNodeStrata + k];
+        }
+
+        // an unpopulated node has no contacts
+        if(populationNode <= 0.)
+        {
+            continue;
+        }
+
+        for(int b=0; b<numAgeGroups; b++)
+        {
+            for(int a=0; a<numAgeGroups; a++)
+            {
+                contactRates[(n * numAgeGroups + b) * numAgeGroups + a] = (1. - npiEffectivenessTable_.getNpiEffectiveness(n, b, a)) * beta * ageContactRates[b][a] * ageSusceptibilities[a] / populationNode;
+            }
+        }
+
+        // the vaccine protects those vaccinated, and not in the vaccine latency period, with probability vaccineEffectiveness
+        // vaccinated stratification == 1
+        for(int k=1; k<numNodeStrata; k+=numVaccinatedGroups)
+        {
+            int i = n * numNodeStrata + k;
+
+            if(population[i] > 0.)
+            {
+                susceptibilities[i] = 1. - vaccineEffectiveness * std::max(0., 1. - (double)vaccinatedInLatencyPeriod[i] / (double)population[i]);
+            }
+        }
+    }
+
+    // infected (asymptomatic, treatable, infectious) and force of infection for each node and age group
+    std::vector<double> infected(numNodes_ * numAgeGroups);
+    std::vector<double> forces(numNodes_ * numAgeGroups);
+
+    for(int step=0; step<integrationStepsPerDay; step++)
+    {
+        std::fill(infected.begin(), infected.end(), 0.);
+
+        for(int n=0; n<numNodes_; n++)
+        {
+            for(int k=0; k<numNodeStrata; k++)
+            {
+                int i = n * numNodeStrata + k;
+
+                infected[n * numAgeGroups + k / numAgeStrata] += A[i] + T[i] + I[i];
+            }
+        }
+
+        for(int n=0; n<numNodes_; n++)
+        {
+            for(int a=0; a<numAgeGroups; a++)
+            {
+                double force = 0.;
+
+                for(int b=0; b<numAgeGroups; b++)
+                {
+                    force += contactRates[(n * numAgeGroups + b) * numAgeGroups + a] * infected[n * numAgeGroups + b];
+                }
+
+                forces[n * numAgeGroups + a] = force;
+            }
+        }
+
+        // all flows of a step use the values at the start of the step
+        for(int n=0; n<numNodes_; n++)
+        {
+            const double * nodeForces = &forces[n * numAgeGroups];
+            const double * nodeSusceptibilities = &susceptibilities[n * numNodeStrata];
+
+            for(int k=0; k<numNodeStrata; k++)
+            {
+                int i = n * numNodeStrata + k;
+
+                double exposures = S[i] * (1. - exp(-nodeForces[k / numAgeStrata] * nodeSusceptibilities[k] * dt));
+                double progressions = E[i] * leavingE;
+                double fromA = A[i] * leavingA[k];
+                double fromT = T[i] * leavingT[k];
+                double fromI = I[i] * leavingI[k];
+
+                double AtoT = fromA * fractionsAtoT[k];
+                double AtoR = fromA * fractionsAtoR[k];
+                double TtoI = fromT * fractionsTtoI[k];
+                double TtoR = fromT * fractionsTtoR[k];
+                double ItoR = fromI * fractionsItoR[k];
+
+                S[i] -= exposures;
+                E[i] += exposures - progressions;
+                A[i] += progressions - fromA;
+                T[i] += AtoT - fromT;
+                I[i] += TtoI - fromI;
+                R[i] += AtoR + TtoR + ItoR;
+                D[i] += (fromA - AtoT - AtoR) + (fromT - TtoI - TtoR) + (fromI - ItoR);
+            }
+        }
+    }
+
+    getVariable(susceptibleHandle_).invalidateMarginals(time);
+    getVariable(exposedHandle_).invalidateMarginals(time);
+    getVariable(asymptomaticHandle_).invalidateMarginals(time);
+    getVariable(treatableHandle_).invalidateMarginals(time);
+    getVariable(infectiousHandle_).invalidateMarginals(time);
+    getVariable(recoveredHandle_).invalidateMarginals(time);
+    getVariable(deceasedHandle_).invalidateMarginals(time);
+}
+
+void DeterministicSEATIRD::travel()
+{
+    if(sparseTravel_ == NULL || sparseTravel_->getNumNodes() != numNodes_)
+    {
+        put_flog(LOG_ERROR, "no travel data");
+        return;
+    }
+
+    int time = time_+1;
+
+    float * S = getTimeData(susceptibleHandle_, time);
+    float * E = getTimeData(exposedHandle_, time);
+    const float * A = getTimeData(asymptomaticHandle_, time);
+    const float * T = getTimeData(treatableHandle_, time);
+    const float * I = getTimeData(infectiousHandle_, time);
+
+    const float * population = getTimeData(populationHandle_, time);
+    const float * vaccinatedInLatencyPeriod = getTimeData(vaccinatedInLatencyPeriodHandle_, time);
+
+    if(S == NULL || E == NULL || A == NULL || T == NULL || I == NULL || population == NULL || vaccinatedInLatencyPeriod == NULL)
+    {
+        return;
+    }
+
+    // todo: beta should be age-specific considering PHA's
+    double beta = g_parameters.getR0() / g_parameters.getBetaScale();
+
+    double vaccineEffectiveness = g_parameters.getVaccineEffectiveness();
+
+    // travel happens at the end of the time step
+    travelNpiEffectivenessTable_.update(g_parameters.getNpis(), g_parameters.getNpisVersion(), time, nodeIdToIndex_, numNodes_, numAgeGroups);
+
+    // the same exposure probabilities as StochasticSEATIRD::travel(); the expected exposures are applied
+
+    // asymptomatics of each (source) node
+    std::vector<double> asymptomatics(numNodes_ * numAgeGroups, 0.);
+
+    // infectious contacts per unit of travel from each source node into each age group of a sink node
+    std::vector<double> sourceContacts(numNodes_ * numAgeGroups, 0.);
+
+    // contact rates for each age group of each sink node with asymptomatic travelers of each age group
+    std::vector<double> sinkContactRates(numNodes_ * numAgeGroups * numAgeGroups, 0.);
+
+    for(int n=0; n<numNodes_; n++)
+    {
+        double transmittings[numAgeGroups];
+
+        double populationNode = 0.;
+
+        for(int b=0; b<numAgeGroups; b++)
+        {
+            transmittings[b] = 0.;
+        }
+
+        for(int k=0; k<numNodeStrata; k++)
+        {
+            int i = n * numNodeStrata + k;
+
+            asymptomatics[n * numAgeGroups + k / numAgeStrata] += A[i];
+            transmittings[k / numAgeStrata] += A[i] + T[i] + I[i];
+
+            populationNode += population[i];
+        }
+
+        // an unpopulated node has no contacts
+        if(populationNode <= 0.)
+        {
+            continue;
+        }
+
+        for(int a=0; a<numAgeGroups; a++)
+        {
+            double contacts = 0.;
+
+            for(int b=0; b<numAgeGroups; b++)
+            {
+                double rate = (1. - travelNpiEffectivenessTable_.getNpiEffectiveness(n, a, b)) * beta * travelContactFraction * ageContactRates[a][b] * ageSusceptibilities[a];
+
+                contacts += rate * transmittings[b];
+
+                sinkContactRates[(n * numAgeGroups + a) * numAgeGroups + b] = rate / ageTravelFlowReductions[b] / populationNode;
+            }
+
+            sourceContacts[n * numAgeGroups + a] = contacts / ageTravelFlowReductions[a] / populationNode;
+        }
+    }
+
+    for(int sinkNodeIndex=0; sinkNodeIndex<numNodes_; sinkNodeIndex++)
+    {
+        double unvaccinatedProbabilities[numAgeGroups];
+        double travelingAsymptomatics[numAgeGroups];
+
+        for(int a=0; a<numAgeGroups; a++)
+        {
+            unvaccinatedProbabilities[a] = 0.;
+            travelingAsymptomatics[a] = 0.;
+        }
+
+        for(int entry=sparseTravel_->getRowStart(sinkNodeIndex); entry<sparseTravel_->getRowStart(sinkNodeIndex+1); entry++)
+        {
+            int sourceNodeIndex = sparseTravel_->getColumn(entry);
+
+            double travelFractionIJ = sparseTravel_->getTravelIJ(entry);
+            double travelFractionJI = sparseTravel_->getTravelJI(entry);
+
+            for(int a=0; a<numAgeGroups; a++)
+            {
+                unvaccinatedProbabilities[a] += travelFractionIJ * sourceContacts[sourceNodeIndex * numAgeGroups + a];
+                travelingAsymptomatics[a] += travelFractionJI * asymptomatics[sourceNodeIndex * numAgeGroups + a];
+            }
+        }
+
+        for(int a=0; a<numAgeGroups; a++)
+        {
+            for(int b=0; b<numAgeGroups; b++)
+            {
+                unvaccinatedProbabilities[a] += sinkContactRates[(sinkNodeIndex * numAgeGroups + a) * numAgeGroups + b] * travelingAsymptomatics[b];
+            }
+        }
+
+        for(int k=0; k<numNodeStrata; k++)
+        {
+            int i = sinkNodeIndex * numNodeStrata + k;
+
+            double probability = unvaccinatedProbabilities[k / numAgeStrata];
+
+            // vaccinated stratification == 1
+            if(k % numVaccinatedGroups == 1 && population[i] > 0.)
+            {
+                probability *= 1. - vaccineEffectiveness * std::max(0., 1. - (double)vaccinatedInLatencyPeriod[i] / (double)population[i]);
+            }
+
+            double exposures = std::min(1., probability) * S[i];
+
+            S[i] -= exposures;
+            E[i] += exposures;
+        }
+    }
+
+    getVariable(susceptibleHandle_).invalidateMarginals(time);
+    getVariable(exposedHandle_).invalidateMarginals(time);
+}
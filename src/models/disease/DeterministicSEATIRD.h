@@ -0,0 +1,39 @@
+#ifndef DETERMINISTIC_SEATIRD_H
+#define DETERMINISTIC_SEATIRD_H
+
+#include "SEATIRD.h"
+#include <vector>
+
+// mean-field version of StochasticSEATIRD: the expected values of its compartments, integrated as ODEs
+// this uses the same parameters, contacts, travel, Npis and treatments, with fractional people
+// for fast screening of parameters; one run gives what many stochastic realizations average to, apart from
+// extinction of small outbreaks, which the mean field doesn't have
+class DeterministicSEATIRD : public SEATIRD
+{
+    public:
+
+        DeterministicSEATIRD();
+
+        void simulate();
+
+    private:
+
+        bool writeCheckpoint(CheckpointWriter &out);
+        bool readCheckpoint(CheckpointReader &in);
+
+        // values of a variable at a time step: [node][age][risk][vaccinated], contiguous
+        // writes through this are not tracked by the marginals
+        float * getTimeData(const EpidemicVariableHandle &handle, int time);
+
+        // treatments, with fractional numbers of people
+        void applyAntiviralsToNode(int nodeIndex, const std::vector<std::vector<int> > &stratificationValuesSet, float totalAdherentTreatable, int stockpileAmountUsed);
+        void applyVaccinesToNode(int nodeIndex, const std::vector<std::vector<int> > &stratificationValuesSet2, float totalAdherentUnvaccinated, int stockpileAmountUsed);
+
+        // integrate the transitions within nodes over the current time step
+        void integrate();
+
+        // expected exposures by travel between nodes, at the end of the time step
+        void travel();
+};
+
+#endif
@@ -0,0 +1,457 @@
+#include "SEATIRD.h"
+#include "SEATIRDConstants.h"
+#include "../../Parameters.h"
+#include "../../Stockpile.h"
+#include "../../StockpileNetwork.h"
+#include "../../PriorityGroup.h"
+#include "../../PriorityGroupSelections.h"
+#include "../../Checkpoint.h"
+#include "../../Instrumentation.h"
+#include "../../log.h"
+#include <boost/bind.hpp>
+
+SEATIRD::SEATIRD()
+{
+    // defaults
+    vaccineLatencyPeriod_ = -1;
+
+    // create other required variables for these models
+    newVariable("asymptomatic");
+    newVariable("treatable");
+    newVariable("infectious");
+    newVariable("recovered");
+    newVariable("deceased");
+
+    // the "treated" variable keeps tracks of those treated with antivirals
+    newVariable("treated");
+
+    // need to keep track of number treated each day
+    newVariable("treated (daily)");
+
+    // need to keep track of number ineffectively treated each day
+    newVariable("treated (ineffective daily)");
+
+    // need to keep track of number vaccinated each day
+    newVariable("vaccinated (daily)");
+
+    // rolling sum of "vaccinated (daily)" over the vaccine latency period
+    newVariable("vaccinated in lag period");
+
+    // resolve variable handles
+    populationHandle_ = getVariableHandle("population");
+    asymptomaticHandle_ = getVariableHandle("asymptomatic");
+    treatableHandle_ = getVariableHandle("treatable");
+    infectiousHandle_ = getVariableHandle("infectious");
+    recoveredHandle_ = getVariableHandle("recovered");
+    deceasedHandle_ = getVariableHandle("deceased");
+    treatedHandle_ = getVariableHandle("treated");
+    treatedDailyHandle_ = getVariableHandle("treated (daily)");
+    treatedIneffectiveDailyHandle_ = getVariableHandle("treated (ineffective daily)");
+    vaccinatedDailyHandle_ = getVariableHandle("vaccinated (daily)");
+    vaccinatedInLatencyPeriodHandle_ = getVariableHandle("vaccinated in lag period");
+
+    // derived variables
+    derivedVariables_["All infected"] = boost::bind(&SEATIRD::getDerivedVarInfected, this, _1, _2, _3);
+    derivedVariables_["vaccinated effective"] = boost::bind(&SEATIRD::getDerivedVarPopulationEffectiveVaccines, this, _1, _2, _3);
+
+    // make sure we have expected stratifications
+    if((int)stratifications_[0].size() != numAgeGroups || (int)stratifications_[1].size() != numRiskGroups || (int)stratifications_[2].size() != numVaccinatedGroups)
+    {
+        put_flog(LOG_ERROR, "wrong number of stratifications");
+        isValid_ = false;
+    }
+
+    // initialize start time to 0
+    time_ = 0;
+}
+
+SEATIRD::SEATIRD(SEATIRD &simulation) : EpidemicSimulation(simulation)
+{
+    // variable handles
+    populationHandle_ = simulation.populationHandle_;
+    asymptomaticHandle_ = simulation.asymptomaticHandle_;
+    treatableHandle_ = simulation.treatableHandle_;
+    infectiousHandle_ = simulation.infectiousHandle_;
+    recoveredHandle_ = simulation.recoveredHandle_;
+    deceasedHandle_ = simulation.deceasedHandle_;
+    treatedHandle_ = simulation.treatedHandle_;
+    treatedDailyHandle_ = simulation.treatedDailyHandle_;
+    treatedIneffectiveDailyHandle_ = simulation.treatedIneffectiveDailyHandle_;
+    vaccinatedDailyHandle_ = simulation.vaccinatedDailyHandle_;
+    vaccinatedInLatencyPeriodHandle_ = simulation.vaccinatedInLatencyPeriodHandle_;
+
+    // derived variables are bound to this simulation
+    derivedVariables_["All infected"] = boost::bind(&SEATIRD::getDerivedVarInfected, this, _1, _2, _3);
+    derivedVariables_["vaccinated effective"] = boost::bind(&SEATIRD::getDerivedVarPopulationEffectiveVaccines, this, _1, _2, _3);
+
+    vaccineLatencyPeriod_ = simulation.vaccineLatencyPeriod_;
+    time_ = simulation.time_;
+
+    // the Npi effectiveness tables are rebuilt on the next time step
+}
+
+float SEATIRD::getDerivedVarInfected(int time, int nodeId, std::vector<int> stratificationValues)
+{
+    float infected = 0.;
+    infected += getValue("asymptomatic", time, nodeId, stratificationValues);
+    infected += getValue("treatable", time, nodeId, stratificationValues);
+    infected += getValue("infectious", time, nodeId, stratificationValues);
+
+    return infected;
+}
+
+float SEATIRD::getDerivedVarPopulationEffectiveVaccines(int time, int nodeId, std::vector<int> stratificationValues)
+{
+    // vaccinated stratification == 1
+    // return 0 if unvaccinated stratification was explicitly specified
+    if(stratificationValues.size() >= 3 && (stratificationValues[2] != 1 && stratificationValues[2] != STRATIFICATIONS_ALL))
+    {
+        return 0.;
+    }
+
+    // make sure stratifications size is full and choose vaccinated stratification
+    for(unsigned int i=stratificationValues.size(); i<3; i++)
+    {
+        stratificationValues.push_back(STRATIFICATIONS_ALL);
+    }
+
+    stratificationValues[2] = 1;
+
+    return getValue("population", time, nodeId, stratificationValues) - getValue("vaccinated in lag period", time, nodeId, stratificationValues);
+}
+
+bool SEATIRD::writeCheckpoint(CheckpointWriter &out)
+{
+    if(EpidemicSimulation::writeCheckpoint(out) != true)
+    {
+        return false;
+    }
+
+    out.writeTag("SEATIRD");
+
+    out.write((boost::int32_t)time_);
+    out.write((boost::int32_t)vaccineLatencyPeriod_);
+
+    return out.good();
+}
+
+bool SEATIRD::readCheckpoint(CheckpointReader &in)
+{
+    if(EpidemicSimulation::readCheckpoint(in) != true || in.readTag("SEATIRD") != true)
+    {
+        return false;
+    }
+
+    boost::int32_t time;
+    boost::int32_t vaccineLatencyPeriod;
+
+    if(in.read(time) != true || in.read(vaccineLatencyPeriod) != true)
+    {
+        return false;
+    }
+
+    if(time != numTimes_-1)
+    {
+        put_flog(LOG_ERROR, "checkpoint time %i does not match %i time steps", time, numTimes_);
+        return false;
+    }
+
+    time_ = time;
+    vaccineLatencyPeriod_ = vaccineLatencyPeriod;
+
+    // rebuilt on the next time step
+    npiEffectivenessTable_ = NpiEffectivenessTable();
+    travelNpiEffectivenessTable_ = NpiEffectivenessTable();
+
+    return true;
+}
+
+void SEATIRD::applyTreatments()
+{
+    // create a priority group selection for all of the population, for pure pro-rata treatments
+    std::vector<int> stratificationValues(1, STRATIFICATIONS_ALL);
+    std::vector<std::vector<int> > stratificationVectorValues(3, stratificationValues);
+    boost::shared_ptr<PriorityGroup> priorityGroupAll = boost::shared_ptr<PriorityGroup>(new PriorityGroup("_ALL_", stratificationVectorValues));
+    boost::shared_ptr<PriorityGroupSelections> priorityGroupSelectionsAll(new PriorityGroupSelections(std::vector<boost::shared_ptr<PriorityGroup> >(1, priorityGroupAll)));
+
+    // reset number treated for today
+    // do this here since we may have multiple treatments in one day
+    getVariable(treatedDailyHandle_).getTime(time_+1) = 0.;
+    getVariable(treatedIneffectiveDailyHandle_).getTime(time_+1) = 0.;
+    getVariable(vaccinatedDailyHandle_).getTime(time_+1) = 0.;
+
+    getVariable(treatedDailyHandle_).invalidateMarginals(time_+1);
+    getVariable(treatedIneffectiveDailyHandle_).invalidateMarginals(time_+1);
+    getVariable(vaccinatedDailyHandle_).invalidateMarginals(time_+1);
+
+    updatePopulationInVaccineLatencyPeriod();
+
+    // apply treatments to priority group selections; then remaining to the entire population
+    {
+        InstrumentationTimer timer(instrumentation_.get(), "antivirals");
+
+        applyAntiviralsToPriorityGroupSelections(g_parameters.getAntiviralPriorityGroupSelections());
+        applyAntiviralsToPriorityGroupSelections(priorityGroupSelectionsAll);
+    }
+
+    {
+        InstrumentationTimer timer(instrumentation_.get(), "vaccines");
+
+        applyVaccinesToPriorityGroupSelections(g_parameters.getVaccinePriorityGroupSelections());
+        applyVaccinesToPriorityGroupSelections(priorityGroupSelectionsAll);
+    }
+}
+
+float SEATIRD::getNodeValue(const EpidemicVariableHandle &handle, const int &nodeIndex, const std::vector<int> &stratificationValues)
+{
+    EpidemicVariable &variable = getVariable(handle);
+
+    int s0 = stratificationValues.size() > 0 ? stratificationValues[0] : STRATIFICATIONS_ALL;
+    int s1 = stratificationValues.size() > 1 ? stratificationValues[1] : STRATIFICATIONS_ALL;
+    int s2 = stratificationValues.size() > 2 ? stratificationValues[2] : STRATIFICATIONS_ALL;
+
+    // the marginals are summed over the vaccinated stratification
+    if(s2 == STRATIFICATIONS_ALL)
+    {
+        return variable.getMarginal(time_+1, nodeIndex, s0, s1);
+    }
+
+    float value = 0.;
+
+    int a0 = (s0 == STRATIFICATIONS_ALL) ? 0 : s0;
+    int a1 = (s0 == STRATIFICATIONS_ALL) ? numAgeGroups : s0 + 1;
+    int r0 = (s1 == STRATIFICATIONS_ALL) ? 0 : s1;
+    int r1 = (s1 == STRATIFICATIONS_ALL) ? numRiskGroups : s1 + 1;
+
+    for(int a=a0; a<a1; a++)
+    {
+        for(int r=r0; r<r1; r++)
+        {
+            value += variable(time_+1, nodeIndex, a, r, s2);
+        }
+    }
+
+    return value;
+}
+
+float SEATIRD::getNodeValue(const EpidemicVariableHandle &handle, const int &nodeIndex, const std::vector<std::vector<int> > &stratificationValuesSet)
+{
+    float value = 0.;
+
+    for(unsigned int i=0; i<stratificationValuesSet.size(); i++)
+    {
+        value += getNodeValue(handle, nodeIndex, stratificationValuesSet[i]);
+    }
+
+    return value;
+}
+
+void SEATIRD::applyAntiviralsToPriorityGroupSelections(boost::shared_ptr<PriorityGroupSelections> priorityGroupSelections)
+{
+    if(priorityGroupSelections == NULL || priorityGroupSelections->getPriorityGroups().size() == 0)
+    {
+        put_flog(LOG_DEBUG, "no priority groups in selection");
+        return;
+    }
+
+    double antiviralAdherence = g_parameters.getAntiviralAdherence();
+    double antiviralCapacity = g_parameters.getAntiviralCapacity();
+
+    // the total populations below correspond to the priority group selections
+    std::vector<std::vector<int> > stratificationValuesSet = priorityGroupSelections->getStratificationValuesSet();
+
+    // treatments for each node
+    std::vector<int> nodeIds = getNodeIds();
+
+    for(unsigned int i=0; i<nodeIds.size(); i++)
+    {
+        int nodeIndex = nodeIdToIndex_[nodeIds[i]];
+
+        boost::shared_ptr<Stockpile> stockpile = getStockpileNetwork()->getNodeStockpile(nodeIds[i]);
+
+        // do nothing if no stockpile is found
+        if(stockpile == NULL)
+        {
+            continue;
+        }
+
+        // available antivirals stockpile
+        int stockpileAmount = stockpile->getNum(time_+1, STOCKPILE_ANTIVIRALS);
+
+        // do nothing if we have no available stockpile
+        if(stockpileAmount == 0)
+        {
+            continue;
+        }
+
+        // determine total number of adherent treatable
+        float totalTreatable = getNodeValue(treatableHandle_, nodeIndex, stratificationValuesSet) - getNodeValue(treatedIneffectiveDailyHandle_, nodeIndex, stratificationValuesSet);
+
+        // do nothing if this population is zero
+        if(totalTreatable <= 0.)
+        {
+            continue;
+        }
+
+        // since we fix the treatable period to one day, we can simplify our adherence calculations...
+        float totalAdherentTreatable = antiviralAdherence * totalTreatable;
+
+        // we will use all of our available stockpile (subject to capacity constraint) to treat the adherent treatable population
+        int stockpileAmountUsed = stockpileAmount;
+
+        if(stockpileAmountUsed > (int)totalAdherentTreatable)
+        {
+            stockpileAmountUsed = (int)totalAdherentTreatable;
+        }
+
+        // capacity corresponds to total population, not just for these priority group selections
+        float capacityTotalPopulation = getNodeValue(populationHandle_, nodeIndex);
+
+        // consider capacity used in previous treatments on this day
+        float todayUsedCapacity = getVariable(treatedDailyHandle_).getMarginal(time_+1, nodeIndex, STRATIFICATIONS_ALL, STRATIFICATIONS_ALL);
+
+        if(stockpileAmountUsed > (int)(antiviralCapacity * capacityTotalPopulation - todayUsedCapacity))
+        {
+            stockpileAmountUsed = (int)(antiviralCapacity * capacityTotalPopulation - todayUsedCapacity);
+        }
+
+        // do nothing if no stockpile is used
+        if(stockpileAmountUsed <= 0)
+        {
+            continue;
+        }
+
+        // decrement antivirals stockpile
+        stockpile->setNum(time_+1, stockpileAmount - stockpileAmountUsed, STOCKPILE_ANTIVIRALS);
+
+        applyAntiviralsToNode(nodeIndex, stratificationValuesSet, totalAdherentTreatable, stockpileAmountUsed);
+    }
+}
+
+void SEATIRD::applyVaccinesToPriorityGroupSelections(boost::shared_ptr<PriorityGroupSelections> priorityGroupSelections)
+{
+    // TODO: need to consider deceased in adherent individual totals! they reduce the adherent unvaccinated population
+
+    if(priorityGroupSelections == NULL || priorityGroupSelections->getPriorityGroups().size() == 0)
+    {
+        put_flog(LOG_DEBUG, "no priority groups in selection");
+        return;
+    }
+
+    double vaccineAdherence = g_parameters.getVaccineAdherence();
+    double vaccineCapacity = g_parameters.getVaccineCapacity();
+
+    // the total populations below correspond to the priority group selections (only for age group, risk group)
+    std::vector<std::vector<int> > stratificationValuesSet2 = priorityGroupSelections->getStratificationValuesSet2(STRATIFICATIONS_ALL);
+    std::vector<std::vector<int> > vaccinatedStratificationValuesSet2 = priorityGroupSelections->getStratificationValuesSet2(1); // vaccinated == 1
+    std::vector<std::vector<int> > unvaccinatedStratificationValuesSet2 = priorityGroupSelections->getStratificationValuesSet2(0); // unvaccinated == 0
+
+    // treatments for each node
+    std::vector<int> nodeIds = getNodeIds();
+
+    for(unsigned int i=0; i<nodeIds.size(); i++)
+    {
+        int nodeIndex = nodeIdToIndex_[nodeIds[i]];
+
+        boost::shared_ptr<Stockpile> stockpile = getStockpileNetwork()->getNodeStockpile(nodeIds[i]);
+
+        // do nothing if no stockpile is found
+        if(stockpile == NULL)
+        {
+            continue;
+        }
+
+        // available vaccines stockpile
+        int stockpileAmount = stockpile->getNum(time_+1, STOCKPILE_VACCINES);
+
+        // do nothing if we have no available stockpile
+        if(stockpileAmount == 0)
+        {
+            continue;
+        }
+
+        // determine total number of adherent unvaccinated
+        float totalPopulation = getNodeValue(populationHandle_, nodeIndex, stratificationValuesSet2);
+        float totalVaccinatedPopulation = getNodeValue(populationHandle_, nodeIndex, vaccinatedStratificationValuesSet2);
+        float totalUnvaccinatedPopulation = getNodeValue(populationHandle_, nodeIndex, unvaccinatedStratificationValuesSet2);
+
+        // do nothing if this population is zero
+        if(totalUnvaccinatedPopulation <= 0.)
+        {
+            continue;
+        }
+
+        float totalAdherentUnvaccinated = (vaccineAdherence * totalPopulation - totalVaccinatedPopulation);
+
+        // we will use all of our available stockpile (subject to capacity constraint) to treat the adherent unvaccinated population
+        // note that we're treating all compartments, not just susceptible
+        int stockpileAmountUsed = stockpileAmount;
+
+        if(stockpileAmountUsed > (int)totalAdherentUnvaccinated)
+        {
+            stockpileAmountUsed = (int)totalAdherentUnvaccinated;
+        }
+
+        // capacity corresponds to total population, not just for these priority group selections
+        float capacityTotalPopulation = getNodeValue(populationHandle_, nodeIndex);
+
+        // consider capacity used in previous treatments on this day
+        // vaccinated stratification == 1
+        std::vector<int> vaccinatedStratificationValues(3, STRATIFICATIONS_ALL);
+        vaccinatedStratificationValues[2] = 1;
+
+        float todayUsedCapacity = getNodeValue(vaccinatedDailyHandle_, nodeIndex, vaccinatedStratificationValues);
+
+        if(stockpileAmountUsed > (int)(vaccineCapacity * capacityTotalPopulation - todayUsedCapacity))
+        {
+            stockpileAmountUsed = (int)(vaccineCapacity * capacityTotalPopulation - todayUsedCapacity);
+        }
+
+        // do nothing if no stockpile is used
+        if(stockpileAmountUsed <= 0)
+        {
+            continue;
+        }
+
+        // decrement vaccines stockpile
+        stockpile->setNum(time_+1, stockpileAmount - stockpileAmountUsed, STOCKPILE_VACCINES);
+
+        applyVaccinesToNode(nodeIndex, stratificationValuesSet2, totalAdherentUnvaccinated, stockpileAmountUsed);
+    }
+}
+
+void SEATIRD::updatePopulationInVaccineLatencyPeriod()
+{
+    int vaccineLatencyPeriod = g_parameters.getVaccineLatencyPeriod();
+
+    EpidemicVariable &vaccinatedDaily = getVariable(vaccinatedDailyHandle_);
+    EpidemicVariable &vaccinatedInLatencyPeriod = getVariable(vaccinatedInLatencyPeriodHandle_);
+
+    int time = time_+1;
+
+    if(vaccineLatencyPeriod == vaccineLatencyPeriod_)
+    {
+        // the new time step starts as a copy of the previous one: remove the day leaving the window
+        int leavingTime = time - vaccineLatencyPeriod;
+
+        if(vaccineLatencyPeriod > 0 && leavingTime >= 0)
+        {
+            vaccinatedInLatencyPeriod.getTime(time) -= vaccinatedDaily.getTime(leavingTime);
+        }
+    }
+    else
+    {
+        // first time step or the latency period changed: sum over the window
+        // with these inequalities, a 0 day latency period will always give 0, as expected
+        vaccinatedInLatencyPeriod.getTime(time) = 0.;
+
+        for(int t=time; t>=0 && t>(time - vaccineLatencyPeriod); t--)
+        {
+            vaccinatedInLatencyPeriod.getTime(time) += vaccinatedDaily.getTime(t);
+        }
+
+        vaccineLatencyPeriod_ = vaccineLatencyPeriod;
+    }
+
+    vaccinatedInLatencyPeriod.invalidateMarginals(time);
+}
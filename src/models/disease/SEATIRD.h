@@ -0,0 +1,87 @@
+#ifndef SEATIRD_H
+#define SEATIRD_H
+
+#include "../../EpidemicSimulation.h"
+#include "../../NpiEffectivenessTable.h"
+#include <vector>
+
+class PriorityGroupSelections;
+
+// state and treatments shared by the SEATIRD models, StochasticSEATIRD and DeterministicSEATIRD
+// people are susceptible, exposed, asymptomatic, treatable, infectious, recovered or deceased, stratified by age group,
+// risk group and vaccinated (see SEATIRDConstants.h)
+// antivirals and vaccines are taken from the stockpile of each node here; the models apply them to the people of the node
+class SEATIRD : public EpidemicSimulation
+{
+    public:
+
+        // derived variables
+        float getDerivedVarInfected(int time, int nodeId, std::vector<int> stratificationValues=std::vector<int>());
+        float getDerivedVarPopulationEffectiveVaccines(int time, int nodeId, std::vector<int> stratificationValues=std::vector<int>());
+
+    protected:
+
+        SEATIRD();
+
+        // a fork of a simulation; see StochasticSEATIRD::fork()
+        SEATIRD(SEATIRD &simulation);
+
+        // variable handles
+        EpidemicVariableHandle populationHandle_;
+        EpidemicVariableHandle asymptomaticHandle_;
+        EpidemicVariableHandle treatableHandle_;
+        EpidemicVariableHandle infectiousHandle_;
+        EpidemicVariableHandle recoveredHandle_;
+        EpidemicVariableHandle deceasedHandle_;
+        EpidemicVariableHandle treatedHandle_;
+        EpidemicVariableHandle treatedDailyHandle_;
+        EpidemicVariableHandle treatedIneffectiveDailyHandle_;
+        EpidemicVariableHandle vaccinatedDailyHandle_;
+        EpidemicVariableHandle vaccinatedInLatencyPeriodHandle_;
+
+        // vaccine latency period of the "vaccinated in lag period" rolling sum; -1 before the first time step
+        int vaccineLatencyPeriod_;
+
+        // current time step
+        int time_;
+
+        // Npi effectiveness for the transitions of the current time step (time_)
+        NpiEffectivenessTable npiEffectivenessTable_;
+
+        // Npi effectiveness for travel() at the end of the current time step (time_+1)
+        // this is a separate table, so each table is only rebuilt once per time step
+        NpiEffectivenessTable travelNpiEffectivenessTable_;
+
+        // the base class state, current time step and vaccine latency period
+        bool writeCheckpoint(CheckpointWriter &out);
+        bool readCheckpoint(CheckpointReader &in);
+
+        // reset the daily treatment counts of the new time step (time_+1), then apply antivirals and vaccines to the
+        // priority group selections, and what remains to the entire population
+        void applyTreatments();
+
+        // apply <stockpileAmountUsed> antivirals, already taken from the stockpile of a node, to the adherent treatable of the
+        // stratifications (age group, risk group, vaccinated) in the node, pro-rata; totalAdherentTreatable is their sum
+        virtual void applyAntiviralsToNode(int nodeIndex, const std::vector<std::vector<int> > &stratificationValuesSet, float totalAdherentTreatable, int stockpileAmountUsed) = 0;
+
+        // apply <stockpileAmountUsed> vaccines, already taken from the stockpile of a node, to the adherent unvaccinated of the
+        // stratifications (age group, risk group) in the node, pro-rata; totalAdherentUnvaccinated is their sum
+        virtual void applyVaccinesToNode(int nodeIndex, const std::vector<std::vector<int> > &stratificationValuesSet2, float totalAdherentUnvaccinated, int stockpileAmountUsed) = 0;
+
+        // value of a variable in a node at the new time step (time_+1), by handle
+        // stratification values may be STRATIFICATIONS_ALL, or be omitted for all; a set of stratification values is summed
+        float getNodeValue(const EpidemicVariableHandle &handle, const int &nodeIndex, const std::vector<int> &stratificationValues=std::vector<int>());
+        float getNodeValue(const EpidemicVariableHandle &handle, const int &nodeIndex, const std::vector<std::vector<int> > &stratificationValuesSet);
+
+    private:
+
+        // take antivirals and vaccines from the stockpile of each node, subject to adherence and capacity, and apply them
+        void applyAntiviralsToPriorityGroupSelections(boost::shared_ptr<PriorityGroupSelections> priorityGroupSelections);
+        void applyVaccinesToPriorityGroupSelections(boost::shared_ptr<PriorityGroupSelections> priorityGroupSelections);
+
+        // move the "vaccinated in lag period" window to the new time step (time_+1)
+        // vaccinations on the new time step are added as they happen
+        void updatePopulationInVaccineLatencyPeriod();
+};
+
+#endif
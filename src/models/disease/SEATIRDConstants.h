@@ -0,0 +1,28 @@
+#ifndef SEATIRD_CONSTANTS_H
+#define SEATIRD_CONSTANTS_H
+
+// stratifications and contact structure shared by the SEATIRD models
+// todo: the contact structure should be in parameters
+
+// number of values of each stratification: age groups, risk groups, vaccinated groups
+static const int numAgeGroups = 5;
+static const int numRiskGroups = 4;
+static const int numVaccinatedGroups = 2;
+
+// susceptibility of each age group
+static const double ageSusceptibilities[numAgeGroups] = { 1.00, 0.98, 0.94, 0.91, 0.66 };
+
+// daily contacts between age groups
+static const double ageContactRates[numAgeGroups][numAgeGroups] = {   { 45.1228487783,8.7808312353,11.7757947836,6.10114751268,4.02227175596 },
+                                                                      { 8.7808312353,41.2889143668,13.3332813497,7.847051289,4.22656343551 },
+                                                                      { 11.7757947836,13.3332813497,21.4270155984,13.7392636644,6.92483172729 },
+                                                                      { 6.10114751268,7.847051289,13.7392636644,18.0482119252,9.45371062356 },
+                                                                      { 4.02227175596,4.22656343551,6.92483172729,9.45371062356,14.0529294262 }   };
+
+// contacts of travelers, relative to contacts at home
+static const double travelContactFraction = 0.39;
+
+// reduction of travel for each age group: 0-4 year olds: 10, 5-24 year olds: 2, 65+ year olds: 2
+static const double ageTravelFlowReductions[numAgeGroups] = { 10., 2., 1., 1., 2. };
+
+#endif
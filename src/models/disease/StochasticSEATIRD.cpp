@@ -1,52 +1,99 @@
 #include "StochasticSEATIRD.h"
+#include "SEATIRDConstants.h"
 #include "../../Parameters.h"
 #include "../random.h"
-#include "../../Stockpile.h"
-#include "../../StockpileNetwork.h"
-#include "../../PriorityGroup.h"
-#include "../../PriorityGroupSelections.h"
+#include "../MersenneTwister.h"
 #include "../../Npi.h"
+#include "../../parallel.h"
+#include "../../Checkpoint.h"
+#include "../../Instrumentation.h"
 #include "../../log.h"
 #include <boost/bind.hpp>
+#include <algorithm>
+#include <stdlib.h>
 
-const int StochasticSEATIRD::numAgeGroups_ = 5;
-const int StochasticSEATIRD::numRiskGroups_ = 4;
-const int StochasticSEATIRD::numVaccinatedGroups_ = 2;
+// purposes of the random number streams (see RandomStream); these must not change, so realizations stay reproducible
+enum StochasticSEATIRDRandomStream
+{
+    RANDOM_STREAM_NODE_EVENTS,
+    RANDOM_STREAM_ANTIVIRALS,
+    RANDOM_STREAM_VACCINES,
+    RANDOM_STREAM_TRAVEL,
+    RANDOM_STREAM_ILI,
+    RANDOM_STREAM_ILI_REPORTS
+};
+
+// a tau-leaped node returns to event scheduling below this fraction of the tau-leaping threshold, so it doesn't switch back and forth
+static const double tauLeapExactFraction = 0.5;
+
+// number of tau-leaping steps per time step
+static const int tauLeapStepsPerDay = 4;
+
+// instrumentation counters kept for each node: events processed, indexed by StochasticSEATIRDEventType, then these
+enum NodeCounter
+{
+    NODE_COUNTER_NPI_BLOCKED_CONTACTS = CONTACT + 1,
+    NODE_COUNTER_TRAVEL_EXPOSURES,
+    NODE_COUNTER_SCHEDULES_CREATED,
+    NUM_NODE_COUNTERS
+};
+
+static const char * nodeCounterNames[NUM_NODE_COUNTERS] = { "events NONE", "events EtoA", "events AtoT", "events AtoR", "events AtoD", "events TtoI", "events TtoR", "events TtoD", "events ItoR", "events ItoD", "events CONTACT", "contacts blocked by Npis", "exposures from travel", "schedules created" };
 
-StochasticSEATIRD::StochasticSEATIRD()
+// draw the number of <num> individuals leaving a state with competing exponential exits with <rates> during <dt>, for each exit
+static void drawTauLeapExits(const gsl_rng * rng, int num, const double * rates, int numRates, const double &dt, unsigned int * numExits)
+{
+    double totalRate = 0.;
+
+    for(int i=0; i<numRates; i++)
+    {
+        totalRate += rates[i];
+        numExits[i] = 0;
+    }
+
+    if(num <= 0 || totalRate <= 0.)
+    {
+        return;
+    }
+
+    unsigned int numLeaving = gsl_ran_binomial(rng, 1. - exp(-totalRate * dt), (unsigned int)num);
+
+    // each individual leaving takes exit i with probability rates[i] / totalRate
+    if(numLeaving > 0)
+    {
+        gsl_ran_multinomial(rng, (size_t)numRates, numLeaving, rates, numExits);
+    }
+}
+
+StochasticSEATIRD::StochasticSEATIRD(int seed, int realization)
 {
     put_flog(LOG_DEBUG, "");
 
     // defaults
     cachedTime_ = -1;
+    numNodeThreads_ = 0;
+    tauLeapThreshold_ = 0;
 
-    // create other required variables for this model
-    newVariable("asymptomatic");
-    newVariable("treatable");
-    newVariable("infectious");
-    newVariable("recovered");
-    newVariable("deceased");
+    // derived variables; the others are those of SEATIRD
+    derivedVariables_["ILI reports"] = boost::bind(&StochasticSEATIRD::getDerivedVarILI, this, _1, _2, _3);
 
-    // the "treated" variable keeps tracks of those treated with antivirals
-    newVariable("treated");
+    // initiate random number generators
+    // this must be done before ILI initialization, which selects providers randomly
+    travelRandGenerator_ = RandomStream().allocGslRng();
+    iliRandGenerator_ = RandomStream().allocGslRng();
 
-    // need to keep track of number treated each day
-    newVariable("treated (daily)");
+    seedGenerators(seed, realization);
 
-    // need to keep track of number ineffectively treated each day
-    newVariable("treated (ineffective daily)");
+    // one schedule queue for each node
+    scheduleEventQueues_.resize(numNodes_);
 
-    // need to keep track of number vaccinated each day
-    newVariable("vaccinated (daily)");
+    // all nodes start with event scheduling
+    nodeTauLeaping_.resize(numNodes_, 0);
 
-    // derived variables
-    derivedVariables_["All infected"] = boost::bind(&StochasticSEATIRD::getDerivedVarInfected, this, _1, _2, _3);
-    derivedVariables_["vaccinated in lag period"] = boost::bind(&StochasticSEATIRD::getDerivedVarPopulationInVaccineLatencyPeriod, this, _1, _2, _3);
-    derivedVariables_["vaccinated effective"] = boost::bind(&StochasticSEATIRD::getDerivedVarPopulationEffectiveVaccines, this, _1, _2, _3);
-    derivedVariables_["ILI reports"] = boost::bind(&StochasticSEATIRD::getDerivedVarILI, this, _1, _2, _3);
+    nodeCounts_.resize(numNodes_ * NUM_NODE_COUNTERS, 0);
 
     // initialize ILI
-    iliProviders_ = iliInit();
+    iliProviders_ = iliInit(iliRand_);
 
     // initialize ILI values to zero
     std::vector<float> iliValues;
@@ -58,20 +105,54 @@ StochasticSEATIRD::StochasticSEATIRD()
 
     iliValues_.push_back(iliValues);
 
-    // initialize start time to 0
-    time_ = 0;
+    // events start at the beginning of time step 0
     now_ = 0.;
+}
+
+StochasticSEATIRD::StochasticSEATIRD(StochasticSEATIRD &simulation) : SEATIRD(simulation)
+{
+    put_flog(LOG_DEBUG, "");
 
-    // initiate random number generator
-    gsl_rng_env_setup();
-    randGenerator_ = gsl_rng_alloc(gsl_rng_default);
+    numNodeThreads_ = simulation.numNodeThreads_;
+    tauLeapThreshold_ = simulation.tauLeapThreshold_;
+
+    // derived variables are bound to this simulation
+    derivedVariables_["ILI reports"] = boost::bind(&StochasticSEATIRD::getDerivedVarILI, this, _1, _2, _3);
+
+    // random number streams
+    antiviralsRand_ = simulation.antiviralsRand_;
+    vaccinesRand_ = simulation.vaccinesRand_;
+    iliRand_ = simulation.iliRand_;
+    nodeRands_ = simulation.nodeRands_;
+
+    travelRandGenerator_ = gsl_rng_clone(simulation.travelRandGenerator_);
+    iliRandGenerator_ = gsl_rng_clone(simulation.iliRandGenerator_);
+
+    now_ = simulation.now_;
+
+    // the live schedules
+    scheduleEventQueues_ = simulation.scheduleEventQueues_;
+    nodeTauLeaping_ = simulation.nodeTauLeaping_;
+
+    // the fork has no instrumentation, so its counts start over
+    nodeCounts_.resize(numNodes_ * NUM_NODE_COUNTERS, 0);
+
+    // cached values; these are copied, so the two simulations share no reference counted arrays
+    cachedTime_ = simulation.cachedTime_;
+    populationNodes_.reference(simulation.populationNodes_.copy());
+    populations_.reference(simulation.populations_.copy());
+
+    // ILI
+    iliProviders_ = simulation.iliProviders_;
+    iliValues_ = simulation.iliValues_;
 }
 
 StochasticSEATIRD::~StochasticSEATIRD()
 {
     put_flog(LOG_DEBUG, "");
 
-    gsl_rng_free(randGenerator_);
+    gsl_rng_free(travelRandGenerator_);
+    gsl_rng_free(iliRandGenerator_);
 }
 
 int StochasticSEATIRD::expose(int num, int nodeId, std::vector<int> stratificationValues)
@@ -92,17 +173,261 @@ int StochasticSEATIRD::expose(int num, int nodeId, std::vector<int> stratificati
         precompute(time_+1);
     }
 
-    int numExposed = EpidemicSimulation::expose(num, nodeId, stratificationValues);
+    if(nodeIdToIndex_.count(nodeId) == 0)
+    {
+        put_flog(LOG_ERROR, "no such nodeId %i", nodeId);
+        return 0;
+    }
+
+    int nodeIndex = nodeIdToIndex_[nodeId];
+
+    return exposeAtNode(num, nodeIndex, stratificationValues, now_, nodeRands_[nodeIndex]);
+}
+
+void StochasticSEATIRD::setNumNodeThreads(int numThreads)
+{
+    numNodeThreads_ = numThreads;
+}
+
+void StochasticSEATIRD::setTauLeapThreshold(int threshold)
+{
+    tauLeapThreshold_ = threshold;
+}
+
+void StochasticSEATIRD::reseed(int seed, int realization)
+{
+    seedGenerators(seed, realization);
+}
+
+boost::shared_ptr<StochasticSEATIRD> StochasticSEATIRD::fork()
+{
+    boost::shared_ptr<StochasticSEATIRD> simulation(new StochasticSEATIRD(*this));
+
+    put_flog(LOG_INFO, "forked simulation at time %i", time_);
+
+    return simulation;
+}
+
+void StochasticSEATIRD::seedGenerators(int seed, int realization)
+{
+    if(seed < 0)
+    {
+        // MTRand seeds itself from /dev/urandom, or the time and clock
+        seed = (int)(MTRand().randInt() & 0x7fffffff);
+
+        put_flog(LOG_INFO, "random seed %i", seed);
+    }
+    else
+    {
+        put_flog(LOG_DEBUG, "seed %i, realization %i", seed, realization);
+    }
+
+    antiviralsRand_.setKey(seed, realization, RANDOM_STREAM_ANTIVIRALS);
+    vaccinesRand_.setKey(seed, realization, RANDOM_STREAM_VACCINES);
+    iliRand_.setKey(seed, realization, RANDOM_STREAM_ILI);
+
+    RandomStream(seed, realization, RANDOM_STREAM_TRAVEL).copyToGslRng(travelRandGenerator_);
+    RandomStream(seed, realization, RANDOM_STREAM_ILI_REPORTS).copyToGslRng(iliRandGenerator_);
+
+    nodeRands_.resize(numNodes_);
+
+    for(int i=0; i<numNodes_; i++)
+    {
+        nodeRands_[i].setKey(seed, realization, RANDOM_STREAM_NODE_EVENTS, i);
+    }
+}
+
+bool StochasticSEATIRD::writeCheckpoint(CheckpointWriter &out)
+{
+    if(SEATIRD::writeCheckpoint(out) != true)
+    {
+        return false;
+    }
+
+    out.writeTag("StochasticSEATIRD");
+
+    // random number generators
+    out.writeRand(antiviralsRand_);
+    out.writeRand(vaccinesRand_);
+    out.writeRng(travelRandGenerator_);
+    out.writeRand(iliRand_);
+    out.writeRng(iliRandGenerator_);
+
+    for(unsigned int i=0; i<nodeRands_.size(); i++)
+    {
+        out.writeRand(nodeRands_[i]);
+    }
+
+    out.write(now_);
+
+    // the cached values are used by expose() between time steps, so they are saved rather than recomputed
+    out.write((boost::int32_t)cachedTime_);
+
+    if(cachedTime_ >= 0)
+    {
+        out.writeArray(populationNodes_.data(), populationNodes_.size());
+        out.writeArray(populations_.data(), populations_.size());
+    }
+
+    for(unsigned int i=0; i<scheduleEventQueues_.size(); i++)
+    {
+        scheduleEventQueues_[i].writeCheckpoint(out);
+    }
+
+    out.writeVector(nodeTauLeaping_);
+
+    // ILI
+    out.write((boost::int32_t)iliProviders_.size());
+
+    for(unsigned int i=0; i<iliProviders_.size(); i++)
+    {
+        out.writeVector(iliProviders_[i].starts);
+        out.writeVector(iliProviders_[i].stops);
+        out.writeVector(iliProviders_[i].status);
+    }
+
+    out.write((boost::int32_t)iliValues_.size());
+
+    for(unsigned int i=0; i<iliValues_.size(); i++)
+    {
+        out.writeVector(iliValues_[i]);
+    }
+
+    return out.good();
+}
+
+bool StochasticSEATIRD::readCheckpoint(CheckpointReader &in)
+{
+    if(SEATIRD::readCheckpoint(in) != true || in.readTag("StochasticSEATIRD") != true)
+    {
+        return false;
+    }
+
+    // random number generators
+    if(in.readRand(antiviralsRand_) != true || in.readRand(vaccinesRand_) != true || in.readRng(travelRandGenerator_) != true || in.readRand(iliRand_) != true || in.readRng(iliRandGenerator_) != true)
+    {
+        return false;
+    }
+
+    for(unsigned int i=0; i<nodeRands_.size(); i++)
+    {
+        if(in.readRand(nodeRands_[i]) != true)
+        {
+            return false;
+        }
+    }
+
+    boost::int32_t cachedTime;
+
+    if(in.read(now_) != true || in.read(cachedTime) != true)
+    {
+        return false;
+    }
+
+    cachedTime_ = cachedTime;
+
+    if(cachedTime_ >= 0)
+    {
+        blitz::Array<double, 1> populationNodes(numNodes_);
+
+        blitz::TinyVector<int, 1+NUM_STRATIFICATION_DIMENSIONS> shape;
+        shape(0) = numNodes_;
+        shape(1) = numAgeGroups;
+        shape(2) = numRiskGroups;
+        shape(3) = numVaccinatedGroups;
+
+        blitz::Array<double, 1+NUM_STRATIFICATION_DIMENSIONS> populations(shape);
+
+        if(in.readArray(populationNodes.data(), populationNodes.size()) != true || in.readArray(populations.data(), populations.size()) != true)
+        {
+            return false;
+        }
+
+        populationNodes_.reference(populationNodes);
+        populations_.reference(populations);
+    }
+
+    for(unsigned int i=0; i<scheduleEventQueues_.size(); i++)
+    {
+        if(scheduleEventQueues_[i].readCheckpoint(in) != true)
+        {
+            put_flog(LOG_ERROR, "could not read schedules of node index %i", i);
+            return false;
+        }
+    }
+
+    std::vector<char> nodeTauLeaping;
+
+    if(in.readVector(nodeTauLeaping) != true || (int)nodeTauLeaping.size() != numNodes_)
+    {
+        return false;
+    }
+
+    nodeTauLeaping_.swap(nodeTauLeaping);
+
+    // ILI
+    boost::int32_t numIliProviders;
+
+    // each provider has three vectors, and each time a vector
+    if(in.read(numIliProviders) != true || numIliProviders < 0 || in.checkSize(numIliProviders, 3 * sizeof(boost::uint64_t)) != true)
+    {
+        return false;
+    }
+
+    std::vector<Provider> iliProviders(numIliProviders);
+
+    for(int i=0; i<numIliProviders; i++)
+    {
+        if(in.readVector(iliProviders[i].starts) != true || in.readVector(iliProviders[i].stops) != true || in.readVector(iliProviders[i].status) != true)
+        {
+            return false;
+        }
+    }
+
+    boost::int32_t numIliTimes;
+
+    if(in.read(numIliTimes) != true || numIliTimes < 0 || in.checkSize(numIliTimes, sizeof(boost::uint64_t)) != true)
+    {
+        return false;
+    }
+
+    std::vector<std::vector<float> > iliValues(numIliTimes);
+
+    for(int i=0; i<numIliTimes; i++)
+    {
+        if(in.readVector(iliValues[i]) != true)
+        {
+            return false;
+        }
+    }
+
+    iliProviders_.swap(iliProviders);
+    iliValues_.swap(iliValues);
+
+    return true;
+}
+
+int StochasticSEATIRD::exposeAtNode(int num, int nodeIndex, const std::vector<int> &stratificationValues, const double &now, RandomStream &rand)
+{
+    int numExposed = transition(num, susceptibleHandle_, exposedHandle_, nodeIndex, stratificationValues);
+
+    // tau-leaped nodes only have counts
+    if(nodeTauLeaping_[nodeIndex] != 0)
+    {
+        return numExposed;
+    }
+
+    nodeCounts_[nodeIndex * NUM_NODE_COUNTERS + NODE_COUNTER_SCHEDULES_CREATED] += numExposed;
 
     // create events based on these new exposures
     for(int i=0; i<numExposed; i++)
     {
-        StochasticSEATIRDSchedule schedule(now_, rand_, stratificationValues);
+        StochasticSEATIRDSchedule schedule(now, rand, stratificationValues);
 
-        initializeContactEvents(schedule, nodeId, stratificationValues);
+        initializeContactEvents(schedule, nodeIndex, stratificationValues, rand);
 
         // now add event schedules to big queue
-        scheduleEventQueues_[nodeId].push(schedule);
+        scheduleEventQueues_[nodeIndex].insert(schedule);
     }
 
     return numExposed;
@@ -116,287 +441,582 @@ void StochasticSEATIRD::simulate()
     // base class simulate(): copies variables to new time step (time_+1) and evolves stockpile network
     EpidemicSimulation::simulate();
 
-    // enable this for schedule verification (this is expensive!)
-#if 0
-    if(verifyScheduleCounts() != true)
+    // the schedule counts are kept by the schedule queues, so this is cheap enough to do every time step
     {
-        put_flog(LOG_ERROR, "failed verification of schedule counts");
+        InstrumentationTimer timer(instrumentation_.get(), "verify schedule counts");
+
+        if(verifyScheduleCounts() != true)
+        {
+            put_flog(LOG_ERROR, "failed verification of schedule counts at time %i", time_+1);
+        }
     }
-#endif
 
     // apply treatments
+    applyTreatments();
+
+    {
+        InstrumentationTimer timer(instrumentation_.get(), "precompute");
+
+        // pre-compute some frequently used values
+        // this should be done after applyVaccines() since individuals may be changing stratifications
+        // we operate on the new time step (time_+1) to capture such stratification changes
+        precompute(time_+1);
+
+        // events during this time step use the Npis active at time_
+        npiEffectivenessTable_.update(g_parameters.getNpis(), g_parameters.getNpisVersion(), time_, nodeIdToIndex_, numNodes_, numAgeGroups);
+    }
 
-    // create a priority group selection for all of the population, for pure pro-rata treatments
-    std::vector<int> stratificationValues(1, STRATIFICATIONS_ALL);
-    std::vector<std::vector<int> > stratificationVectorValues(3, stratificationValues);
-    boost::shared_ptr<PriorityGroup> priorityGroupAll = boost::shared_ptr<PriorityGroup>(new PriorityGroup("_ALL_", stratificationVectorValues));
-    boost::shared_ptr<PriorityGroupSelections> priorityGroupSelectionsAll(new PriorityGroupSelections(std::vector<boost::shared_ptr<PriorityGroup> >(1, priorityGroupAll)));
+    // process events for each node
+    // within a time step nodes only interact through travel(), so they can be processed concurrently
+    {
+        InstrumentationTimer timer(instrumentation_.get(), "events");
 
-    // reset number treated for today
-    // do this here since we may have multiple treatments in one day
-    variables_["treated (daily)"](time_+1, blitz::Range::all(), blitz::Range::all(), blitz::Range::all(), blitz::Range::all()) = 0.;
-    variables_["treated (ineffective daily)"](time_+1, blitz::Range::all(), blitz::Range::all(), blitz::Range::all(), blitz::Range::all()) = 0.;
-    variables_["vaccinated (daily)"](time_+1, blitz::Range::all(), blitz::Range::all(), blitz::Range::all(), blitz::Range::all()) = 0.;
+        parallelFor(numNodes_, numNodeThreads_, boost::bind(&StochasticSEATIRD::processNodeEvents, this, _1));
+    }
 
-    // apply treatments to priority group selections; then remaining to the entire population
-    applyAntiviralsToPriorityGroupSelections(g_parameters.getAntiviralPriorityGroupSelections());
-    applyAntiviralsToPriorityGroupSelections(priorityGroupSelectionsAll);
+    // current event time is now the end of the current day
+    now_ = (double)time_ + 1.;
 
-    applyVaccinesToPriorityGroupSelections(g_parameters.getVaccinePriorityGroupSelections());
-    applyVaccinesToPriorityGroupSelections(priorityGroupSelectionsAll);
+    // travel between nodes
+    {
+        InstrumentationTimer timer(instrumentation_.get(), "travel");
 
-    // pre-compute some frequently used values
-    // this should be done after applyVaccines() since individuals may be changing stratifications
-    // we operate on the new time step (time_+1) to capture such stratification changes
-    precompute(time_+1);
+        travel();
+    }
 
-    // process events for each node
-    for(unsigned int i=0; i<nodeIds_.size(); i++)
+    // ILI
     {
-        int nodeId = nodeIds_[i];
+        InstrumentationTimer timer(instrumentation_.get(), "ili");
 
-        while(scheduleEventQueues_[nodeId].empty() != true && scheduleEventQueues_[nodeId].top().getTopEvent().time < (double)time_+1.)
+        std::vector<float> infectious;
+        std::vector<float> population;
+
+        std::vector<int> nodeIds = getNodeIds();
+
+        for(unsigned int i=0; i<nodeIds.size(); i++)
         {
-            // pop the schedule off the schedule queue
-            StochasticSEATIRDSchedule schedule = scheduleEventQueues_[nodeId].top();
-            scheduleEventQueues_[nodeId].pop();
+            infectious.push_back(getDerivedVarInfected(time_, nodeIds[i]));
+            population.push_back(getPopulation(nodeIds[i]));
+        }
 
-            // make sure schedule isn't empty or canceled (it could be canceled from applying treatments, for example)
-            if(schedule.empty() != true && schedule.canceled() != true)
-            {
-                // pop the event off the schedule's event queue
-                StochasticSEATIRDEvent event = schedule.getTopEvent();
-                schedule.popTopEvent();
+        std::vector<float> iliValues = iliView(infectious, population, iliProviders_, iliRand_, iliRandGenerator_);
 
-                // process the event
-                now_ = event.time;
+        iliValues_.push_back(iliValues);
+    }
 
-                processEvent(nodeId, event);
+    endInstrumentationTimeStep();
 
-                // re-insert the schedule back into the schedule queue
-                // it will be sorted corresponding to its next event
-                if(schedule.empty() != true)
-                {
-                    scheduleEventQueues_[nodeId].push(schedule);
-                }
+    // increment current time
+    time_++;
+}
+
+void StochasticSEATIRD::endInstrumentationTimeStep()
+{
+    if(instrumentation_ != NULL)
+    {
+        // sum the counts over nodes
+        for(int c=0; c<NUM_NODE_COUNTERS; c++)
+        {
+            long count = 0;
+
+            for(int nodeIndex=0; nodeIndex<numNodes_; nodeIndex++)
+            {
+                count += nodeCounts_[nodeIndex * NUM_NODE_COUNTERS + c];
             }
+
+            // there are no events without a type
+            if(c != NONE)
+            {
+                instrumentation_->setCount(nodeCounterNames[c], (double)count);
+            }
+        }
+
+        // sizes of the schedule queues at the end of the time step
+        long numSchedules = 0;
+        int maxNodeNumSchedules = 0;
+        int numTauLeapingNodes = 0;
+
+        for(int nodeIndex=0; nodeIndex<numNodes_; nodeIndex++)
+        {
+            numSchedules += scheduleEventQueues_[nodeIndex].size();
+            maxNodeNumSchedules = std::max(maxNodeNumSchedules, scheduleEventQueues_[nodeIndex].size());
+            numTauLeapingNodes += (nodeTauLeaping_[nodeIndex] != 0 ? 1 : 0);
         }
+
+        instrumentation_->setCount("queued schedules", (double)numSchedules);
+        instrumentation_->setCount("queued schedules (max node)", (double)maxNodeNumSchedules);
+        instrumentation_->setCount("tau-leaping nodes", (double)numTauLeapingNodes);
+
+        instrumentation_->endTimeStep(time_+1);
     }
 
-    // current event time is now the end of the current day
-    now_ = (double)time_ + 1.;
+    // counts are kept without instrumentation too, since that is cheaper than testing for it; they start over each time step
+    std::fill(nodeCounts_.begin(), nodeCounts_.end(), 0);
+}
 
-    // travel between nodes
-    travel();
+float StochasticSEATIRD::getDerivedVarILI(int time, int nodeId, std::vector<int> stratificationValues)
+{
+    // ILI values for a time are computed while simulating the next time step
+    if(time < 0 || time >= (int)iliValues_.size())
+    {
+        put_flog(LOG_WARN, "no ILI values for time %i", time);
+        return 0.;
+    }
 
-    // ILI
-    std::vector<float> infectious;
-    std::vector<float> population;
+    return iliValues_[time][nodeIdToIndex_[nodeId]] * getPopulation(nodeId);
+}
 
-    std::vector<int> nodeIds = getNodeIds();
+std::vector<Provider> StochasticSEATIRD::getIliProviders()
+{
+    return iliProviders_;
+}
 
-    for(unsigned int i=0; i<nodeIds.size(); i++)
+void StochasticSEATIRD::processNodeEvents(int nodeIndex)
+{
+    updateNodeTauLeaping(nodeIndex);
+
+    if(nodeTauLeaping_[nodeIndex] != 0)
     {
-        infectious.push_back(getDerivedVarInfected(time_, nodeIds[i]));
-        population.push_back(getPopulation(nodeIds[i]));
+        tauLeapNode(nodeIndex);
+        return;
     }
 
-    std::vector<float> iliValues = iliView(infectious, population, iliProviders_);
+    StochasticSEATIRDScheduleQueue &queue = scheduleEventQueues_[nodeIndex];
 
-    iliValues_.push_back(iliValues);
+    while(queue.empty() != true && queue.getTopTime() < (double)time_+1.)
+    {
+        // pop the schedule off the schedule queue; it stays in place in the queue's storage
+        int index = queue.top();
+        queue.pop();
 
-    // increment current time
-    time_++;
+        // make sure schedule isn't empty or canceled (it could be canceled from applying treatments, for example)
+        // the reference is only valid until new schedules are inserted (by processing the event)
+        StochasticSEATIRDSchedule &schedule = queue.getSchedule(index);
+
+        if(schedule.empty() != true && schedule.canceled() != true)
+        {
+            // pop the event off the schedule's event queue
+            StochasticSEATIRDEvent event = schedule.getTopEvent();
+            schedule.popTopEvent();
+
+            nodeCounts_[nodeIndex * NUM_NODE_COUNTERS + event.getType()]++;
+
+            // contacts are generated one at a time: the next one is drawn when this one occurs
+            if(event.getType() == CONTACT)
+            {
+                insertNextContactEvent(schedule, nodeIndex, schedule.getStratificationValues(), event.time, nodeRands_[nodeIndex]);
+            }
+
+            // process the event
+            processEvent(nodeIndex, event);
+        }
+
+        // re-insert the schedule back into the schedule queue
+        // it will be sorted corresponding to its next event; empty or canceled schedules are released
+        queue.requeue(index);
+    }
 }
 
-float StochasticSEATIRD::getDerivedVarInfected(int time, int nodeId, std::vector<int> stratificationValues)
+int StochasticSEATIRD::getNodeNumInfected(int nodeIndex)
 {
-    float infected = 0.;
-    infected += getValue("asymptomatic", time, nodeId, stratificationValues);
-    infected += getValue("treatable", time, nodeId, stratificationValues);
-    infected += getValue("infectious", time, nodeId, stratificationValues);
+    // read the values directly rather than marginals, which are shared by all nodes
+    EpidemicVariable &exposed = getVariable(exposedHandle_);
+    EpidemicVariable &asymptomatic = getVariable(asymptomaticHandle_);
+    EpidemicVariable &treatable = getVariable(treatableHandle_);
+    EpidemicVariable &infectious = getVariable(infectiousHandle_);
 
-    return infected;
+    int numInfected = 0;
+
+    for(int a=0; a<numAgeGroups; a++)
+    {
+        for(int r=0; r<numRiskGroups; r++)
+        {
+            for(int v=0; v<numVaccinatedGroups; v++)
+            {
+                numInfected += (int)exposed(time_+1, nodeIndex, a, r, v) + (int)asymptomatic(time_+1, nodeIndex, a, r, v) + (int)treatable(time_+1, nodeIndex, a, r, v) + (int)infectious(time_+1, nodeIndex, a, r, v);
+            }
+        }
+    }
+
+    return numInfected;
 }
 
-float StochasticSEATIRD::getDerivedVarPopulationInVaccineLatencyPeriod(int time, int nodeId, std::vector<int> stratificationValues)
+void StochasticSEATIRD::updateNodeTauLeaping(int nodeIndex)
 {
-    // should match the other getPopulationInVaccineLatencyPeriod() method below
+    if(tauLeapThreshold_ <= 0 && nodeTauLeaping_[nodeIndex] == 0)
+    {
+        return;
+    }
 
-    // no need to limit to vaccinated stratification, since non-vaccinated will always be zero for this variable
+    int numInfected = getNodeNumInfected(nodeIndex);
 
-    int vaccineLatencyPeriod = g_parameters.getVaccineLatencyPeriod();
+    if(nodeTauLeaping_[nodeIndex] == 0 && numInfected >= tauLeapThreshold_)
+    {
+        // the counts in the variables replace the schedules
+        // the remaining times in each state are exponential (except for the treatable period), so dropping the drawn times doesn't bias the continuation
+        scheduleEventQueues_[nodeIndex].clear();
 
-    float total = 0;
+        nodeTauLeaping_[nodeIndex] = 1;
 
-    // with these inequalities, a 0 day latency period will always return 0, as expected
-    for(int t=time; t>=0 && t>(time - vaccineLatencyPeriod); t--)
-    {
-        // vaccinated stratification == 1
-        total += getValue("vaccinated (daily)", t, nodeId, stratificationValues);
+        put_flog(LOG_DEBUG, "node index %i: tau-leaping at time %i with %i infected", nodeIndex, time_, numInfected);
     }
+    else if(nodeTauLeaping_[nodeIndex] != 0 && (tauLeapThreshold_ <= 0 || numInfected < (int)(tauLeapExactFraction * (double)tauLeapThreshold_)))
+    {
+        // create a schedule for each individual from its current state
+        RandomStream &rand = nodeRands_[nodeIndex];
+
+        EpidemicVariableHandle handles[] = { exposedHandle_, asymptomaticHandle_, treatableHandle_, infectiousHandle_ };
+        StochasticSEATIRDScheduleState states[] = { E, A, T, I };
+
+        std::vector<int> stratificationValues(NUM_STRATIFICATION_DIMENSIONS);
+
+        for(int a=0; a<numAgeGroups; a++)
+        {
+            for(int r=0; r<numRiskGroups; r++)
+            {
+                for(int v=0; v<numVaccinatedGroups; v++)
+                {
+                    stratificationValues[0] = a;
+                    stratificationValues[1] = r;
+                    stratificationValues[2] = v;
+
+                    for(int s=0; s<4; s++)
+                    {
+                        int num = (int)getVariable(handles[s])(time_+1, nodeIndex, a, r, v);
+
+                        for(int i=0; i<num; i++)
+                        {
+                            StochasticSEATIRDSchedule schedule(now_, rand, stratificationValues, states[s]);
+
+                            initializeContactEvents(schedule, nodeIndex, stratificationValues, rand);
+
+                            scheduleEventQueues_[nodeIndex].insert(schedule);
+
+                            nodeCounts_[nodeIndex * NUM_NODE_COUNTERS + NODE_COUNTER_SCHEDULES_CREATED]++;
+                        }
+                    }
+                }
+            }
+        }
+
+        nodeTauLeaping_[nodeIndex] = 0;
 
-    return total;
+        put_flog(LOG_DEBUG, "node index %i: event scheduling at time %i with %i infected", nodeIndex, time_, numInfected);
+    }
 }
 
-float StochasticSEATIRD::getDerivedVarPopulationEffectiveVaccines(int time, int nodeId, std::vector<int> stratificationValues)
+void StochasticSEATIRD::tauLeapNode(int nodeIndex)
 {
-    // vaccinated stratification == 1
-    // return 0 if unvaccinated stratification was explicitly specified
-    if(stratificationValues.size() >= 3 && (stratificationValues[2] != 1 && stratificationValues[2] != STRATIFICATIONS_ALL))
+    // an unpopulated node has no contacts
+    double populationNode = populationNodes_(nodeIndex);
+
+    if(populationNode <= 0.)
     {
-        return 0.;
+        return;
     }
 
-    // make sure stratifications size is full and choose vaccinated stratification
-    for(unsigned int i=stratificationValues.size(); i<3; i++)
+    // binomial draws use the node's stream, so nodes can be processed concurrently and deterministically
+    gsl_rng rng = nodeRands_[nodeIndex].getGslRng();
+
+    EpidemicVariable &susceptible = getVariable(susceptibleHandle_);
+    EpidemicVariable &exposed = getVariable(exposedHandle_);
+    EpidemicVariable &asymptomatic = getVariable(asymptomaticHandle_);
+    EpidemicVariable &treatable = getVariable(treatableHandle_);
+    EpidemicVariable &infectious = getVariable(infectiousHandle_);
+
+    // todo: beta should be age-specific considering PHA's
+    double beta = g_parameters.getR0() / g_parameters.getBetaScale();
+
+    // todo: should be age-specific
+    double vaccineEffectiveness = g_parameters.getVaccineEffectiveness();
+
+    // rates of the transitions, as in StochasticSEATIRDSchedule
+    // the fixed treatable period is approximated by an exponential one with the same mean
+    double rateEtoA = 1. / g_parameters.getTau();
+    double rateAtoT = 1. / g_parameters.getKappa();
+    double rateTtoI = 1. / g_parameters.getChi();
+    double rateRecovery = 1. / g_parameters.getGamma();
+
+    double dt = 1. / (double)tauLeapStepsPerDay;
+
+    // the transitions of a step
+    const int numTransitionTypes = 10;
+
+    EpidemicVariableHandle fromHandles[] = { susceptibleHandle_, exposedHandle_, asymptomaticHandle_, asymptomaticHandle_, asymptomaticHandle_, treatableHandle_, treatableHandle_, treatableHandle_, infectiousHandle_, infectiousHandle_ };
+    EpidemicVariableHandle toHandles[] = { exposedHandle_, asymptomaticHandle_, treatableHandle_, recoveredHandle_, deceasedHandle_, infectiousHandle_, recoveredHandle_, deceasedHandle_, recoveredHandle_, deceasedHandle_ };
+
+    // numbers of transitions for each stratification
+    blitz::Array<int, 1+NUM_STRATIFICATION_DIMENSIONS> numTransitions(numTransitionTypes, numAgeGroups, numRiskGroups, numVaccinatedGroups);
+
+    std::vector<int> stratificationValues(NUM_STRATIFICATION_DIMENSIONS);
+
+    for(int step=0; step<tauLeapStepsPerDay; step++)
     {
-        stratificationValues.push_back(STRATIFICATIONS_ALL);
-    }
+        // all draws of a step use the counts at the start of the step
+
+        // infected (asymptomatic, treatable, infectious) of each age group; these make contacts
+        double infected[numAgeGroups];
+
+        for(int a=0; a<numAgeGroups; a++)
+        {
+            infected[a] = 0.;
+
+            for(int r=0; r<numRiskGroups; r++)
+            {
+                for(int v=0; v<numVaccinatedGroups; v++)
+                {
+                    infected[a] += (int)asymptomatic(time_+1, nodeIndex, a, r, v) + (int)treatable(time_+1, nodeIndex, a, r, v) + (int)infectious(time_+1, nodeIndex, a, r, v);
+                }
+            }
+        }
+
+        for(int a=0; a<numAgeGroups; a++)
+        {
+            // exposures per unvaccinated susceptible per day
+            // this is the rate of the contact events of insertNextContactEvent() and processEvent() that expose a given susceptible
+            double forceOfInfection = 0.;
+
+            for(int b=0; b<numAgeGroups; b++)
+            {
+                forceOfInfection += (1. - npiEffectivenessTable_.getNpiEffectiveness(nodeIndex, b, a)) * beta * ageContactRates[b][a] * ageSusceptibilities[a] * infected[b] / populationNode;
+            }
+
+            // compute nu (rate) from nu (CFR)
+            double nu = -1./g_parameters.getGamma() * log(1. - g_parameters.getNu(a));
+
+            double ratesA[] = { rateAtoT, rateRecovery, nu };
+            double ratesT[] = { rateTtoI, rateRecovery, nu };
+            double ratesI[] = { rateRecovery, nu };
+
+            for(int r=0; r<numRiskGroups; r++)
+            {
+                // the vaccine protects those vaccinated, and not in the vaccine latency period, with probability vaccineEffectiveness
+                double vaccinatedPopulation = populations_(nodeIndex, a, r, 1);
+                double vaccineProtection = 0.;
+
+                if(vaccinatedPopulation > 0.)
+                {
+                    vaccineProtection = vaccineEffectiveness * std::max(0., 1. - (double)getPopulationInVaccineLatencyPeriod(nodeIndex, a, r) / vaccinatedPopulation);
+                }
+
+                for(int v=0; v<numVaccinatedGroups; v++)
+                {
+                    double rateExposure = forceOfInfection;
+
+                    // vaccinated stratification == 1
+                    if(v == 1)
+                    {
+                        rateExposure *= 1. - vaccineProtection;
+                    }
+
+                    int numSusceptible = (int)susceptible(time_+1, nodeIndex, a, r, v);
+
+                    numTransitions(0, a, r, v) = numSusceptible > 0 ? (int)gsl_ran_binomial(&rng, 1. - exp(-rateExposure * dt), (unsigned int)numSusceptible) : 0;
+
+                    int numExposed = (int)exposed(time_+1, nodeIndex, a, r, v);
+
+                    numTransitions(1, a, r, v) = numExposed > 0 ? (int)gsl_ran_binomial(&rng, 1. - exp(-rateEtoA * dt), (unsigned int)numExposed) : 0;
 
-    stratificationValues[2] = 1;
+                    unsigned int numExits[3];
 
-    return getValue("population", time, nodeId, stratificationValues) - getDerivedVarPopulationInVaccineLatencyPeriod(time, nodeId, stratificationValues);
+                    drawTauLeapExits(&rng, (int)asymptomatic(time_+1, nodeIndex, a, r, v), ratesA, 3, dt, numExits);
+
+                    numTransitions(2, a, r, v) = (int)numExits[0];
+                    numTransitions(3, a, r, v) = (int)numExits[1];
+                    numTransitions(4, a, r, v) = (int)numExits[2];
+
+                    drawTauLeapExits(&rng, (int)treatable(time_+1, nodeIndex, a, r, v), ratesT, 3, dt, numExits);
+
+                    numTransitions(5, a, r, v) = (int)numExits[0];
+                    numTransitions(6, a, r, v) = (int)numExits[1];
+                    numTransitions(7, a, r, v) = (int)numExits[2];
+
+                    drawTauLeapExits(&rng, (int)infectious(time_+1, nodeIndex, a, r, v), ratesI, 2, dt, numExits);
+
+                    numTransitions(8, a, r, v) = (int)numExits[0];
+                    numTransitions(9, a, r, v) = (int)numExits[1];
+                }
+            }
+        }
+
+        // apply the transitions; each state loses at most its count at the start of the step
+        for(int a=0; a<numAgeGroups; a++)
+        {
+            for(int r=0; r<numRiskGroups; r++)
+            {
+                for(int v=0; v<numVaccinatedGroups; v++)
+                {
+                    stratificationValues[0] = a;
+                    stratificationValues[1] = r;
+                    stratificationValues[2] = v;
+
+                    for(int t=0; t<numTransitionTypes; t++)
+                    {
+                        if(numTransitions(t, a, r, v) > 0)
+                        {
+                            transition(numTransitions(t, a, r, v), fromHandles[t], toHandles[t], nodeIndex, stratificationValues);
+                        }
+                    }
+                }
+            }
+        }
+    }
 }
 
-float StochasticSEATIRD::getDerivedVarILI(int time, int nodeId, std::vector<int> stratificationValues)
+void StochasticSEATIRD::initializeContactEvents(StochasticSEATIRDSchedule &schedule, const int &nodeIndex, const std::vector<int> &stratificationValues, RandomStream &rand)
 {
-    return iliValues_[time][nodeIdToIndex_[nodeId]] * getPopulation(nodeId);
+    // make sure we have expected stratifications
+    if((int)stratifications_[0].size() != numAgeGroups || (int)stratifications_[1].size() != numRiskGroups || (int)stratifications_[2].size() != numVaccinatedGroups)
+    {
+        put_flog(LOG_ERROR, "wrong number of stratifications");
+        return;
+    }
+
+    // contacts can occur from the start of the asymptomatic state
+    insertNextContactEvent(schedule, nodeIndex, stratificationValues, schedule.getInfectedTMin(), rand);
 }
 
-std::vector<Provider> StochasticSEATIRD::getIliProviders()
+void StochasticSEATIRD::insertNextContactEvent(StochasticSEATIRDSchedule &schedule, const int &nodeIndex, const std::vector<int> &stratificationValues, const double &TcInit, RandomStream &rand)
 {
-    return iliProviders_;
+    double rates[numAgeGroups * numRiskGroups];
+
+    double totalRate = getContactRates(nodeIndex, stratificationValues[0], rates);
+
+    if(totalRate <= 0.)
+    {
+        return;
+    }
+
+    // contacts of all target groups together are a Poisson process of the total rate
+    double Tc = TcInit + random_exponential(totalRate, &rand);
+
+    // until recovered / deceased
+    if(Tc < schedule.getInfectedTMax())
+    {
+        // the target is chosen when the contact is processed
+        schedule.insertEvent(StochasticSEATIRDEvent::create(TcInit, Tc, CONTACT, stratificationValues));
+    }
 }
 
-void StochasticSEATIRD::initializeContactEvents(StochasticSEATIRDSchedule &schedule, const int &nodeId, const std::vector<int> &stratificationValues)
+double StochasticSEATIRD::getContactRates(const int &nodeIndex, const int &ageGroup, double * rates)
 {
     // todo: beta should be age-specific considering PHA's
     double beta = g_parameters.getR0() / g_parameters.getBetaScale();
 
-    // todo: should be in parameters
-    static double sigma[] = {1.00, 0.98, 0.94, 0.91, 0.66};
-
-    // todo: should be in parameters
-    static double contact[5][5] = {    { 45.1228487783,8.7808312353,11.7757947836,6.10114751268,4.02227175596 },
-                                { 8.7808312353,41.2889143668,13.3332813497,7.847051289,4.22656343551 },
-                                { 11.7757947836,13.3332813497,21.4270155984,13.7392636644,6.92483172729 },
-                                { 6.10114751268,7.847051289,13.7392636644,18.0482119252,9.45371062356 },
-                                { 4.02227175596,4.22656343551,6.92483172729,9.45371062356,14.0529294262 }   };
-
-    // make sure we have expected stratifications
-    if((int)stratifications_[0].size() != StochasticSEATIRD::numAgeGroups_ || (int)stratifications_[1].size() != StochasticSEATIRD::numRiskGroups_ || (int)stratifications_[2].size() != StochasticSEATIRD::numVaccinatedGroups_)
-    {
-        put_flog(LOG_ERROR, "wrong number of stratifications");
-        return;
-    }
-
-    // contact events will only be targeted at (age group, risk group)
-    // vaccinated status changes over time, and these events are all initiated at the point of exposure
-    // when the contact event occurs, it will then be determined if the target individual is vaccinated or not
-    std::vector<int> toStratificationValues(2);
+    double totalRate = 0.;
 
-    for(int a=0; a<StochasticSEATIRD::numAgeGroups_; a++)
+    for(int a=0; a<numAgeGroups; a++)
     {
-        for(int r=0; r<StochasticSEATIRD::numRiskGroups_; r++)
+        for(int r=0; r<numRiskGroups; r++)
         {
-            toStratificationValues[0] = a;
-            toStratificationValues[1] = r;
-
             // fraction of the to group in population; use cached values
             // sum both unvaccinated and vaccinated stratifications
-            double toGroupFraction = (populations_(nodeIdToIndex_[nodeId], a, r, 0) + populations_(nodeIdToIndex_[nodeId], a, r, 1))  / populationNodes_(nodeIdToIndex_[nodeId]);
-
-            double contactRate = contact[stratificationValues[0]][a];
-            double transmissionRate = beta * contactRate * sigma[a] * toGroupFraction;
-
-            // contacts can occur within this time range
-            double TcInit = schedule.getInfectedTMin(); // asymptomatic
-            double TcFinal = schedule.getInfectedTMax(); // recovered / deceased
+            double toGroupFraction = (populations_(nodeIndex, a, r, 0) + populations_(nodeIndex, a, r, 1))  / populationNodes_(nodeIndex);
 
-            // the first contact time...
-            double Tc = TcInit + random_exponential(transmissionRate, &rand_);
+            double contactRate = ageContactRates[ageGroup][a];
+            double transmissionRate = beta * contactRate * ageSusceptibilities[a] * toGroupFraction;
 
-            while(Tc < TcFinal)
-            {
-                schedule.insertEvent(StochasticSEATIRDEvent(TcInit, Tc, CONTACT, stratificationValues, toStratificationValues));
+            rates[a*numRiskGroups + r] = transmissionRate;
 
-                TcInit = Tc;
-                Tc = TcInit + random_exponential(transmissionRate, &rand_);
-            }
+            totalRate += transmissionRate;
         }
     }
+
+    return totalRate;
 }
 
-bool StochasticSEATIRD::processEvent(const int &nodeId, const StochasticSEATIRDEvent &event)
+bool StochasticSEATIRD::processEvent(const int &nodeIndex, const StochasticSEATIRDEvent &event)
 {
-    switch(event.type)
+    // this may run concurrently for different nodes, so it only uses the node's data and random number generator
+    RandomStream &rand = nodeRands_[nodeIndex];
+
+    // the current time is the event time
+    const double &now = event.time;
+
+    std::vector<int> fromStratificationValues = event.getFromStratificationValues();
+
+    switch(event.getType())
     {
         case EtoA:
             // exposed -> asymptomatic
-            transition(1, "exposed", "asymptomatic", nodeId, event.fromStratificationValues);
+            transition(1, exposedHandle_, asymptomaticHandle_, nodeIndex, fromStratificationValues);
             break;
 
         case AtoT:
             // asymptomatic -> treatable
-            transition(1, "asymptomatic", "treatable", nodeId, event.fromStratificationValues);
+            transition(1, asymptomaticHandle_, treatableHandle_, nodeIndex, fromStratificationValues);
             break;
         case AtoR:
             // asymptomatic -> recovered
-            transition(1, "asymptomatic", "recovered", nodeId, event.fromStratificationValues);
+            transition(1, asymptomaticHandle_, recoveredHandle_, nodeIndex, fromStratificationValues);
             break;
         case AtoD:
             // asymptomatic -> deceased
-            transition(1, "asymptomatic", "deceased", nodeId, event.fromStratificationValues);
+            transition(1, asymptomaticHandle_, deceasedHandle_, nodeIndex, fromStratificationValues);
             break;
 
         case TtoI:
             // treatable -> infectious
-            transition(1, "treatable", "infectious", nodeId, event.fromStratificationValues);
+            transition(1, treatableHandle_, infectiousHandle_, nodeIndex, fromStratificationValues);
             break;
         case TtoR:
             // treatable -> recovered
-            transition(1, "treatable", "recovered", nodeId, event.fromStratificationValues);
+            transition(1, treatableHandle_, recoveredHandle_, nodeIndex, fromStratificationValues);
             break;
         case TtoD:
             // treatable -> deceased
-            transition(1, "treatable", "deceased", nodeId, event.fromStratificationValues);
+            transition(1, treatableHandle_, deceasedHandle_, nodeIndex, fromStratificationValues);
             break;
 
         case ItoR:
             // infectious -> recovered
-            transition(1, "infectious", "recovered", nodeId, event.fromStratificationValues);
+            transition(1, infectiousHandle_, recoveredHandle_, nodeIndex, fromStratificationValues);
             break;
         case ItoD:
             // infectious -> deceased
-            transition(1, "infectious", "deceased", nodeId, event.fromStratificationValues);
+            transition(1, infectiousHandle_, deceasedHandle_, nodeIndex, fromStratificationValues);
             break;
 
         case CONTACT:
             // contact events only target (age group, risk group)
-            if(event.toStratificationValues.size() != 2)
+            // choose the target group in proportion to its contact rate
+            double rates[numAgeGroups * numRiskGroups];
+
+            double totalRate = getContactRates(nodeIndex, fromStratificationValues[0], rates);
+
+            double target = rand.randExc() * totalRate;
+
+            int toAgeRisk = 0;
+
+            while(toAgeRisk < numAgeGroups * numRiskGroups - 1 && target >= rates[toAgeRisk])
             {
-                put_flog(LOG_ERROR, "incorrect event.toStratificationValues; size == %i", event.toStratificationValues.size());
-                return false;
+                target -= rates[toAgeRisk];
+                toAgeRisk++;
             }
 
+            std::vector<int> toStratificationValues(2);
+            toStratificationValues[0] = toAgeRisk / numRiskGroups;
+            toStratificationValues[1] = toAgeRisk % numRiskGroups;
+
             // first, see if a Npi stops this contact from happening
-            bool npiEffective = Npi::isNpiEffective(g_parameters.getNpis(), nodeId, int(now_), event.fromStratificationValues[0], event.toStratificationValues[0]);
+            // the table is for time_, which is int(now) for all events of this time step
+            bool npiEffective = npiEffectivenessTable_.isNpiEffective(nodeIndex, fromStratificationValues[0], toStratificationValues[0], rand);
 
             if(npiEffective == true)
             {
                 // the Npis are effective
+                nodeCounts_[nodeIndex * NUM_NODE_COUNTERS + NODE_COUNTER_NPI_BLOCKED_CONTACTS]++;
                 break;
             }
 
             // determine now if the target individual is vaccinated or not
-            int ageRiskPopulationSize = int(populations_(nodeIdToIndex_[nodeId], event.toStratificationValues[0], event.toStratificationValues[1], 0) + populations_(nodeIdToIndex_[nodeId], event.toStratificationValues[0], event.toStratificationValues[1], 1));
+            int ageRiskPopulationSize = int(populations_(nodeIndex, toStratificationValues[0], toStratificationValues[1], 0) + populations_(nodeIndex, toStratificationValues[0], toStratificationValues[1], 1));
 
             // vaccinated stratification == 1
-            int ageRiskVaccinatedPopulationSize = int(populations_(nodeIdToIndex_[nodeId], event.toStratificationValues[0], event.toStratificationValues[1], 1));
+            int ageRiskVaccinatedPopulationSize = int(populations_(nodeIndex, toStratificationValues[0], toStratificationValues[1], 1));
 
             // random integer between 1 and ageRiskPopulationSize
-            int contact = rand_.randInt(ageRiskPopulationSize - 1) + 1;
+            int contact = rand.randInt(ageRiskPopulationSize - 1) + 1;
 
             // the vaccinated stratification value
             int v = 0;
@@ -409,7 +1029,7 @@ bool StochasticSEATIRD::processEvent(const int &nodeId, const StochasticSEATIRDE
                 // only continue if the vaccine is not effective
 
                 // if the individual is still in the vaccine latency period, the vaccine is not effective
-                int ageRiskVaccinatedLatencyPopulationSize = getPopulationInVaccineLatencyPeriod(nodeId, event.toStratificationValues[0], event.toStratificationValues[1]);
+                int ageRiskVaccinatedLatencyPopulationSize = getPopulationInVaccineLatencyPeriod(nodeIndex, toStratificationValues[0], toStratificationValues[1]);
 
                 if(ageRiskVaccinatedLatencyPopulationSize < contact)
                 {
@@ -419,7 +1039,7 @@ bool StochasticSEATIRD::processEvent(const int &nodeId, const StochasticSEATIRDE
                     // todo: should be age-specific
                     double vaccineEffectiveness = g_parameters.getVaccineEffectiveness();
 
-                    if(rand_.rand() <= vaccineEffectiveness)
+                    if(rand.rand() <= vaccineEffectiveness)
                     {
                         // the vaccine is effective
                         break;
@@ -428,12 +1048,12 @@ bool StochasticSEATIRD::processEvent(const int &nodeId, const StochasticSEATIRDE
             }
 
             // form the complete toStratificationValues
-            std::vector<int> completeToStratificationValues = event.toStratificationValues;
+            std::vector<int> completeToStratificationValues(toStratificationValues);
             completeToStratificationValues.push_back(v);
 
-            int targetPopulationSize = int(populations_(nodeIdToIndex_[nodeId], completeToStratificationValues[0], completeToStratificationValues[1], completeToStratificationValues[2]));
+            int targetPopulationSize = int(populations_(nodeIndex, completeToStratificationValues[0], completeToStratificationValues[1], completeToStratificationValues[2]));
 
-            if(event.fromStratificationValues == completeToStratificationValues)
+            if(fromStratificationValues == completeToStratificationValues)
             {
                 targetPopulationSize -= 1; // - 1 because randint includes both endpoints
             }
@@ -441,11 +1061,11 @@ bool StochasticSEATIRD::processEvent(const int &nodeId, const StochasticSEATIRDE
             if(targetPopulationSize > 0)
             {
                 // random integer between 1 and targetPopulationSize
-                contact = rand_.randInt(targetPopulationSize - 1) + 1;
+                contact = rand.randInt(targetPopulationSize - 1) + 1;
 
-                if((int)getValue("susceptible", time_+1, nodeId, completeToStratificationValues) >= contact)
+                if((int)getVariable(susceptibleHandle_)(time_+1, nodeIndex, BOOST_PP_ENUM(NUM_STRATIFICATION_DIMENSIONS, VECTOR_TO_ARGS, completeToStratificationValues)) >= contact)
                 {
-                    expose(1, nodeId, completeToStratificationValues);
+                    exposeAtNode(1, nodeIndex, completeToStratificationValues, now, rand);
                 }
             }
 
@@ -455,544 +1075,412 @@ bool StochasticSEATIRD::processEvent(const int &nodeId, const StochasticSEATIRDE
     return true;
 }
 
-void StochasticSEATIRD::applyAntiviralsToPriorityGroupSelections(boost::shared_ptr<PriorityGroupSelections> priorityGroupSelections)
+void StochasticSEATIRD::applyAntiviralsToNode(int nodeIndex, const std::vector<std::vector<int> > &stratificationValuesSet, float totalAdherentTreatable, int stockpileAmountUsed)
 {
-    if(priorityGroupSelections == NULL || priorityGroupSelections->getPriorityGroups().size() == 0)
-    {
-        put_flog(LOG_DEBUG, "no priority groups in selection");
-        return;
-    }
-
     double antiviralEffectiveness = g_parameters.getAntiviralEffectiveness();
     double antiviralAdherence = g_parameters.getAntiviralAdherence();
-    double antiviralCapacity = g_parameters.getAntiviralCapacity();
-
-    // treatments for each node
-    std::vector<int> nodeIds = getNodeIds();
 
-    for(unsigned int i=0; i<nodeIds.size(); i++)
-    {
-        boost::shared_ptr<Stockpile> stockpile = getStockpileNetwork()->getNodeStockpile(nodeIds[i]);
+    // apply antivirals pro-rata across all stratifications
 
-        // do nothing if no stockpile is found
-        if(stockpile == NULL)
-        {
-            continue;
-        }
+    blitz::Array<float, NUM_STRATIFICATION_DIMENSIONS> adherentTreatable(numAgeGroups, numRiskGroups, numVaccinatedGroups);
+    blitz::Array<int, NUM_STRATIFICATION_DIMENSIONS> numberTreated(numAgeGroups, numRiskGroups, numVaccinatedGroups);
+    blitz::Array<int, NUM_STRATIFICATION_DIMENSIONS> numberEffectivelyTreated(numAgeGroups, numRiskGroups, numVaccinatedGroups);
 
-        // available antivirals stockpile
-        int stockpileAmount = stockpile->getNum(time_+1, STOCKPILE_ANTIVIRALS);
+    // initialize to zero, since we might not be seeing all possible stratifications
+    adherentTreatable = 0.;
+    numberTreated = 0;
+    numberEffectivelyTreated = 0;
 
-        // do nothing if we have no available stockpile
-        if(stockpileAmount == 0)
-        {
-            continue;
-        }
+    // iterate through all stratifications in priority group selections
+    for(unsigned int s=0; s<stratificationValuesSet.size(); s++)
+    {
+        int a = stratificationValuesSet[s][0];
+        int r = stratificationValuesSet[s][1];
+        int v = stratificationValuesSet[s][2];
 
-        // the total populations below correspond to the priority group selections
+        std::vector<int> stratificationValues;
+        stratificationValues.push_back(a);
+        stratificationValues.push_back(r);
+        stratificationValues.push_back(v);
 
-        // determine total number of adherent treatable
-        float totalTreatable = getValue("treatable", time_+1, nodeIds[i], priorityGroupSelections->getStratificationValuesSet()) - getValue("treated (ineffective daily)", time_+1, nodeIds[i], priorityGroupSelections->getStratificationValuesSet());
+        // determine number of adherent treatable
+        float treatable = getNodeValue(treatableHandle_, nodeIndex, stratificationValues) - getNodeValue(treatedIneffectiveDailyHandle_, nodeIndex, stratificationValues);
 
         // do nothing if this population is zero
-        if(totalTreatable <= 0.)
+        if(treatable <= 0.)
         {
+            adherentTreatable(a, r, v) = 0.;
+            numberTreated(a, r, v) = 0;
+            numberEffectivelyTreated(a, r, v) = 0;
+
             continue;
         }
 
         // since we fix the treatable period to one day, we can simplify our adherence calculations...
-        float totalAdherentTreatable = antiviralAdherence * totalTreatable;
-
-        // we will use all of our available stockpile (subject to capacity constraint) to treat the adherent treatable population
-        int stockpileAmountUsed = stockpileAmount;
-
-        if(stockpileAmountUsed > (int)totalAdherentTreatable)
-        {
-            stockpileAmountUsed = (int)totalAdherentTreatable;
-        }
-
-        // capacity corresponds to total population, not just for these priority group selections
-        float capacityTotalPopulation = getValue("population", time_+1, nodeIds[i]);
+        adherentTreatable(a, r, v) = antiviralAdherence * treatable;
 
-        // consider capacity used in previous treatments on this day
-        float todayUsedCapacity = blitz::sum(variables_["treated (daily)"](time_+1, nodeIdToIndex_[nodeIds[i]], blitz::Range::all(), blitz::Range::all(), blitz::Range::all()));
+        // pro-rata by adherent treatable population
+        numberTreated(a, r, v) = int(adherentTreatable(a, r, v) / totalAdherentTreatable * (float)stockpileAmountUsed);
 
-        if(stockpileAmountUsed > (int)(antiviralCapacity * capacityTotalPopulation - todayUsedCapacity))
-        {
-            stockpileAmountUsed = (int)(antiviralCapacity * capacityTotalPopulation - todayUsedCapacity);
-        }
+        // considering effectiveness
+        numberEffectivelyTreated(a, r, v) = int(antiviralEffectiveness * float(numberTreated(a, r, v)));
 
-        // do nothing if no stockpile is used
-        if(stockpileAmountUsed <= 0)
+        if(numberTreated(a, r, v) <= 0)
         {
             continue;
         }
 
-        // decrement antivirals stockpile
-        stockpile->setNum(time_+1, stockpileAmount - stockpileAmountUsed, STOCKPILE_ANTIVIRALS);
-
-        // apply antivirals pro-rata across all stratifications
-
-        blitz::Array<float, NUM_STRATIFICATION_DIMENSIONS> adherentTreatable(StochasticSEATIRD::numAgeGroups_, StochasticSEATIRD::numRiskGroups_, StochasticSEATIRD::numVaccinatedGroups_);
-        blitz::Array<int, NUM_STRATIFICATION_DIMENSIONS> numberTreated(StochasticSEATIRD::numAgeGroups_, StochasticSEATIRD::numRiskGroups_, StochasticSEATIRD::numVaccinatedGroups_);
-        blitz::Array<int, NUM_STRATIFICATION_DIMENSIONS> numberEffectivelyTreated(StochasticSEATIRD::numAgeGroups_, StochasticSEATIRD::numRiskGroups_, StochasticSEATIRD::numVaccinatedGroups_);
-
-        // we also need the number treatable for probabilistically choosing who got the treatment
-        blitz::Array<float, NUM_STRATIFICATION_DIMENSIONS> numberTreatable(StochasticSEATIRD::numAgeGroups_, StochasticSEATIRD::numRiskGroups_, StochasticSEATIRD::numVaccinatedGroups_);
-
-        // initialize to zero, since we might not be seeing all possible stratifications
-        adherentTreatable = 0.;
-        numberTreated = 0;
-        numberEffectivelyTreated = 0;
-        numberTreatable = 0.;
-
-        // iterate through all stratifications in priority group selections
-        std::vector<std::vector<int> > stratificationValuesSet = priorityGroupSelections->getStratificationValuesSet();
-
-        for(unsigned int s=0; s<stratificationValuesSet.size(); s++)
-        {
-            int a = stratificationValuesSet[s][0];
-            int r = stratificationValuesSet[s][1];
-            int v = stratificationValuesSet[s][2];
-
-            std::vector<int> stratificationValues;
-            stratificationValues.push_back(a);
-            stratificationValues.push_back(r);
-            stratificationValues.push_back(v);
-
-            // determine number of adherent treatable
-            float treatable = getValue("treatable", time_+1, nodeIds[i], stratificationValues) - getValue("treated (ineffective daily)", time_+1, nodeIds[i], stratificationValues);
-
-            // do nothing if this population is zero
-            if(treatable <= 0.)
-            {
-                adherentTreatable(a, r, v) = 0.;
-                numberTreated(a, r, v) = 0;
-                numberEffectivelyTreated(a, r, v) = 0;
-                numberTreatable(a, r, v) = 0.;
-
-                continue;
-            }
-
-            // since we fix the treatable period to one day, we can simplify our adherence calculations...
-            adherentTreatable(a, r, v) = antiviralAdherence * treatable;
-
-            // pro-rata by adherent treatable population
-            numberTreated(a, r, v) = int(adherentTreatable(a, r, v) / totalAdherentTreatable * (float)stockpileAmountUsed);
-
-            // considering effectiveness
-            numberEffectivelyTreated(a, r, v) = int(antiviralEffectiveness * float(numberTreated(a, r, v)));
-
-            // for probabilistically choosing who got the treatment
-            numberTreatable(a, r, v) = treatable;
-
-            if(numberTreated(a, r, v) <= 0)
-            {
-                continue;
-            }
-
-            // put_flog(LOG_DEBUG, "adherentTreatable = %f, numberTreated = %i, numberEffectivelyTreated = %i", adherentTreatable(a, r, v), numberTreated(a, r, v), numberEffectivelyTreated(a, r, v));
-
-            // transition those effectively treated from "treatable" to "recovered"
-            transition(numberEffectivelyTreated(a, r, v), "treatable", "recovered", nodeIds[i], stratificationValues);
-
-            // need to keep track of number treated each day
-            variables_["treated (daily)"](time_+1, nodeIdToIndex_[nodeIds[i]], a, r, v) += numberTreated(a, r, v);
-
-            // need to keep track of number ineffectively treated each day
-            variables_["treated (ineffective daily)"](time_+1, nodeIdToIndex_[nodeIds[i]], a, r, v) += (numberTreated(a, r, v) - numberEffectivelyTreated(a, r, v));
-
-            // need to keep track of those treated (regardless of effectiveness)
-            variables_["treated"](time_+1, nodeIdToIndex_[nodeIds[i]], a, r, v) += numberTreated(a, r, v);
-        }
-
-        // the sum over numberTreated should equal stockpileAmountUsed
-        // this can differ due to integer division issues with pro rata distributions
-        if(blitz::sum(numberTreated) != stockpileAmountUsed)
-        {
-            put_flog(LOG_WARN, "numberTreated != stockpileAmountUsed (%i != %i)", blitz::sum(numberTreated), stockpileAmountUsed);
-        }
-
-        // now, adjust schedules for individuals that were effectively treated
-        // this will stop their transitions to other states and also their contact events
-        boost::heap::pairing_heap<StochasticSEATIRDSchedule, boost::heap::compare<StochasticSEATIRDSchedule::compareByNextEventTime> >::iterator begin = scheduleEventQueues_[nodeIds[i]].begin();
-        boost::heap::pairing_heap<StochasticSEATIRDSchedule, boost::heap::compare<StochasticSEATIRDSchedule::compareByNextEventTime> >::iterator end = scheduleEventQueues_[nodeIds[i]].end();
+        // put_flog(LOG_DEBUG, "adherentTreatable = %f, numberTreated = %i, numberEffectivelyTreated = %i", adherentTreatable(a, r, v), numberTreated(a, r, v), numberEffectivelyTreated(a, r, v));
 
-        boost::heap::pairing_heap<StochasticSEATIRDSchedule, boost::heap::compare<StochasticSEATIRDSchedule::compareByNextEventTime> >::iterator it;
+        // transition those effectively treated from "treatable" to "recovered"
+        transition(numberEffectivelyTreated(a, r, v), treatableHandle_, recoveredHandle_, nodeIndex, stratificationValues);
 
-        for(it=begin; it!=end && blitz::sum(numberEffectivelyTreated) > 0; it++)
-        {
-            if((*it).getState() == T)
-            {
-                std::vector<int> stratificationValues = (*it).getStratificationValues();
-
-                if(numberEffectivelyTreated(BOOST_PP_ENUM(NUM_STRATIFICATION_DIMENSIONS, VECTOR_TO_ARGS, stratificationValues)) > 0)
-                {
-                    if((*it).canceled() != true && rand_.rand() <= float(numberEffectivelyTreated(BOOST_PP_ENUM(NUM_STRATIFICATION_DIMENSIONS, VECTOR_TO_ARGS, stratificationValues))) / numberTreatable(BOOST_PP_ENUM(NUM_STRATIFICATION_DIMENSIONS, VECTOR_TO_ARGS, stratificationValues)))
-                    {
-                        // cancel the remaining schedule
-                        (*boost::heap::pairing_heap<StochasticSEATIRDSchedule, boost::heap::compare<StochasticSEATIRDSchedule::compareByNextEventTime> >::s_handle_from_iterator(it)).cancel();
-
-                        numberEffectivelyTreated(BOOST_PP_ENUM(NUM_STRATIFICATION_DIMENSIONS, VECTOR_TO_ARGS, stratificationValues))--;
-                    }
+        // need to keep track of number treated each day
+        getVariable(treatedDailyHandle_).add(time_+1, nodeIndex, a, r, v, numberTreated(a, r, v));
 
-                    numberTreatable(BOOST_PP_ENUM(NUM_STRATIFICATION_DIMENSIONS, VECTOR_TO_ARGS, stratificationValues))--;
-                }
-            }
-        }
+        // need to keep track of number ineffectively treated each day
+        getVariable(treatedIneffectiveDailyHandle_).add(time_+1, nodeIndex, a, r, v, numberTreated(a, r, v) - numberEffectivelyTreated(a, r, v));
 
-        // the sum over numberEffectivelyTreated should now be zero if all events were unqueued
-        if(blitz::sum(numberEffectivelyTreated) != 0)
-        {
-            put_flog(LOG_WARN, "numberEffectivelyTreated != 0 (%i)", blitz::sum(numberEffectivelyTreated));
-        }
+        // need to keep track of those treated (regardless of effectiveness)
+        getVariable(treatedHandle_).add(time_+1, nodeIndex, a, r, v, numberTreated(a, r, v));
     }
-}
 
-void StochasticSEATIRD::applyVaccinesToPriorityGroupSelections(boost::shared_ptr<PriorityGroupSelections> priorityGroupSelections)
-{
-    // TODO: need to consider deceased in adherent individual totals! they reduce the adherent unvaccinated population
+    // the sum over numberTreated should equal stockpileAmountUsed
+    // this can differ due to integer division issues with pro rata distributions
+    if(blitz::sum(numberTreated) != stockpileAmountUsed)
+    {
+        put_flog(LOG_WARN, "numberTreated != stockpileAmountUsed (%i != %i)", blitz::sum(numberTreated), stockpileAmountUsed);
+    }
 
-    if(priorityGroupSelections == NULL || priorityGroupSelections->getPriorityGroups().size() == 0)
+    // tau-leaped nodes have no schedules to adjust
+    if(nodeTauLeaping_[nodeIndex] != 0)
     {
-        put_flog(LOG_DEBUG, "no priority groups in selection");
         return;
     }
 
-    double vaccineAdherence = g_parameters.getVaccineAdherence();
-    double vaccineCapacity = g_parameters.getVaccineCapacity();
-
-    // treatments for each node
-    std::vector<int> nodeIds = getNodeIds();
+    // now, adjust schedules for individuals that were effectively treated
+    // this will stop their transitions to other states and also their contact events
+    // the treated are chosen at random from the treatable schedules of each stratification
+    StochasticSEATIRDScheduleQueue &queue = scheduleEventQueues_[nodeIndex];
 
-    for(unsigned int i=0; i<nodeIds.size(); i++)
+    for(unsigned int s=0; s<stratificationValuesSet.size(); s++)
     {
-        boost::shared_ptr<Stockpile> stockpile = getStockpileNetwork()->getNodeStockpile(nodeIds[i]);
-
-        // do nothing if no stockpile is found
-        if(stockpile == NULL)
-        {
-            continue;
-        }
-
-        // available vaccines stockpile
-        int stockpileAmount = stockpile->getNum(time_+1, STOCKPILE_VACCINES);
-
-        // do nothing if we have no available stockpile
-        if(stockpileAmount == 0)
-        {
-            continue;
-        }
-
-        // the total populations below correspond to the priority group selections
+        const std::vector<int> &stratificationValues = stratificationValuesSet[s];
 
-        // determine total number of adherent unvaccinated
-        float totalPopulation = getValue("population", time_+1, nodeIds[i], priorityGroupSelections->getStratificationValuesSet2(STRATIFICATIONS_ALL));
-        float totalVaccinatedPopulation = getValue("population", time_+1, nodeIds[i], priorityGroupSelections->getStratificationValuesSet2(1)); // vaccinated == 1
-        float totalUnvaccinatedPopulation = getValue("population", time_+1, nodeIds[i], priorityGroupSelections->getStratificationValuesSet2(0)); // unvaccinated == 0
+        int &number = numberEffectivelyTreated(BOOST_PP_ENUM(NUM_STRATIFICATION_DIMENSIONS, VECTOR_TO_ARGS, stratificationValues));
 
-        // do nothing if this population is zero
-        if(totalUnvaccinatedPopulation <= 0.)
+        if(number <= 0)
         {
             continue;
         }
 
-        float totalAdherentUnvaccinated = (vaccineAdherence * totalPopulation - totalVaccinatedPopulation);
-
-        // we will use all of our available stockpile (subject to capacity constraint) to treat the adherent unvaccinated population
-        // note that we're treating all compartments, not just susceptible
-        int stockpileAmountUsed = stockpileAmount;
+        std::vector<int> indices = queue.selectRegistered(T, stratificationValues, number, antiviralsRand_);
 
-        if(stockpileAmountUsed > (int)totalAdherentUnvaccinated)
+        for(unsigned int j=0; j<indices.size(); j++)
         {
-            stockpileAmountUsed = (int)totalAdherentUnvaccinated;
+            // cancel the remaining schedule
+            queue.cancel(indices[j]);
         }
 
-        // capacity corresponds to total population, not just for these priority group selections
-        float capacityTotalPopulation = getValue("population", time_+1, nodeIds[i]);
-
-        // consider capacity used in previous treatments on this day
-        float todayUsedCapacity = blitz::sum(variables_["vaccinated (daily)"](time_+1, nodeIdToIndex_[nodeIds[i]], blitz::Range::all(), blitz::Range::all(), 1));
+        number -= (int)indices.size();
+    }
 
-        if(stockpileAmountUsed > (int)(vaccineCapacity * capacityTotalPopulation - todayUsedCapacity))
-        {
-            stockpileAmountUsed = (int)(vaccineCapacity * capacityTotalPopulation - todayUsedCapacity);
-        }
+    // the sum over numberEffectivelyTreated should now be zero if all events were unqueued
+    if(blitz::sum(numberEffectivelyTreated) != 0)
+    {
+        put_flog(LOG_WARN, "numberEffectivelyTreated != 0 (%i)", blitz::sum(numberEffectivelyTreated));
+    }
+}
 
-        // do nothing if no stockpile is used
-        if(stockpileAmountUsed <= 0)
-        {
-            continue;
-        }
+void StochasticSEATIRD::applyVaccinesToNode(int nodeIndex, const std::vector<std::vector<int> > &stratificationValuesSet2, float totalAdherentUnvaccinated, int stockpileAmountUsed)
+{
+    double vaccineAdherence = g_parameters.getVaccineAdherence();
 
-        // decrement vaccines stockpile
-        stockpile->setNum(time_+1, stockpileAmount - stockpileAmountUsed, STOCKPILE_VACCINES);
+    // apply vaccines pro-rata across all compartments and stratifications
 
-        // apply vaccines pro-rata across all compartments and stratifications
+    // these are the compartments we'll apply to
+    // don't apply to deceased...
+    // this MUST align with stateToCompartmentIndex below
+    const int numCompartments = 6;
+    EpidemicVariableHandle compartmentHandles[numCompartments] = { susceptibleHandle_, exposedHandle_, asymptomaticHandle_, treatableHandle_, infectiousHandle_, recoveredHandle_ };
 
-        // these are the compartments we'll apply to
-        // don't apply to deceased...
-        // this MUST align with stateToCompartmentIndex below
-        std::vector<std::string> compartments;
-        compartments.push_back("susceptible");
-        compartments.push_back("exposed");
-        compartments.push_back("asymptomatic");
-        compartments.push_back("treatable");
-        compartments.push_back("infectious");
-        compartments.push_back("recovered");
+    // number vaccinated for (compartment, age group, risk group)
+    blitz::Array<int, 1 + NUM_STRATIFICATION_DIMENSIONS-1> numberVaccinated(numCompartments, numAgeGroups, numRiskGroups);
 
-        // number vaccinated for (compartment, age group, risk group)
-        blitz::Array<int, 1 + NUM_STRATIFICATION_DIMENSIONS-1> numberVaccinated(compartments.size(), StochasticSEATIRD::numAgeGroups_, StochasticSEATIRD::numRiskGroups_);
+    // initialize to zero, since we might not be seeing all possible stratifications
+    numberVaccinated = 0;
 
-        // number vaccinatable for (compartment, age group, risk group)
-        // for probabilistically choosing which event schedules to change stratifications
-        blitz::Array<int, 1 + NUM_STRATIFICATION_DIMENSIONS-1> numberVaccinatable(compartments.size(), StochasticSEATIRD::numAgeGroups_, StochasticSEATIRD::numRiskGroups_);
+    // iterate through all stratifications in priority group selections (only for age group, risk group)
+    for(int c=0; c<numCompartments; c++)
+    {
+        blitz::Array<float, NUM_STRATIFICATION_DIMENSIONS-1> adherentCompartmentUnvaccinated(numAgeGroups, numRiskGroups);
 
-        // initialize to zero, since we might not be seeing all possible stratifications
-        numberVaccinated = 0;
-        numberVaccinatable = 0;
+        adherentCompartmentUnvaccinated = 0.;
 
-        for(unsigned int c=0; c<compartments.size(); c++)
+        for(unsigned int s=0; s<stratificationValuesSet2.size(); s++)
         {
-            blitz::Array<float, NUM_STRATIFICATION_DIMENSIONS-1> adherentCompartmentUnvaccinated(StochasticSEATIRD::numAgeGroups_, StochasticSEATIRD::numRiskGroups_);
-
-            adherentCompartmentUnvaccinated = 0.;
+            int a = stratificationValuesSet2[s][0];
+            int r = stratificationValuesSet2[s][1];
 
-            // iterate through all stratifications in priority group selections (only for age group, risk group)
-            std::vector<std::vector<int> > stratificationValuesSet2 = priorityGroupSelections->getStratificationValuesSet2(STRATIFICATIONS_ALL);
+            std::vector<int> stratificationValues(3, STRATIFICATIONS_ALL);
+            stratificationValues[0] = a;
+            stratificationValues[1] = r;
 
-            for(unsigned int s=0; s<stratificationValuesSet2.size(); s++)
-            {
-                int a = stratificationValuesSet2[s][0];
-                int r = stratificationValuesSet2[s][1];
-
-                std::vector<int> stratificationValues(3, STRATIFICATIONS_ALL);
-                stratificationValues[0] = a;
-                stratificationValues[1] = r;
+            // determine number of adherent compartment unvaccinated
+            stratificationValues[2] = STRATIFICATIONS_ALL;
+            float population = getNodeValue(populationHandle_, nodeIndex, stratificationValues);
 
-                // determine number of adherent compartment unvaccinated
-                stratificationValues[2] = STRATIFICATIONS_ALL;
-                float population = getValue("population", time_+1, nodeIds[i], stratificationValues);
+            stratificationValues[2] = 1; // vaccinated
+            float vaccinatedPopulation = getNodeValue(populationHandle_, nodeIndex, stratificationValues);
 
-                stratificationValues[2] = 1; // vaccinated
-                float vaccinatedPopulation = getValue("population", time_+1, nodeIds[i], stratificationValues);
+            stratificationValues[2] = 0; // unvaccinated
+            float unvaccinatedPopulation = getNodeValue(populationHandle_, nodeIndex, stratificationValues);
+            float compartmentUnvaccinated = getNodeValue(compartmentHandles[c], nodeIndex, stratificationValues);
 
-                stratificationValues[2] = 0; // unvaccinated
-                float unvaccinatedPopulation = getValue("population", time_+1, nodeIds[i], stratificationValues);
-                float compartmentUnvaccinated = getValue(compartments[c], time_+1, nodeIds[i], stratificationValues);
-
-                // for probabilistically choosing which event schedules to change stratifications
-                numberVaccinatable((int)c, a, r) = int(compartmentUnvaccinated);
+            // do nothing if this population is zero
+            if(unvaccinatedPopulation <= 0.)
+            {
+                adherentCompartmentUnvaccinated(a, r) = 0.;
+                numberVaccinated((int)c, a, r) = 0;
 
-                // do nothing if this population is zero
-                if(unvaccinatedPopulation <= 0.)
-                {
-                    adherentCompartmentUnvaccinated(a, r) = 0.;
-                    numberVaccinated((int)c, a, r) = 0;
+                continue;
+            }
 
-                    continue;
-                }
+            // == (adherent unvaccinated population) * (fraction of unvaccinated population that is in compartment)
+            adherentCompartmentUnvaccinated(a, r) = (vaccineAdherence * population - vaccinatedPopulation) * compartmentUnvaccinated / unvaccinatedPopulation;
 
-                // == (adherent unvaccinated population) * (fraction of unvaccinated population that is in compartment)
-                adherentCompartmentUnvaccinated(a, r) = (vaccineAdherence * population - vaccinatedPopulation) * compartmentUnvaccinated / unvaccinatedPopulation;
+            // pro-rata by adherent compartment unvaccinated population
+            numberVaccinated((int)c, a, r) = int(adherentCompartmentUnvaccinated(a, r) / totalAdherentUnvaccinated * (float)stockpileAmountUsed);
 
-                // pro-rata by adherent compartment unvaccinated population
-                numberVaccinated((int)c, a, r) = int(adherentCompartmentUnvaccinated(a, r) / totalAdherentUnvaccinated * (float)stockpileAmountUsed);
+            if(numberVaccinated((int)c, a, r) <= 0)
+            {
+                continue;
+            }
 
-                if(numberVaccinated((int)c, a, r) <= 0)
-                {
-                    continue;
-                }
+            // put_flog(LOG_DEBUG, "adherentCompartmentUnvaccinated = %f, numberVaccinated = %i", adherentCompartmentUnvaccinated(a, r), numberVaccinated((int)c, a, r));
 
-                // put_flog(LOG_DEBUG, "adherentCompartmentUnvaccinated = %f, numberVaccinated = %i", adherentCompartmentUnvaccinated(a, r), numberVaccinated((int)c, a, r));
+            // move individuals from compartment unvaccinated to compartment vaccinated
+            getVariable(compartmentHandles[c]).add(time_+1, nodeIndex, a, r, 0, -numberVaccinated((int)c, a, r));
+            getVariable(compartmentHandles[c]).add(time_+1, nodeIndex, a, r, 1, numberVaccinated((int)c, a, r));
 
-                // move individuals from compartment unvaccinated to compartment vaccinated
-                variables_[compartments[c]](time_+1, nodeIdToIndex_[nodeIds[i]], a, r, 0) -= numberVaccinated((int)c, a, r);
-                variables_[compartments[c]](time_+1, nodeIdToIndex_[nodeIds[i]], a, r, 1) += numberVaccinated((int)c, a, r);
+            // need to also manipulate the total population variable: individuals are changing stratifications as well as state
+            getVariable(populationHandle_).add(time_+1, nodeIndex, a, r, 0, -numberVaccinated((int)c, a, r));
+            getVariable(populationHandle_).add(time_+1, nodeIndex, a, r, 1, numberVaccinated((int)c, a, r));
 
-                // need to also manipulate the total population variable: individuals are changing stratifications as well as state
-                variables_["population"](time_+1, nodeIdToIndex_[nodeIds[i]], a, r, 0) -= numberVaccinated((int)c, a, r);
-                variables_["population"](time_+1, nodeIdToIndex_[nodeIds[i]], a, r, 1) += numberVaccinated((int)c, a, r);
+            // need to keep track of number vaccinated each day
+            getVariable(vaccinatedDailyHandle_).add(time_+1, nodeIndex, a, r, 1, numberVaccinated((int)c, a, r));
 
-                // need to keep track of number vaccinated each day
-                variables_["vaccinated (daily)"](time_+1, nodeIdToIndex_[nodeIds[i]], a, r, 1) += numberVaccinated((int)c, a, r);
+            // and of the number in the latency period, which includes today for a nonzero latency period
+            if(vaccineLatencyPeriod_ > 0)
+            {
+                getVariable(vaccinatedInLatencyPeriodHandle_).add(time_+1, nodeIndex, a, r, 1, numberVaccinated((int)c, a, r));
             }
         }
+    }
 
-        // the sum over numberVaccinated should equal stockpileAmountUsed
-        // this can differ due to integer division issues with pro rata distributions
-        if(blitz::sum(numberVaccinated) != stockpileAmountUsed)
-        {
-            put_flog(LOG_WARN, "numberVaccinated != stockpileAmountUsed (%i != %i)", blitz::sum(numberVaccinated), stockpileAmountUsed);
-        }
+    // the sum over numberVaccinated should equal stockpileAmountUsed
+    // this can differ due to integer division issues with pro rata distributions
+    if(blitz::sum(numberVaccinated) != stockpileAmountUsed)
+    {
+        put_flog(LOG_WARN, "numberVaccinated != stockpileAmountUsed (%i != %i)", blitz::sum(numberVaccinated), stockpileAmountUsed);
+    }
 
-        // no need to adjust schedules since susceptible individuals are not scheduled yet, and vaccination has no effect on exposed+ individuals
-        // however, we are changing individuals to the vaccinated stratification, so we need to modify schedules' fromStratificationValues!
+    // no need to adjust schedules since susceptible individuals are not scheduled yet, and vaccination has no effect on exposed+ individuals
+    // however, we are changing individuals to the vaccinated stratification, so we need to modify schedules' fromStratificationValues!
 
-        // we only need to do this for event types originating with one of the vaccinated compartments
-        // these are "exposed", "asymptomatic", "treatable", "infectious", "recovered"
-        // this MUST align with compartments above
-        // in reality only E, A, T, I will be used
-        std::map<StochasticSEATIRDScheduleState, int> stateToCompartmentIndex;
-        stateToCompartmentIndex[E] = 1;
-        stateToCompartmentIndex[A] = 2;
-        stateToCompartmentIndex[T] = 3;
-        stateToCompartmentIndex[I] = 4;
-        stateToCompartmentIndex[R] = 5;
+    // we only need to do this for event types originating with one of the vaccinated compartments
+    // these are "exposed", "asymptomatic", "treatable", "infectious", "recovered"
+    // this MUST align with compartments above
+    // in reality only E, A, T, I will be used
+    std::map<StochasticSEATIRDScheduleState, int> stateToCompartmentIndex;
+    stateToCompartmentIndex[E] = 1;
+    stateToCompartmentIndex[A] = 2;
+    stateToCompartmentIndex[T] = 3;
+    stateToCompartmentIndex[I] = 4;
+    stateToCompartmentIndex[R] = 5;
 
-        boost::heap::pairing_heap<StochasticSEATIRDSchedule, boost::heap::compare<StochasticSEATIRDSchedule::compareByNextEventTime> >::iterator begin = scheduleEventQueues_[nodeIds[i]].begin();
-        boost::heap::pairing_heap<StochasticSEATIRDSchedule, boost::heap::compare<StochasticSEATIRDSchedule::compareByNextEventTime> >::iterator end = scheduleEventQueues_[nodeIds[i]].end();
+    // the vaccinated are chosen at random from the unvaccinated schedules of each (state, age group, risk group)
+    StochasticSEATIRDScheduleQueue &queue = scheduleEventQueues_[nodeIndex];
 
-        boost::heap::pairing_heap<StochasticSEATIRDSchedule, boost::heap::compare<StochasticSEATIRDSchedule::compareByNextEventTime> >::iterator it;
+    for(std::map<StochasticSEATIRDScheduleState, int>::iterator iter=stateToCompartmentIndex.begin(); iter!=stateToCompartmentIndex.end(); iter++)
+    {
+        int c = iter->second;
 
-        for(it=begin; it!=end && blitz::sum(numberVaccinated) > 0; it++)
+        for(unsigned int s=0; s<stratificationValuesSet2.size(); s++)
         {
-            StochasticSEATIRDScheduleState state = (*it).getState();
+            int a = stratificationValuesSet2[s][0];
+            int r = stratificationValuesSet2[s][1];
 
-            if(stateToCompartmentIndex.count(state) > 0)
+            if(numberVaccinated(c, a, r) <= 0)
             {
-                int c = stateToCompartmentIndex[state];
-
-                std::vector<int> stratificationValues = (*it).getStratificationValues();
-
-                // only consider unvaccinated for stratification change
-                // vaccinated stratification == 1
-                if(stratificationValues[2] == 1)
-                {
-                    continue;
-                }
+                continue;
+            }
 
-                if(numberVaccinated(c, stratificationValues[0], stratificationValues[1]) > 0)
-                {
-                    if((*it).canceled() != true && rand_.rand() <= float(numberVaccinated(c, stratificationValues[0], stratificationValues[1])) / float(numberVaccinatable(c, stratificationValues[0], stratificationValues[1])))
-                    {
-                        // change stratification to vaccinated
-                        // vaccinated stratification == 1
-                        stratificationValues[2] = 1;
+            // only consider unvaccinated for stratification change
+            std::vector<int> stratificationValues;
+            stratificationValues.push_back(a);
+            stratificationValues.push_back(r);
+            stratificationValues.push_back(0);
 
-                        (*boost::heap::pairing_heap<StochasticSEATIRDSchedule, boost::heap::compare<StochasticSEATIRDSchedule::compareByNextEventTime> >::s_handle_from_iterator(it)).changeStratificationValues(stratificationValues);
+            std::vector<int> indices = queue.selectRegistered(iter->first, stratificationValues, numberVaccinated(c, a, r), vaccinesRand_);
 
-                        numberVaccinated(c, stratificationValues[0], stratificationValues[1])--;
-                    }
+            // change stratification to vaccinated
+            // vaccinated stratification == 1
+            stratificationValues[2] = 1;
 
-                    numberVaccinatable(c, stratificationValues[0], stratificationValues[1])--;
-                }
+            for(unsigned int j=0; j<indices.size(); j++)
+            {
+                queue.changeStratificationValues(indices[j], stratificationValues);
             }
-        }
 
-        // the sum over numberVaccinated will not necessarily be zero now, since not all vaccinated individuals had schedules
+            numberVaccinated(c, a, r) -= (int)indices.size();
+        }
     }
+
+    // the sum over numberVaccinated will not necessarily be zero now, since not all vaccinated individuals had schedules
 }
 
-int StochasticSEATIRD::getPopulationInVaccineLatencyPeriod(int nodeId, int ageGroup, int riskGroup)
+int StochasticSEATIRD::getPopulationInVaccineLatencyPeriod(int nodeIndex, int ageGroup, int riskGroup)
 {
-    // should match the derived variable method above
-
-    int vaccineLatencyPeriod = g_parameters.getVaccineLatencyPeriod();
-
-    int total = 0;
-
     // people are vaccinated in the "morning", changing the daily count for time_+1
-    // therefore we start in that bin when we're counting vaccinations
-    // with these inequalities, a 0 day latency period will always return 0, as expected
-    for(int t=time_+1; t>=0 && t>(time_+1 - vaccineLatencyPeriod); t--)
-    {
-        // vaccinated stratification == 1
-        total += int(variables_["vaccinated (daily)"](t, nodeIdToIndex_[nodeId], ageGroup, riskGroup, 1));
-    }
+    // the rolling sum for time_+1 therefore includes today's vaccinations
 
-    return total;
+    // vaccinated stratification == 1
+    return int(getVariable(vaccinatedInLatencyPeriodHandle_)(time_+1, nodeIndex, ageGroup, riskGroup, 1));
 }
 
 void StochasticSEATIRD::travel()
 {
     // TODO: review where travel() is called time-wise, and which time indices it uses here!
 
-    // todo: these should be parameters defined elsewhere
-    double RHO = 0.39;
+    double vaccineEffectiveness = g_parameters.getVaccineEffectiveness();
 
-    double sigma[] = { 1.00, 0.98, 0.94, 0.91, 0.66 };
+    EpidemicVariable &asymptomaticVariable = getVariable(asymptomaticHandle_);
+    EpidemicVariable &treatableVariable = getVariable(treatableHandle_);
+    EpidemicVariable &infectiousVariable = getVariable(infectiousHandle_);
+    EpidemicVariable &susceptibleVariable = getVariable(susceptibleHandle_);
 
-    double contact[5][5] = {    { 45.1228487783,8.7808312353,11.7757947836,6.10114751268,4.02227175596 },
-                                { 8.7808312353,41.2889143668,13.3332813497,7.847051289,4.22656343551 },
-                                { 11.7757947836,13.3332813497,21.4270155984,13.7392636644,6.92483172729 },
-                                { 6.10114751268,7.847051289,13.7392636644,18.0482119252,9.45371062356 },
-                                { 4.02227175596,4.22656343551,6.92483172729,9.45371062356,14.0529294262 }   };
+    if(sparseTravel_ == NULL || sparseTravel_->getNumNodes() != numNodes_)
+    {
+        put_flog(LOG_ERROR, "no travel data");
+        return;
+    }
 
-    double vaccineEffectiveness = g_parameters.getVaccineEffectiveness();
+    // todo: beta should be age-specific considering PHA's
+    double beta = g_parameters.getR0() / g_parameters.getBetaScale();
 
-    for(unsigned int sinkNodeIndex=0; sinkNodeIndex < nodeIds_.size(); sinkNodeIndex++)
-    {
-        int sinkNodeId = nodeIds_[sinkNodeIndex];
+    // travel happens at the end of the time step
+    travelNpiEffectivenessTable_.update(g_parameters.getNpis(), g_parameters.getNpisVersion(), int(now_), nodeIdToIndex_, numNodes_, numAgeGroups);
 
-        double populationSink = populationNodes_(nodeIdToIndex_[sinkNodeId]);
+    // pre-compute per-node quantities once, so the loop over node pairs is only a few small vector operations
+    // all are stored node-major: [nodeIndex * numAgeGroups + age] and [(nodeIndex * numAgeGroups + a) * numAgeGroups + b]
 
-        std::vector<double> unvaccinatedProbabilities(StochasticSEATIRD::numAgeGroups_, 0.0);
+    // asymptomatics of each (source) node
+    std::vector<double> asymptomatics(numNodes_ * numAgeGroups, 0.);
 
-        std::vector<double> ageBasedFlowReductions (5, 1.0);
-        ageBasedFlowReductions[0] = 10; // 0-4  year olds
-        ageBasedFlowReductions[1] = 2;  // 5-24 year olds
-        ageBasedFlowReductions[4] = 2;  // 65+  year olds
+    // infectious contacts per unit of travel from each source node J into age group a of a sink node:
+    // sum_b (1 - npi_J(a,b)) * transmitting_J(b) * beta * RHO * contact(a,b) * sigma(a) / flowReduction(a) / population_J
+    std::vector<double> sourceContacts(numNodes_ * numAgeGroups, 0.);
 
-        for(unsigned int sourceNodeIndex=0; sourceNodeIndex < nodeIds_.size(); sourceNodeIndex++)
-        {
-            int sourceNodeId = nodeIds_[sourceNodeIndex];
+    // contact rates for age group a of each sink node I with asymptomatic travelers of age group b:
+    // (1 - npi_I(a,b)) * beta * RHO * contact(a,b) * sigma(a) / flowReduction(b) / population_I
+    std::vector<double> sinkContactRates(numNodes_ * numAgeGroups * numAgeGroups, 0.);
 
-            double populationSource = populationNodes_(nodeIdToIndex_[sourceNodeId]);
+    for(int nodeIndex=0; nodeIndex<numNodes_; nodeIndex++)
+    {
+        double transmittings[numAgeGroups];
 
-            // pre-compute some frequently needed quantities
-            std::vector<double> asymptomatics(StochasticSEATIRD::numAgeGroups_);
-            std::vector<double> transmittings(StochasticSEATIRD::numAgeGroups_);
+        for(int age=0; age<numAgeGroups; age++)
+        {
+            double asymptomatic = 0.;
+            double transmitting = 0.;
 
-            for(int age=0; age<StochasticSEATIRD::numAgeGroups_; age++)
+            for(int r=0; r<numRiskGroups; r++)
             {
-                asymptomatics[age] = getValue("asymptomatic", time_+1, sourceNodeId, std::vector<int>(1,age));
-                transmittings[age] = asymptomatics[age] + getValue("treatable", time_+1, sourceNodeId, std::vector<int>(1,age)) + getValue("infectious", time_+1, sourceNodeId, std::vector<int>(1,age));
+                for(int v=0; v<numVaccinatedGroups; v++)
+                {
+                    asymptomatic += asymptomaticVariable(time_+1, nodeIndex, age, r, v);
+                    transmitting += treatableVariable(time_+1, nodeIndex, age, r, v) + infectiousVariable(time_+1, nodeIndex, age, r, v);
+                }
             }
 
-            if(sinkNodeId != sourceNodeId)
+            asymptomatics[nodeIndex * numAgeGroups + age] = asymptomatic;
+            transmittings[age] = asymptomatic + transmitting;
+        }
+
+        double population = populationNodes_(nodeIndex);
+
+        // an unpopulated node has no contacts
+        if(population <= 0.)
+        {
+            continue;
+        }
+
+        for(int a=0; a<numAgeGroups; a++)
+        {
+            double contacts = 0.;
+
+            for(int b=0; b<numAgeGroups; b++)
             {
-                // flow data
-                float travelFractionIJ = getTravel(sinkNodeId, sourceNodeId);
-                float travelFractionJI = getTravel(sourceNodeId, sinkNodeId);
+                double npiEffectiveness = travelNpiEffectivenessTable_.getNpiEffectiveness(nodeIndex, a, b);
 
-                if(travelFractionIJ > 0. || travelFractionJI > 0.)
-                {
-                    for(int a=0; a<StochasticSEATIRD::numAgeGroups_; a++)
-                    {
-                        double numberOfInfectiousContactsIJ = 0.;
-                        double numberOfInfectiousContactsJI = 0.;
+                double rate = (1. - npiEffectiveness) * beta * travelContactFraction * ageContactRates[a][b] * ageSusceptibilities[a];
 
-                        // todo: beta should be age-specific considering PHA's
-                        double beta = g_parameters.getR0() / g_parameters.getBetaScale();
+                contacts += rate * transmittings[b];
 
-                        for(int b=0; b<StochasticSEATIRD::numAgeGroups_; b++)
-                        {
-                            double asymptomatic = asymptomatics[b];
+                sinkContactRates[(nodeIndex * numAgeGroups + a) * numAgeGroups + b] = rate / ageTravelFlowReductions[b] / population;
+            }
 
-                            double transmitting = transmittings[b];
+            sourceContacts[nodeIndex * numAgeGroups + a] = contacts / ageTravelFlowReductions[a] / population;
+        }
+    }
 
-                            double contactRate = contact[a][b];
+    for(int sinkNodeIndex=0; sinkNodeIndex < numNodes_; sinkNodeIndex++)
+    {
+        double unvaccinatedProbabilities[numAgeGroups];
 
-                            double npiEffectivenessAtI = Npi::getNpiEffectiveness(g_parameters.getNpis(), sinkNodeId, int(now_), a, b);
-                            double npiEffectivenessAtJ = Npi::getNpiEffectiveness(g_parameters.getNpis(), sourceNodeId, int(now_), a, b);
+        // asymptomatic travelers into the sink node, weighted by travel fraction
+        double travelingAsymptomatics[numAgeGroups];
 
-                            numberOfInfectiousContactsIJ += (1. - npiEffectivenessAtJ) * transmitting * beta * RHO * contactRate * sigma[a] / ageBasedFlowReductions[a];
-                            numberOfInfectiousContactsJI += (1. - npiEffectivenessAtI) * asymptomatic * beta * RHO * contactRate * sigma[a] / ageBasedFlowReductions[b];
-                        }
+        for(int a=0; a<numAgeGroups; a++)
+        {
+            unvaccinatedProbabilities[a] = 0.;
+            travelingAsymptomatics[a] = 0.;
+        }
 
-                        unvaccinatedProbabilities[a] += travelFractionIJ * numberOfInfectiousContactsIJ / populationSource;
-                        unvaccinatedProbabilities[a] += travelFractionJI * numberOfInfectiousContactsJI / populationSink;
-                    }
-                }
+        // only node pairs with travel in either direction contribute
+        for(int entry=sparseTravel_->getRowStart(sinkNodeIndex); entry<sparseTravel_->getRowStart(sinkNodeIndex+1); entry++)
+        {
+            int sourceNodeIndex = sparseTravel_->getColumn(entry);
+
+            double travelFractionIJ = sparseTravel_->getTravelIJ(entry);
+            double travelFractionJI = sparseTravel_->getTravelJI(entry);
+
+            const double * source = &sourceContacts[sourceNodeIndex * numAgeGroups];
+            const double * asymptomatic = &asymptomatics[sourceNodeIndex * numAgeGroups];
+
+            for(int a=0; a<numAgeGroups; a++)
+            {
+                unvaccinatedProbabilities[a] += travelFractionIJ * source[a];
+                travelingAsymptomatics[a] += travelFractionJI * asymptomatic[a];
             }
         }
 
-        for(int a=0; a<StochasticSEATIRD::numAgeGroups_; a++)
+        const double * rates = &sinkContactRates[sinkNodeIndex * numAgeGroups * numAgeGroups];
+
+        for(int a=0; a<numAgeGroups; a++)
+        {
+            for(int b=0; b<numAgeGroups; b++)
+            {
+                unvaccinatedProbabilities[a] += rates[a * numAgeGroups + b] * travelingAsymptomatics[b];
+            }
+        }
+
+        for(int a=0; a<numAgeGroups; a++)
         {
-            for(int r=0; r<StochasticSEATIRD::numRiskGroups_; r++)
+            for(int r=0; r<numRiskGroups; r++)
             {
-                for(int v=0; v<StochasticSEATIRD::numVaccinatedGroups_; v++)
+                for(int v=0; v<numVaccinatedGroups; v++)
                 {
                     double probability = unvaccinatedProbabilities[a];
 
@@ -1003,8 +1491,8 @@ void StochasticSEATIRD::travel()
                         // - those in the latency period
                         // - total vaccinated
                         // - => those with effective vaccinations
-                        int ageRiskVaccinatedLatencyPopulationSize = getPopulationInVaccineLatencyPeriod(sinkNodeId, a, r);
-                        int ageRiskVaccinatedPopulationSize = populations_(nodeIdToIndex_[sinkNodeId], a, r, 1);
+                        int ageRiskVaccinatedLatencyPopulationSize = getPopulationInVaccineLatencyPeriod(sinkNodeIndex, a, r);
+                        int ageRiskVaccinatedPopulationSize = populations_(sinkNodeIndex, a, r, 1);
 
                         int ageRiskVaccinatedEffectivePopulationSize = ageRiskVaccinatedPopulationSize - ageRiskVaccinatedLatencyPopulationSize;
 
@@ -1019,13 +1507,13 @@ void StochasticSEATIRD::travel()
                     stratificationValues.push_back(r);
                     stratificationValues.push_back(v);
 
-                    int sinkNumSusceptible = (int)(variables_["susceptible"](time_+1, nodeIdToIndex_[sinkNodeId], a, r, v) + 0.5); // continuity correction
+                    int sinkNumSusceptible = (int)(susceptibleVariable(time_+1, sinkNodeIndex, a, r, v) + 0.5); // continuity correction
 
                     if(sinkNumSusceptible > 0)
                     {
-                        int numberOfExposures = (int)gsl_ran_binomial(randGenerator_, probability, sinkNumSusceptible);
+                        int numberOfExposures = (int)gsl_ran_binomial(travelRandGenerator_, probability, sinkNumSusceptible);
 
-                        expose(numberOfExposures, sinkNodeId, stratificationValues);
+                        nodeCounts_[sinkNodeIndex * NUM_NODE_COUNTERS + NODE_COUNTER_TRAVEL_EXPOSURES] += exposeAtNode(numberOfExposures, sinkNodeIndex, stratificationValues, now_, nodeRands_[sinkNodeIndex]);
                     }
                 }
             }
@@ -1041,30 +1529,27 @@ void StochasticSEATIRD::precompute(int time)
 
     blitz::TinyVector<int, 1+NUM_STRATIFICATION_DIMENSIONS> shape;
     shape(0) = numNodes_;
-    shape(1) = StochasticSEATIRD::numAgeGroups_;
-    shape(2) = StochasticSEATIRD::numRiskGroups_;
-    shape(3) = StochasticSEATIRD::numVaccinatedGroups_;
+    shape(1) = numAgeGroups;
+    shape(2) = numRiskGroups;
+    shape(3) = numVaccinatedGroups;
 
     blitz::Array<double, 1+NUM_STRATIFICATION_DIMENSIONS> populations(shape); // [nodeIndex, a, r, v]
 
+    EpidemicVariable &population = getVariable(populationHandle_);
+
     for(unsigned int i=0; i<nodeIds_.size(); i++)
     {
-        int nodeId = nodeIds_[i];
-
-        populationNodes((int)i) = getValue("population", time, nodeId);
+        populationNodes((int)i) = 0.;
 
-        for(int a=0; a<StochasticSEATIRD::numAgeGroups_; a++)
+        for(int a=0; a<numAgeGroups; a++)
         {
-            for(int r=0; r<StochasticSEATIRD::numRiskGroups_; r++)
+            for(int r=0; r<numRiskGroups; r++)
             {
-                for(int v=0; v<StochasticSEATIRD::numVaccinatedGroups_; v++)
+                for(int v=0; v<numVaccinatedGroups; v++)
                 {
-                    std::vector<int> stratificationValues;
-                    stratificationValues.push_back(a);
-                    stratificationValues.push_back(r);
-                    stratificationValues.push_back(v);
+                    populations((int)i, a, r, v) = population(time, (int)i, a, r, v);
 
-                    populations((int)i, a, r, v) = getValue("population", time, nodeId, stratificationValues);
+                    populationNodes((int)i) += populations((int)i, a, r, v);
                 }
             }
         }
@@ -1074,86 +1559,70 @@ void StochasticSEATIRD::precompute(int time)
     populations_.reference(populations);
 }
 
-int StochasticSEATIRD::getScheduleCount(const int &nodeId, const StochasticSEATIRDScheduleState &state, const std::vector<int> &stratificationValues)
+int StochasticSEATIRD::getScheduleCount(const int &nodeIndex, const StochasticSEATIRDScheduleState &state, const std::vector<int> &stratificationValues)
 {
-    int count = 0;
-
-    boost::heap::pairing_heap<StochasticSEATIRDSchedule, boost::heap::compare<StochasticSEATIRDSchedule::compareByNextEventTime> >::iterator begin = scheduleEventQueues_[nodeId].begin();
-    boost::heap::pairing_heap<StochasticSEATIRDSchedule, boost::heap::compare<StochasticSEATIRDSchedule::compareByNextEventTime> >::iterator end = scheduleEventQueues_[nodeId].end();
-
-    boost::heap::pairing_heap<StochasticSEATIRDSchedule, boost::heap::compare<StochasticSEATIRDSchedule::compareByNextEventTime> >::iterator it;
-
-    for(it=begin; it!=end; it++)
-    {
-        if((*it).canceled() != true && (*it).getState() == state && (*it).getStratificationValues() == stratificationValues)
-        {
-            count++;
-        }
-    }
-
-    return count;
+    return scheduleEventQueues_[nodeIndex].getNumRegistered(state, stratificationValues);
 }
 
 bool StochasticSEATIRD::verifyScheduleCounts()
 {
-    bool verified = true;
+    // only verify exposed, asymptomatic, treatable, infectious, as these are the only states having events
+    const int numStates = 4;
 
-    std::vector<int> nodeIds = getNodeIds();
+    StochasticSEATIRDScheduleState states[] = { E, A, T, I };
+    const char * stateNames[] = { "exposed", "asymptomatic", "treatable", "infectious" };
+    EpidemicVariableHandle handles[] = { exposedHandle_, asymptomaticHandle_, treatableHandle_, infectiousHandle_ };
 
-    for(unsigned int i=0; i<nodeIds.size(); i++)
+    // differences are summarized rather than logged one by one, since a single error can cause many of them
+    int numDifferences = 0;
+    int totalDifference = 0;
+
+    std::vector<int> stratificationValues(NUM_STRATIFICATION_DIMENSIONS);
+
+    for(int nodeIndex=0; nodeIndex<numNodes_; nodeIndex++)
     {
-        for(int a=0; a<StochasticSEATIRD::numAgeGroups_; a++)
+        // tau-leaped nodes have no schedules
+        if(nodeTauLeaping_[nodeIndex] != 0)
+        {
+            continue;
+        }
+
+        for(int a=0; a<numAgeGroups; a++)
         {
-            for(int r=0; r<StochasticSEATIRD::numRiskGroups_; r++)
+            for(int r=0; r<numRiskGroups; r++)
             {
-                for(int v=0; v<StochasticSEATIRD::numVaccinatedGroups_; v++)
+                for(int v=0; v<numVaccinatedGroups; v++)
                 {
-                    std::vector<int> stratificationValues;
-                    stratificationValues.push_back(a);
-                    stratificationValues.push_back(r);
-                    stratificationValues.push_back(v);
-
-                    // only verify exposed, asymptomatic, treatable, infectious, as these are the only states having events
-
-                    int exposed = (int)getValue("exposed", time_+1, nodeIds[i], stratificationValues);
-                    int exposedScheduled = getScheduleCount(nodeIds[i], E, stratificationValues);
+                    stratificationValues[0] = a;
+                    stratificationValues[1] = r;
+                    stratificationValues[2] = v;
 
-                    int asymptomatic = (int)getValue("asymptomatic", time_+1, nodeIds[i], stratificationValues);
-                    int asymptomaticScheduled = getScheduleCount(nodeIds[i], A, stratificationValues);
-
-                    int treatable = (int)getValue("treatable", time_+1, nodeIds[i], stratificationValues);
-                    int treatableScheduled = getScheduleCount(nodeIds[i], T, stratificationValues);
-
-                    int infectious = (int)getValue("infectious", time_+1, nodeIds[i], stratificationValues);
-                    int infectiousScheduled = getScheduleCount(nodeIds[i], I, stratificationValues);
-
-                    if(exposed != exposedScheduled)
-                    {
-                        put_flog(LOG_ERROR, "exposed != exposedScheduled (%i != %i)", exposed, exposedScheduled);
-                        verified = false;
-                    }
-
-                    if(asymptomatic != asymptomaticScheduled)
+                    for(int s=0; s<numStates; s++)
                     {
-                        put_flog(LOG_ERROR, "asymptomatic != asymptomaticScheduled (%i != %i)", asymptomatic, asymptomaticScheduled);
-                        verified = false;
-                    }
+                        int value = (int)getVariable(handles[s])(time_+1, nodeIndex, a, r, v);
+                        int scheduled = getScheduleCount(nodeIndex, states[s], stratificationValues);
 
-                    if(treatable != treatableScheduled)
-                    {
-                        put_flog(LOG_ERROR, "treatable != treatableScheduled (%i != %i)", treatable, treatableScheduled);
-                        verified = false;
-                    }
+                        if(value != scheduled)
+                        {
+                            if(numDifferences == 0)
+                            {
+                                put_flog(LOG_ERROR, "%s != %sScheduled (%i != %i) for node %i, stratifications (%i, %i, %i)", stateNames[s], stateNames[s], value, scheduled, nodeIds_[nodeIndex], a, r, v);
+                            }
 
-                    if(infectious != infectiousScheduled)
-                    {
-                        put_flog(LOG_ERROR, "infectious != infectiousScheduled (%i != %i)", infectious, infectiousScheduled);
-                        verified = false;
+                            numDifferences++;
+                            totalDifference += abs(value - scheduled);
+                        }
                     }
                 }
             }
         }
     }
 
-    return verified;
+    if(numDifferences > 0)
+    {
+        put_flog(LOG_ERROR, "schedule counts differ in %i strata, by %i people in total", numDifferences, totalDifference);
+        return false;
+    }
+
+    return true;
 }
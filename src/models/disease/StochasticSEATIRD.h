@@ -1,31 +1,49 @@
 #ifndef STOCHASTIC_SEATIRD_H
 #define STOCHASTIC_SEATIRD_H
 
-#include "../../EpidemicSimulation.h"
+#include "SEATIRD.h"
 #include "StochasticSEATIRDEvent.h"
 #include "StochasticSEATIRDSchedule.h"
+#include "StochasticSEATIRDScheduleQueue.h"
 #include "iliView.h"
-#include <boost/heap/pairing_heap.hpp>
 #include <gsl/gsl_rng.h>
 #include <gsl/gsl_randist.h>
 
-class PriorityGroupSelections;
-
-class StochasticSEATIRD : public EpidemicSimulation
+class StochasticSEATIRD : public SEATIRD
 {
     public:
 
-        StochasticSEATIRD();
+        // all random numbers are drawn from streams keyed by (seed, realization), so a realization is reproducible
+        // and the realizations of a seed are independent; see seedGenerators()
+        // seed < 0 chooses a random seed, which is logged
+        StochasticSEATIRD(int seed=-1, int realization=0);
         ~StochasticSEATIRD();
 
         int expose(int num, int nodeId, std::vector<int> stratificationValues);
 
         void simulate();
 
-        // derived variables
-        float getDerivedVarInfected(int time, int nodeId, std::vector<int> stratificationValues=std::vector<int>());
-        float getDerivedVarPopulationInVaccineLatencyPeriod(int time, int nodeId, std::vector<int> stratificationValues=std::vector<int>());
-        float getDerivedVarPopulationEffectiveVaccines(int time, int nodeId, std::vector<int> stratificationValues=std::vector<int>());
+        // number of threads used to process the events of different nodes concurrently in simulate()
+        // results do not depend on the number of threads; numThreads <= 0 uses one thread per hardware thread
+        void setNumNodeThreads(int numThreads);
+
+        // nodes with at least <threshold> exposed and infected people are simulated by binomial tau-leaping of the counts,
+        // instead of a schedule of events for each person; this bounds the cost of large outbreaks. a node returns to event
+        // scheduling when the number falls below half of the threshold. threshold <= 0 (the default) uses event scheduling only
+        void setTauLeapThreshold(int threshold);
+
+        // reseed all random number generators, as the constructor does
+        // this lets realizations restored from a common checkpoint, or forked from a common state, diverge
+        void reseed(int seed, int realization=0);
+
+        // a branch continuing from the current state of this simulation, for comparing interventions from the same time
+        // the branch shares the history of all variables before the current time step, and has its own copies of the current
+        // time step, schedule queues, random number generators, stockpiles and ILI state
+        // this should be done between time steps. the branch and this simulation can then be simulated concurrently,
+        // and continue identically unless reseeded or given different interventions
+        boost::shared_ptr<StochasticSEATIRD> fork();
+
+        // derived variables, besides those of SEATIRD
         float getDerivedVarILI(int time, int nodeId, std::vector<int> stratificationValues=std::vector<int>());
 
         // other ILI information
@@ -33,23 +51,42 @@ class StochasticSEATIRD : public EpidemicSimulation
 
     private:
 
-        // dimensions of stratifications
-        static const int numAgeGroups_;
-        static const int numRiskGroups_;
-        static const int numVaccinatedGroups_;
+        // random number streams
+        // these are owned by this simulation, so multiple simulations can run concurrently
+        // each stage of the model draws from its own stream, so changes to one stage don't perturb the others
+        RandomStream antiviralsRand_;
+        RandomStream vaccinesRand_;
+
+        // for exposures by travel
+        gsl_rng * travelRandGenerator_;
 
-        // random number generators
-        MTRand rand_;
-        gsl_rng * randGenerator_;
+        // random number streams for ILI
+        RandomStream iliRand_;
+        gsl_rng * iliRandGenerator_;
 
-        // current time step
-        int time_;
+        // random number streams for each node index
+        // all exposures and events of a node use its stream, so nodes can be processed concurrently and deterministically
+        std::vector<RandomStream> nodeRands_;
+
+        // number of threads for processing node events
+        int numNodeThreads_;
+
+        // see setTauLeapThreshold()
+        int tauLeapThreshold_;
 
         // current time for processing new events / new exposures
         double now_;
 
-        // schedule event queue for each nodeId
-        std::map<int, boost::heap::pairing_heap<StochasticSEATIRDSchedule, boost::heap::compare<StochasticSEATIRDSchedule::compareByNextEventTime> > > scheduleEventQueues_;
+        // schedule event queue for each node index
+        // these are all created up front, so the queues of different nodes can be used concurrently
+        std::vector<StochasticSEATIRDScheduleQueue> scheduleEventQueues_;
+
+        // for each node index, nonzero if the node is tau-leaped; tau-leaped nodes have no schedules
+        std::vector<char> nodeTauLeaping_;
+
+        // instrumentation counts of each node over the current time step: [node index * number of counters + counter]
+        // kept for each node, since nodes are processed concurrently
+        std::vector<long> nodeCounts_;
 
         // cached values
         int cachedTime_;
@@ -60,18 +97,55 @@ class StochasticSEATIRD : public EpidemicSimulation
         std::vector<Provider> iliProviders_;
         std::vector<std::vector<float> > iliValues_;
 
-        // create contact events and insert them into the schedule
-        void initializeContactEvents(StochasticSEATIRDSchedule &schedule, const int &nodeId, const std::vector<int> &stratificationValues);
+        // see fork()
+        StochasticSEATIRD(StochasticSEATIRD &simulation);
+
+        // key the random number streams by (seed, realization, stage, node index); see the constructor
+        void seedGenerators(int seed, int realization);
+
+        // the SEATIRD state, generators, schedules, cached values and ILI state
+        bool writeCheckpoint(CheckpointWriter &out);
+        bool readCheckpoint(CheckpointReader &in);
+
+        // expose people in a node at time <now>, creating their schedules
+        // this only modifies data of the node, so it can be called concurrently for different nodes
+        int exposeAtNode(int num, int nodeIndex, const std::vector<int> &stratificationValues, const double &now, RandomStream &rand);
+
+        // insert the first contact event into the schedule
+        // contacts are generated lazily: a schedule holds at most one, and the next is drawn when it is processed
+        void initializeContactEvents(StochasticSEATIRDSchedule &schedule, const int &nodeIndex, const std::vector<int> &stratificationValues, RandomStream &rand);
+
+        // insert the next contact after time TcInit, if it is before the end of the infected period
+        void insertNextContactEvent(StochasticSEATIRDSchedule &schedule, const int &nodeIndex, const std::vector<int> &stratificationValues, const double &TcInit, RandomStream &rand);
+
+        // contact rates of an infected person of an age group with each (age group, risk group) of a node, as rates[a*numRiskGroups + r]
+        // returns the total rate
+        double getContactRates(const int &nodeIndex, const int &ageGroup, double * rates);
+
+        // process the events of a node for the current time step
+        void processNodeEvents(int nodeIndex);
+
+        // number of exposed, asymptomatic, treatable and infectious people in a node at the new time step
+        int getNodeNumInfected(int nodeIndex);
+
+        // switch a node between event scheduling and tau-leaping according to its number of infected
+        // switching to event scheduling creates schedules for all infected from their current states
+        void updateNodeTauLeaping(int nodeIndex);
+
+        // advance the counts of a tau-leaped node over the current time step, in a few steps of binomial draws
+        // exposures within the node follow the rates of the contact events of exposed people
+        void tauLeapNode(int nodeIndex);
 
         // process the next event
-        bool processEvent(const int &nodeId, const StochasticSEATIRDEvent &event);
+        bool processEvent(const int &nodeIndex, const StochasticSEATIRDEvent &event);
 
-        // treatments
-        void applyAntiviralsToPriorityGroupSelections(boost::shared_ptr<PriorityGroupSelections> priorityGroupSelections);
-        void applyVaccinesToPriorityGroupSelections(boost::shared_ptr<PriorityGroupSelections> priorityGroupSelections);
+        // treatments of whole people; the schedules of those effectively treated are canceled, and those of the vaccinated
+        // are moved to the vaccinated stratification
+        void applyAntiviralsToNode(int nodeIndex, const std::vector<std::vector<int> > &stratificationValuesSet, float totalAdherentTreatable, int stockpileAmountUsed);
+        void applyVaccinesToNode(int nodeIndex, const std::vector<std::vector<int> > &stratificationValuesSet2, float totalAdherentUnvaccinated, int stockpileAmountUsed);
 
         // for vaccines
-        int getPopulationInVaccineLatencyPeriod(int nodeId, int ageGroup, int riskGroup);
+        int getPopulationInVaccineLatencyPeriod(int nodeIndex, int ageGroup, int riskGroup);
 
         // travel between nodes
         void travel();
@@ -79,10 +153,15 @@ class StochasticSEATIRD : public EpidemicSimulation
         // precompute / cache values for each time step
         void precompute(int time);
 
-        // count number of active (not canceled) events in schedules corresponding to state and stratifications for nodeId
-        int getScheduleCount(const int &nodeId, const StochasticSEATIRDScheduleState &state, const std::vector<int> &stratificationValues);
+        // report the counts of the time step to the instrumentation, if any, and reset them
+        void endInstrumentationTimeStep();
+
+        // number of queued, not canceled schedules corresponding to state and stratifications for nodeIndex
+        // these are counted by the schedule queue as schedules are queued, processed, canceled and re-stratified
+        int getScheduleCount(const int &nodeIndex, const StochasticSEATIRDScheduleState &state, const std::vector<int> &stratificationValues);
 
-        // verify that the queued schedules match what is expected
+        // verify that the queued schedules match the exposed, asymptomatic, treatable and infectious variables
+        // differences are logged; returns false if there are any
         bool verifyScheduleCounts();
 };
 
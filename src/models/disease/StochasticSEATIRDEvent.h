@@ -1,6 +1,7 @@
 #ifndef STOCHASTIC_SEATIRD_EVENT_H
 #define STOCHASTIC_SEATIRD_EVENT_H
 
+#include "../../stratifications.h"
 #include <vector>
 
 enum StochasticSEATIRDEventType
@@ -18,22 +19,45 @@ enum StochasticSEATIRDEventType
     CONTACT
 };
 
+// events are plain values with no heap-allocated members; there are several of them per infected individual
+// stratification values are stored as bytes: the number of values in each stratification is small
+// the target of a contact event is chosen when it is processed, so events only store the stratification values they are from
 struct StochasticSEATIRDEvent
 {
-    StochasticSEATIRDEvent(const double &_initializationTime, const double &_time, const StochasticSEATIRDEventType &_type, const std::vector<int> &_fromStratificationValues, const std::vector<int> &_toStratificationValues)
+    // the stratification vector may be longer than stored here; extra values are ignored
+    static StochasticSEATIRDEvent create(const double &_initializationTime, const double &_time, const StochasticSEATIRDEventType &_type, const std::vector<int> &_fromStratificationValues)
     {
-        initializationTime = _initializationTime;
-        time = _time;
-        type = _type;
-        fromStratificationValues = _fromStratificationValues;
-        toStratificationValues = _toStratificationValues;
+        StochasticSEATIRDEvent event;
+
+        event.time = _time;
+        event.initializationTime = (float)_initializationTime;
+        event.type = (unsigned char)_type;
+
+        for(int i=0; i<NUM_STRATIFICATION_DIMENSIONS; i++)
+        {
+            event.fromStratificationValues[i] = (unsigned char)(i < (int)_fromStratificationValues.size() ? _fromStratificationValues[i] : 0);
+        }
+
+        return event;
+    }
+
+    StochasticSEATIRDEventType getType() const
+    {
+        return (StochasticSEATIRDEventType)type;
+    }
+
+    std::vector<int> getFromStratificationValues() const
+    {
+        return std::vector<int>(fromStratificationValues, fromStratificationValues + NUM_STRATIFICATION_DIMENSIONS);
     }
 
-    double initializationTime;
     double time;
-    StochasticSEATIRDEventType type;
-    std::vector<int> fromStratificationValues;
-    std::vector<int> toStratificationValues;
+
+    // only informational, so single precision is sufficient
+    float initializationTime;
+
+    unsigned char type;
+    unsigned char fromStratificationValues[NUM_STRATIFICATION_DIMENSIONS];
 
     class compareByTime
     {
@@ -1,107 +1,89 @@
 #include "StochasticSEATIRDSchedule.h"
 #include "../../Parameters.h"
 #include "../random.h"
+#include "../../Checkpoint.h"
 #include "../../log.h"
+#include <algorithm>
 
-StochasticSEATIRDSchedule::StochasticSEATIRDSchedule(const double &now, MTRand &rand, const std::vector<int> &stratificationValues)
+StochasticSEATIRDSchedule::StochasticSEATIRDSchedule()
 {
-    stratificationValues_ = stratificationValues;
+    infectedTMin_ = 0.;
+    infectedTMax_ = 0.;
 
-    // the individual starts as exposed
-    state_ = E;
+    for(int i=0; i<NUM_STRATIFICATION_DIMENSIONS; i++)
+    {
+        stratificationValues_[i] = 0;
+    }
 
-    // the schedule can later be canceled, but starts out active
+    state_ = E;
     canceled_ = false;
+}
 
-    // generate all transitions starting from "exposed"
-
-    // time to progress from exposed to asymptomatic
-    double Ta = now + random_exponential(1. / g_parameters.getTau(), &rand);
+StochasticSEATIRDSchedule::StochasticSEATIRDSchedule(const double &now, RandomStream &rand, const std::vector<int> &stratificationValues, StochasticSEATIRDScheduleState state)
+{
+    for(int i=0; i<NUM_STRATIFICATION_DIMENSIONS; i++)
+    {
+        stratificationValues_[i] = (unsigned char)stratificationValues[i];
+    }
 
-    // infected period begins at asymptomatic
-    infectedTMin_ = Ta;
+    state_ = (unsigned char)state;
 
-    // infected periods ends at recovery / death and is set inline below
+    // the schedule can later be canceled, but starts out active
+    canceled_ = false;
 
-    eventQueue_.push(StochasticSEATIRDEvent(now, Ta, EtoA, stratificationValues, stratificationValues));
+    // infected period begins at asymptomatic; it ends at recovery / death and is set below
+    infectedTMin_ = now;
+    infectedTMax_ = now;
 
     // compute nu (rate) from nu (CFR)
     double nu = -1./g_parameters.getGamma() * log(1. - g_parameters.getNu(stratificationValues[0]));
 
-    // asymptomatic transition: -> treatable, -> recovered, or -> deceased
-    double Tt =  Ta + random_exponential(1. / g_parameters.getKappa(), &rand); // time to progress from asymptomatic to treatable
-    double Tr_a = Ta + random_exponential(1. / g_parameters.getGamma(), &rand); // time to recover from asymptomatic
-    double Td_a = Ta + random_exponential(nu, &rand); // time to death from asymptomatic
-
-    if(Tt < Tr_a && Tt < Td_a)
+    // generate all transitions starting from the given state
+    // the remaining times in each state are exponential, so they don't depend on when the state was entered; except for
+    // the fixed treatable period, of which a uniformly distributed remainder is used
+    switch(state)
     {
-        // -> treatable
-        eventQueue_.push(StochasticSEATIRDEvent(Ta, Tt, AtoT, stratificationValues, stratificationValues));
+        case E:
+        {
+            // time to progress from exposed to asymptomatic
+            double Ta = now + random_exponential(1. / g_parameters.getTau(), &rand);
 
-        // treatable transitions: -> infectious, -> recovered, or -> deceased
-        double Ti = Tt + g_parameters.getChi(); // time to progress from treatable to infectious
-        double Tr_ti = Tt + random_exponential(1. / g_parameters.getGamma(), &rand); // time to recover from treatable/infectious
-        double Td_ti = Tt + random_exponential(nu, &rand); // time to death from treatable/infectious
+            infectedTMin_ = Ta;
 
-        if(Ti < Tr_ti && Ti < Td_ti)
-        {
-            // -> infectious
-            eventQueue_.push(StochasticSEATIRDEvent(Tt, Ti, TtoI, stratificationValues, stratificationValues));
-
-            // infectious transitions: -> recovered, or -> deceased
-            if(Tr_ti < Td_ti)
-            {
-                // -> recovered
-                infectedTMax_ = Tr_ti;
-                eventQueue_.push(StochasticSEATIRDEvent(Ti, Tr_ti, ItoR, stratificationValues, stratificationValues));
-            }
-            else // Td_ti < Tr_ti
-            {
-                // -> deceased
-                infectedTMax_ = Td_ti;
-                eventQueue_.push(StochasticSEATIRDEvent(Ti, Td_ti, ItoD, stratificationValues, stratificationValues));
-            }
-        }
-        else if(Tr_ti < Td_ti)
-        {
-            // -> recovered
-            infectedTMax_ = Tr_ti;
-            eventQueue_.push(StochasticSEATIRDEvent(Tt, Tr_ti, TtoR, stratificationValues, stratificationValues));
-        }
-        else // Td_ti < Tr_ti
-        {
-            // -> deceased
-            infectedTMax_ = Td_ti;
-            eventQueue_.push(StochasticSEATIRDEvent(Tt, Td_ti, TtoD, stratificationValues, stratificationValues));
+            insertEvent(StochasticSEATIRDEvent::create(now, Ta, EtoA, stratificationValues));
+
+            scheduleAsymptomatic(Ta, nu, rand, stratificationValues);
+            break;
         }
-    }
-    else if(Tr_a < Td_a)
-    {
-        // -> recovered
-        infectedTMax_ = Tr_a;
-        eventQueue_.push(StochasticSEATIRDEvent(Ta, Tr_a, AtoR, stratificationValues, stratificationValues));
-    }
-    else // Td_a < Tr_a
-    {
-        // -> deceased
-        infectedTMax_ = Td_a;
-        eventQueue_.push(StochasticSEATIRDEvent(Ta, Td_a, AtoD, stratificationValues, stratificationValues));
+        case A:
+            scheduleAsymptomatic(now, nu, rand, stratificationValues);
+            break;
+        case T:
+            scheduleTreatable(now, now + g_parameters.getChi() * rand.randExc(), nu, rand, stratificationValues);
+            break;
+        case I:
+            scheduleInfectious(now, now + random_exponential(1. / g_parameters.getGamma(), &rand), now + random_exponential(nu, &rand), stratificationValues);
+            break;
+        default:
+            put_flog(LOG_ERROR, "cannot schedule state %i", (int)state);
+            break;
     }
 }
 
 void StochasticSEATIRDSchedule::insertEvent(const StochasticSEATIRDEvent &event)
 {
-    eventQueue_.push(event);
+    // keep events sorted by decreasing time; events with equal times are processed in insertion order
+    events_.insert(std::lower_bound(events_.begin(), events_.end(), event, StochasticSEATIRDEvent::compareByTime()), event);
 }
 
 bool StochasticSEATIRDSchedule::empty() const
 {
-    return eventQueue_.empty();
+    return events_.empty();
 }
 
 StochasticSEATIRDEvent StochasticSEATIRDSchedule::getTopEvent() const
 {
-    return eventQueue_.top();
+    return events_.back();
 }
 
 void StochasticSEATIRDSchedule::popTopEvent()
@@ -112,7 +94,7 @@ void StochasticSEATIRDSchedule::popTopEvent()
     }
 
     // when the event is popped, it is assumed it is processed and the individual transitions states accordingly
-    StochasticSEATIRDEventType type = eventQueue_.top().type;
+    StochasticSEATIRDEventType type = events_.back().getType();
 
     // this should handle all event types involving transitions
     switch(type)
@@ -149,17 +131,22 @@ void StochasticSEATIRDSchedule::popTopEvent()
             break;
     }
 
-    eventQueue_.pop();
+    events_.pop_back();
 }
 
 std::vector<int> StochasticSEATIRDSchedule::getStratificationValues() const
 {
-    return stratificationValues_;
+    return std::vector<int>(stratificationValues_, stratificationValues_ + NUM_STRATIFICATION_DIMENSIONS);
+}
+
+int StochasticSEATIRDSchedule::getStratificationValue(int dimension) const
+{
+    return stratificationValues_[dimension];
 }
 
 StochasticSEATIRDScheduleState StochasticSEATIRDSchedule::getState() const
 {
-    return state_;
+    return (StochasticSEATIRDScheduleState)state_;
 }
 
 double StochasticSEATIRDSchedule::getInfectedTMin() const
@@ -184,16 +171,104 @@ void StochasticSEATIRDSchedule::cancel()
 
 void StochasticSEATIRDSchedule::changeStratificationValues(std::vector<int> stratificationValues)
 {
-    stratificationValues_ = stratificationValues;
+    for(int i=0; i<NUM_STRATIFICATION_DIMENSIONS; i++)
+    {
+        stratificationValues_[i] = (unsigned char)stratificationValues[i];
+    }
 
     // update fromValues in events in queue
-    boost::heap::pairing_heap<StochasticSEATIRDEvent, boost::heap::compare<StochasticSEATIRDEvent::compareByTime> >::iterator begin = eventQueue_.begin();
-    boost::heap::pairing_heap<StochasticSEATIRDEvent, boost::heap::compare<StochasticSEATIRDEvent::compareByTime> >::iterator end = eventQueue_.end();
+    for(unsigned int e=0; e<events_.size(); e++)
+    {
+        for(int i=0; i<NUM_STRATIFICATION_DIMENSIONS; i++)
+        {
+            events_[e].fromStratificationValues[i] = stratificationValues_[i];
+        }
+    }
+}
+
+void StochasticSEATIRDSchedule::writeCheckpoint(CheckpointWriter &out) const
+{
+    out.writeVector(events_);
+    out.write(infectedTMin_);
+    out.write(infectedTMax_);
+    out.writeArray(stratificationValues_, NUM_STRATIFICATION_DIMENSIONS);
+    out.write(state_);
+    out.write(canceled_);
+}
+
+bool StochasticSEATIRDSchedule::readCheckpoint(CheckpointReader &in)
+{
+    return in.readVector(events_) && in.read(infectedTMin_) && in.read(infectedTMax_) && in.readArray(stratificationValues_, NUM_STRATIFICATION_DIMENSIONS) && in.read(state_) && in.read(canceled_);
+}
+
+void StochasticSEATIRDSchedule::scheduleAsymptomatic(const double &Ta, const double &nu, RandomStream &rand, const std::vector<int> &stratificationValues)
+{
+    // asymptomatic transition: -> treatable, -> recovered, or -> deceased
+    double Tt =  Ta + random_exponential(1. / g_parameters.getKappa(), &rand); // time to progress from asymptomatic to treatable
+    double Tr_a = Ta + random_exponential(1. / g_parameters.getGamma(), &rand); // time to recover from asymptomatic
+    double Td_a = Ta + random_exponential(nu, &rand); // time to death from asymptomatic
+
+    if(Tt < Tr_a && Tt < Td_a)
+    {
+        // -> treatable
+        insertEvent(StochasticSEATIRDEvent::create(Ta, Tt, AtoT, stratificationValues));
+
+        scheduleTreatable(Tt, Tt + g_parameters.getChi(), nu, rand, stratificationValues);
+    }
+    else if(Tr_a < Td_a)
+    {
+        // -> recovered
+        infectedTMax_ = Tr_a;
+        insertEvent(StochasticSEATIRDEvent::create(Ta, Tr_a, AtoR, stratificationValues));
+    }
+    else // Td_a < Tr_a
+    {
+        // -> deceased
+        infectedTMax_ = Td_a;
+        insertEvent(StochasticSEATIRDEvent::create(Ta, Td_a, AtoD, stratificationValues));
+    }
+}
+
+void StochasticSEATIRDSchedule::scheduleTreatable(const double &Tt, const double &Ti, const double &nu, RandomStream &rand, const std::vector<int> &stratificationValues)
+{
+    // treatable transitions: -> infectious, -> recovered, or -> deceased
+    double Tr_ti = Tt + random_exponential(1. / g_parameters.getGamma(), &rand); // time to recover from treatable/infectious
+    double Td_ti = Tt + random_exponential(nu, &rand); // time to death from treatable/infectious
 
-    boost::heap::pairing_heap<StochasticSEATIRDEvent, boost::heap::compare<StochasticSEATIRDEvent::compareByTime> >::iterator it;
+    if(Ti < Tr_ti && Ti < Td_ti)
+    {
+        // -> infectious
+        insertEvent(StochasticSEATIRDEvent::create(Tt, Ti, TtoI, stratificationValues));
+
+        scheduleInfectious(Ti, Tr_ti, Td_ti, stratificationValues);
+    }
+    else if(Tr_ti < Td_ti)
+    {
+        // -> recovered
+        infectedTMax_ = Tr_ti;
+        insertEvent(StochasticSEATIRDEvent::create(Tt, Tr_ti, TtoR, stratificationValues));
+    }
+    else // Td_ti < Tr_ti
+    {
+        // -> deceased
+        infectedTMax_ = Td_ti;
+        insertEvent(StochasticSEATIRDEvent::create(Tt, Td_ti, TtoD, stratificationValues));
+    }
+}
 
-    for(it=begin; it!=end; it++)
+void StochasticSEATIRDSchedule::scheduleInfectious(const double &Ti, const double &Tr, const double &Td, const std::vector<int> &stratificationValues)
+{
+    // infectious transitions: -> recovered, or -> deceased
+    if(Tr < Td)
+    {
+        // -> recovered
+        infectedTMax_ = Tr;
+        insertEvent(StochasticSEATIRDEvent::create(Ti, Tr, ItoR, stratificationValues));
+    }
+    else // Td < Tr
     {
-        (*boost::heap::pairing_heap<StochasticSEATIRDEvent, boost::heap::compare<StochasticSEATIRDEvent::compareByTime> >::s_handle_from_iterator(it)).fromStratificationValues = stratificationValues;
+        // -> deceased
+        infectedTMax_ = Td;
+        insertEvent(StochasticSEATIRDEvent::create(Ti, Td, ItoD, stratificationValues));
     }
 }
@@ -2,8 +2,11 @@
 #define STOCHASTIC_SEATIRD_SCHEDULE_H
 
 #include "StochasticSEATIRDEvent.h"
-#include "../MersenneTwister.h"
-#include <boost/heap/pairing_heap.hpp>
+#include "../RandomStream.h"
+#include <vector>
+
+class CheckpointWriter;
+class CheckpointReader;
 
 // an individual corresponding to a schedule can be in any of these states
 // susceptible is not included, since events start after exposure
@@ -22,7 +25,11 @@ class StochasticSEATIRDSchedule
 {
     public:
 
-        StochasticSEATIRDSchedule(const double &now, MTRand &rand, const std::vector<int> &stratificationValues);
+        // an empty schedule, e.g. to be read from a checkpoint
+        StochasticSEATIRDSchedule();
+
+        // the remaining transitions of an individual in <state> at time <now>; usually a new exposure
+        StochasticSEATIRDSchedule(const double &now, RandomStream &rand, const std::vector<int> &stratificationValues, StochasticSEATIRDScheduleState state=E);
 
         void insertEvent(const StochasticSEATIRDEvent &event);
 
@@ -38,6 +45,7 @@ class StochasticSEATIRDSchedule
 
         // get stratification of individual corresponding to this schedule
         std::vector<int> getStratificationValues() const;
+        int getStratificationValue(int dimension) const;
 
         // get state of individual corresponding to this schedule
         StochasticSEATIRDScheduleState getState() const;
@@ -55,38 +63,49 @@ class StochasticSEATIRDSchedule
         // change stratifications (this is used when scheduled individuals are vaccinated)
         void changeStratificationValues(std::vector<int> stratificationValues);
 
+        // the events and state of the individual; see EpidemicSimulation::saveCheckpoint()
+        void writeCheckpoint(CheckpointWriter &out) const;
+        bool readCheckpoint(CheckpointReader &in);
+
         // todo: we could save the latest event time in this class to make the comparisons faster...
         class compareByNextEventTime
         {
             public:
                 bool operator()(const StochasticSEATIRDSchedule * lhs, const StochasticSEATIRDSchedule * rhs) const
                 {
-                    return (lhs->eventQueue_.top().time > rhs->eventQueue_.top().time);
+                    return (lhs->events_.back().time > rhs->events_.back().time);
                 }
 
                 bool operator()(const StochasticSEATIRDSchedule &lhs, const StochasticSEATIRDSchedule &rhs) const
                 {
-                    return (lhs.eventQueue_.top().time > rhs.eventQueue_.top().time);
+                    return (lhs.events_.back().time > rhs.events_.back().time);
                 }
         };
 
     private:
 
-        boost::heap::pairing_heap<StochasticSEATIRDEvent, boost::heap::compare<StochasticSEATIRDEvent::compareByTime> > eventQueue_;
-
-        // stratification of individual corresponding to schedule
-        std::vector<int> stratificationValues_;
-
-        // current state of individual corresponding to schedule
-        StochasticSEATIRDScheduleState state_;
+        // events sorted by decreasing time: the next event is at the back
+        // a schedule only holds a few tens of events, so a sorted contiguous vector is cheaper than a heap
+        std::vector<StochasticSEATIRDEvent> events_;
 
         // infected times: from asymptomatic to recovery / death
         // new events (such as contacts) only allowed within this range!
         double infectedTMin_;
         double infectedTMax_;
 
+        // stratification of individual corresponding to schedule
+        unsigned char stratificationValues_[NUM_STRATIFICATION_DIMENSIONS];
+
+        // current state of individual corresponding to schedule (a StochasticSEATIRDScheduleState)
+        unsigned char state_;
+
         // if the schedule is canceled no further events should be processed
         bool canceled_;
+
+        // transitions from entering asymptomatic at Ta, treatable at Tt (infectious at Ti), or infectious at Ti
+        void scheduleAsymptomatic(const double &Ta, const double &nu, RandomStream &rand, const std::vector<int> &stratificationValues);
+        void scheduleTreatable(const double &Tt, const double &Ti, const double &nu, RandomStream &rand, const std::vector<int> &stratificationValues);
+        void scheduleInfectious(const double &Ti, const double &Tr, const double &Td, const std::vector<int> &stratificationValues);
 };
 
 #endif
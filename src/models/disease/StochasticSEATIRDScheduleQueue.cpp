@@ -0,0 +1,437 @@
+#include "StochasticSEATIRDScheduleQueue.h"
+#include "SEATIRDConstants.h"
+#include "../../Checkpoint.h"
+#include "../../log.h"
+#include <algorithm>
+
+EventTimeQueueType StochasticSEATIRDScheduleQueue::defaultType_ = EVENT_TIME_QUEUE_HEAP;
+
+// number of schedule states, and of values of each stratification
+static const int numScheduleStates = D + 1;
+static const int numStratificationValues[NUM_STRATIFICATION_DIMENSIONS] = { numAgeGroups, numRiskGroups, numVaccinatedGroups };
+
+static int getNumRegistryKeys()
+{
+    int numKeys = numScheduleStates;
+
+    for(int i=0; i<NUM_STRATIFICATION_DIMENSIONS; i++)
+    {
+        numKeys *= numStratificationValues[i];
+    }
+
+    return numKeys;
+}
+
+StochasticSEATIRDScheduleQueue::StochasticSEATIRDScheduleQueue() : times_(defaultType_)
+{
+
+}
+
+EventTimeQueueType StochasticSEATIRDScheduleQueue::getDefaultType()
+{
+    return defaultType_;
+}
+
+void StochasticSEATIRDScheduleQueue::setDefaultType(const EventTimeQueueType &type)
+{
+    defaultType_ = type;
+}
+
+int StochasticSEATIRDScheduleQueue::insert(const StochasticSEATIRDSchedule &schedule)
+{
+    if(schedule.empty() == true)
+    {
+        put_flog(LOG_ERROR, "cannot insert an empty schedule");
+        return -1;
+    }
+
+    int index;
+
+    if(freeIndices_.empty() != true)
+    {
+        index = freeIndices_.back();
+        freeIndices_.pop_back();
+
+        // assignment reuses the storage of the released schedule
+        schedules_[index] = schedule;
+    }
+    else
+    {
+        index = (int)schedules_.size();
+
+        schedules_.push_back(schedule);
+        queued_.push_back(false);
+        registryPositions_.push_back(-1);
+    }
+
+    push(index);
+
+    return index;
+}
+
+bool StochasticSEATIRDScheduleQueue::empty() const
+{
+    return times_.empty();
+}
+
+int StochasticSEATIRDScheduleQueue::size() const
+{
+    return times_.size();
+}
+
+int StochasticSEATIRDScheduleQueue::top() const
+{
+    return times_.top();
+}
+
+double StochasticSEATIRDScheduleQueue::getTopTime() const
+{
+    return times_.getTopTime();
+}
+
+void StochasticSEATIRDScheduleQueue::pop()
+{
+    // processing the schedule may change its state, so it is registered again when it is requeued
+    unregisterSchedule(times_.top());
+
+    queued_[times_.top()] = false;
+
+    times_.pop();
+}
+
+void StochasticSEATIRDScheduleQueue::requeue(int index)
+{
+    if(schedules_[index].empty() == true || schedules_[index].canceled() == true)
+    {
+        release(index);
+    }
+    else
+    {
+        push(index);
+    }
+}
+
+void StochasticSEATIRDScheduleQueue::release(int index)
+{
+    if(queued_[index] == true)
+    {
+        put_flog(LOG_ERROR, "cannot release queued schedule %i", index);
+        return;
+    }
+
+    freeIndices_.push_back(index);
+}
+
+void StochasticSEATIRDScheduleQueue::clear()
+{
+    // swap with empty vectors, so the storage is freed
+    std::vector<StochasticSEATIRDSchedule>().swap(schedules_);
+    std::vector<bool>().swap(queued_);
+    std::vector<int>().swap(freeIndices_);
+    std::vector<std::vector<int> >().swap(registry_);
+    std::vector<int>().swap(registryPositions_);
+
+    times_ = EventTimeQueue(times_.getType());
+}
+
+int StochasticSEATIRDScheduleQueue::getNumRegistered(const StochasticSEATIRDScheduleState &state, const std::vector<int> &stratificationValues) const
+{
+    int key = getRegistryKey(state, stratificationValues);
+
+    if(key < 0 || registry_.empty() == true)
+    {
+        return 0;
+    }
+
+    return (int)registry_[key].size();
+}
+
+std::vector<int> StochasticSEATIRDScheduleQueue::selectRegistered(const StochasticSEATIRDScheduleState &state, const std::vector<int> &stratificationValues, int num, RandomStream &rand)
+{
+    int key = getRegistryKey(state, stratificationValues);
+
+    if(key < 0 || registry_.empty() == true)
+    {
+        return std::vector<int>();
+    }
+
+    std::vector<int> &indices = registry_[key];
+
+    int size = (int)indices.size();
+
+    if(num > size)
+    {
+        num = size;
+    }
+
+    // partial Fisher-Yates shuffle: the selected schedules are moved to the end of the list
+    for(int i=0; i<num; i++)
+    {
+        int j = (int)rand.randInt((boost::uint32_t)(size - 1 - i));
+        int last = size - 1 - i;
+
+        std::swap(indices[j], indices[last]);
+
+        registryPositions_[indices[j]] = j;
+        registryPositions_[indices[last]] = last;
+    }
+
+    return std::vector<int>(indices.end() - num, indices.end());
+}
+
+void StochasticSEATIRDScheduleQueue::cancel(int index)
+{
+    unregisterSchedule(index);
+
+    schedules_[index].cancel();
+}
+
+void StochasticSEATIRDScheduleQueue::changeStratificationValues(int index, const std::vector<int> &stratificationValues)
+{
+    unregisterSchedule(index);
+
+    schedules_[index].changeStratificationValues(stratificationValues);
+
+    if(queued_[index] == true && schedules_[index].canceled() != true)
+    {
+        registerSchedule(index);
+    }
+}
+
+StochasticSEATIRDSchedule & StochasticSEATIRDScheduleQueue::getSchedule(int index)
+{
+    return schedules_[index];
+}
+
+const StochasticSEATIRDSchedule & StochasticSEATIRDScheduleQueue::getSchedule(int index) const
+{
+    return schedules_[index];
+}
+
+int StochasticSEATIRDScheduleQueue::getNumSlots() const
+{
+    return (int)schedules_.size();
+}
+
+bool StochasticSEATIRDScheduleQueue::isQueued(int index) const
+{
+    return queued_[index];
+}
+
+bool StochasticSEATIRDScheduleQueue::writeCheckpoint(CheckpointWriter &out)
+{
+    out.write((boost::int32_t)schedules_.size());
+
+    for(unsigned int i=0; i<schedules_.size(); i++)
+    {
+        schedules_[i].writeCheckpoint(out);
+    }
+
+    out.writeVector(std::vector<char>(queued_.begin(), queued_.end()));
+    out.writeVector(freeIndices_);
+
+    out.write((boost::int32_t)registry_.size());
+
+    for(unsigned int i=0; i<registry_.size(); i++)
+    {
+        out.writeVector(registry_[i]);
+    }
+
+    return out.good();
+}
+
+bool StochasticSEATIRDScheduleQueue::readCheckpoint(CheckpointReader &in)
+{
+    boost::int32_t numSchedules;
+
+    // each schedule starts with the size of its events
+    if(in.read(numSchedules) != true || numSchedules < 0 || in.checkSize(numSchedules, sizeof(boost::uint64_t)) != true)
+    {
+        return false;
+    }
+
+    std::vector<StochasticSEATIRDSchedule> schedules(numSchedules);
+
+    for(int i=0; i<numSchedules; i++)
+    {
+        if(schedules[i].readCheckpoint(in) != true)
+        {
+            return false;
+        }
+    }
+
+    std::vector<char> queued;
+    std::vector<int> freeIndices;
+
+    if(in.readVector(queued) != true || in.readVector(freeIndices) != true || (int)queued.size() != numSchedules)
+    {
+        return false;
+    }
+
+    boost::int32_t numRegistryKeys;
+
+    if(in.read(numRegistryKeys) != true || numRegistryKeys < 0 || in.checkSize(numRegistryKeys, sizeof(boost::uint64_t)) != true)
+    {
+        return false;
+    }
+
+    std::vector<std::vector<int> > registry(numRegistryKeys);
+
+    for(int i=0; i<numRegistryKeys; i++)
+    {
+        if(in.readVector(registry[i]) != true)
+        {
+            return false;
+        }
+    }
+
+    for(unsigned int i=0; i<freeIndices.size(); i++)
+    {
+        if(freeIndices[i] < 0 || freeIndices[i] >= numSchedules || queued[freeIndices[i]] != 0)
+        {
+            put_flog(LOG_ERROR, "invalid free schedule index %i", freeIndices[i]);
+            return false;
+        }
+    }
+
+    for(int i=0; i<numSchedules; i++)
+    {
+        if(queued[i] != 0 && schedules[i].empty() == true)
+        {
+            put_flog(LOG_ERROR, "empty queued schedule %i", i);
+            return false;
+        }
+    }
+
+    schedules_.swap(schedules);
+    queued_ = std::vector<bool>(numSchedules, false);
+    freeIndices_.swap(freeIndices);
+
+    // queued schedules are not modified, so they are queued at the time of their next event
+    // entries are ordered by (time, index), so requeueing them in any order restores the same order
+    times_ = EventTimeQueue(times_.getType());
+
+    registry_.clear();
+    registryPositions_ = std::vector<int>(numSchedules, -1);
+
+    for(int i=0; i<numSchedules; i++)
+    {
+        if(queued[i] != 0)
+        {
+            push(i);
+        }
+    }
+
+    // requeueing registered the schedules in index order; restore the registry order, which must hold the same schedules
+    int numKeys = getNumRegistryKeys();
+
+    if(numRegistryKeys != 0 && numRegistryKeys != numKeys)
+    {
+        put_flog(LOG_ERROR, "wrong number of schedule registry keys %i", numRegistryKeys);
+        return false;
+    }
+
+    registry.resize(numKeys);
+    registry_.resize(numKeys);
+
+    std::vector<int> registryPositions(numSchedules, -1);
+
+    for(int k=0; k<numKeys; k++)
+    {
+        if(registry[k].size() != registry_[k].size())
+        {
+            put_flog(LOG_ERROR, "wrong number of registered schedules for key %i", k);
+            return false;
+        }
+
+        for(unsigned int p=0; p<registry[k].size(); p++)
+        {
+            int index = registry[k][p];
+
+            if(index < 0 || index >= numSchedules || registryPositions_[index] < 0 || getRegistryKey(schedules_[index].getState(), schedules_[index].getStratificationValues()) != k || registryPositions[index] >= 0)
+            {
+                put_flog(LOG_ERROR, "invalid registered schedule index %i", index);
+                return false;
+            }
+
+            registryPositions[index] = (int)p;
+        }
+    }
+
+    registry_.swap(registry);
+    registryPositions_.swap(registryPositions);
+
+    return true;
+}
+
+void StochasticSEATIRDScheduleQueue::push(int index)
+{
+    times_.push(schedules_[index].getTopEvent().time, index);
+
+    queued_[index] = true;
+
+    if(schedules_[index].canceled() != true)
+    {
+        registerSchedule(index);
+    }
+}
+
+int StochasticSEATIRDScheduleQueue::getRegistryKey(const StochasticSEATIRDScheduleState &state, const std::vector<int> &stratificationValues)
+{
+    if((int)state < 0 || (int)state >= numScheduleStates || (int)stratificationValues.size() < NUM_STRATIFICATION_DIMENSIONS)
+    {
+        return -1;
+    }
+
+    int key = (int)state;
+
+    for(int i=0; i<NUM_STRATIFICATION_DIMENSIONS; i++)
+    {
+        if(stratificationValues[i] < 0 || stratificationValues[i] >= numStratificationValues[i])
+        {
+            return -1;
+        }
+
+        key = key * numStratificationValues[i] + stratificationValues[i];
+    }
+
+    return key;
+}
+
+void StochasticSEATIRDScheduleQueue::registerSchedule(int index)
+{
+    int key = getRegistryKey(schedules_[index].getState(), schedules_[index].getStratificationValues());
+
+    if(key < 0)
+    {
+        put_flog(LOG_ERROR, "cannot register schedule %i", index);
+        return;
+    }
+
+    if(registry_.empty() == true)
+    {
+        registry_.resize(getNumRegistryKeys());
+    }
+
+    registryPositions_[index] = (int)registry_[key].size();
+    registry_[key].push_back(index);
+}
+
+void StochasticSEATIRDScheduleQueue::unregisterSchedule(int index)
+{
+    int position = registryPositions_[index];
+
+    if(position < 0)
+    {
+        return;
+    }
+
+    std::vector<int> &indices = registry_[getRegistryKey(schedules_[index].getState(), schedules_[index].getStratificationValues())];
+
+    // move the last schedule of the list into the position
+    indices[position] = indices.back();
+    registryPositions_[indices[position]] = position;
+
+    indices.pop_back();
+    registryPositions_[index] = -1;
+}
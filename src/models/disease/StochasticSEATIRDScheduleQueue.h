@@ -0,0 +1,105 @@
+#ifndef STOCHASTIC_SEATIRD_SCHEDULE_QUEUE_H
+#define STOCHASTIC_SEATIRD_SCHEDULE_QUEUE_H
+
+#include "StochasticSEATIRDSchedule.h"
+#include "../EventTimeQueue.h"
+#include <vector>
+
+// priority queue of schedules, ordered by the time of their next event
+// schedules are stored in place in a slab and referenced by index; the time queue only holds (time, index) entries
+// so processing an event never copies a schedule
+// indices of released schedules are reused; references to schedules are invalidated by insert()
+// queued schedules that are not canceled are also registered by (state, stratification values), so treatments
+// can select schedules of a stratum without scanning all schedules
+class StochasticSEATIRDScheduleQueue
+{
+    public:
+
+        // the time queue implementation is set from the default type at construction
+        StochasticSEATIRDScheduleQueue();
+
+        // default time queue implementation for new queues
+        // all implementations give identical results; this should be set before any simulations are created
+        static EventTimeQueueType getDefaultType();
+        static void setDefaultType(const EventTimeQueueType &type);
+
+        // insert a non-empty schedule; returns its index
+        int insert(const StochasticSEATIRDSchedule &schedule);
+
+        bool empty() const;
+
+        // number of queued schedules
+        int size() const;
+
+        // index and next event time of the schedule at the top of the queue
+        int top() const;
+        double getTopTime() const;
+
+        // remove the top entry from the queue; the schedule remains stored until it is requeued or released
+        void pop();
+
+        // requeue a popped schedule according to its next event
+        // empty or canceled schedules are released instead
+        void requeue(int index);
+
+        // release a popped schedule's storage for reuse
+        void release(int index);
+
+        // remove all schedules and free their storage
+        void clear();
+
+        StochasticSEATIRDSchedule & getSchedule(int index);
+        const StochasticSEATIRDSchedule & getSchedule(int index) const;
+
+        // number of registered schedules with the state and stratification values
+        int getNumRegistered(const StochasticSEATIRDScheduleState &state, const std::vector<int> &stratificationValues) const;
+
+        // choose num of the registered schedules with the state and stratification values uniformly at random
+        // returns their indices, or all of them if there are fewer than num
+        std::vector<int> selectRegistered(const StochasticSEATIRDScheduleState &state, const std::vector<int> &stratificationValues, int num, RandomStream &rand);
+
+        // cancel a queued schedule; it is released when it reaches the top of the queue
+        void cancel(int index);
+
+        // change the stratification values of a queued schedule
+        void changeStratificationValues(int index, const std::vector<int> &stratificationValues);
+
+        // for iterating over all stored schedules: indices are in [0, getNumSlots())
+        int getNumSlots() const;
+        bool isQueued(int index) const;
+
+        // all stored schedules and which of them are queued; see EpidemicSimulation::saveCheckpoint()
+        // this must not be done while a popped schedule is being processed
+        bool writeCheckpoint(CheckpointWriter &out);
+        bool readCheckpoint(CheckpointReader &in);
+
+    private:
+
+        static EventTimeQueueType defaultType_;
+
+        std::vector<StochasticSEATIRDSchedule> schedules_;
+        std::vector<bool> queued_;
+
+        // released indices available for reuse
+        std::vector<int> freeIndices_;
+
+        // (next event time, index) for queued schedules; ties are broken by index for determinism
+        EventTimeQueue times_;
+
+        // indices of registered schedules for each registry key; empty until the first schedule is registered
+        // the order of each list depends on the history of the queue, so it is part of the checkpoint
+        std::vector<std::vector<int> > registry_;
+
+        // position of each schedule in its registry list, or -1 if it is not registered
+        std::vector<int> registryPositions_;
+
+        void push(int index);
+
+        // registry key of (state, stratification values), or -1 if they are out of range
+        static int getRegistryKey(const StochasticSEATIRDScheduleState &state, const std::vector<int> &stratificationValues);
+
+        void registerSchedule(int index);
+        void unregisterSchedule(int index);
+};
+
+#endif
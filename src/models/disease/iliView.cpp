@@ -1,30 +1,43 @@
 #include "iliView.h"
 #include "../../main.h"
-#include "../MersenneTwister.h"
 #include "../../log.h"
+#include "../../InputBundle.h"
 #include <iostream>
 #include <fstream>
-#include <gsl/gsl_rng.h>
 #include <gsl/gsl_randist.h>
+#include <boost/thread/mutex.hpp>
 
-// random number generators
-MTRand iliRand;
-gsl_rng * iliRandGenerator;
+// ILI input data; loaded once and shared by all simulations
+bool iliDataLoaded = false;
+boost::mutex iliDataMutex;
+
+std::vector<int> iliNumProviders;
+std::vector<float> iliProviderStartProbabilities;
+std::vector<float> iliProviderStopProbabilities;
 
 // ILI noise data
 std::vector<float> iliNoiseVector;
 
+// ILI input files, relative to the data directory
+const char * iliNumProvidersFilename = "ILI/numCountyProviders.txt";
+const char * iliProviderStartProbabilitiesFilename = "ILI/providerStartProbabilities.txt";
+const char * iliProviderStopProbabilitiesFilename = "ILI/providerStopProbabilities.txt";
+const char * iliNoiseFilename = "ILI/providerNoiseData.txt";
+
 // misc
 std::vector<int> repeat(int number, int times);
 std::vector<float> repeat(float number, int times);
 
 // only used in  iliInit()
-std::vector<float> getProviderStartStopProbabilities(std::string filename, int numProviders);
+void loadIliData();
+std::vector<int> loadInts(std::string filename);
+std::vector<float> loadFloats(std::string filename);
+std::vector<float> getProviderStartStopProbabilities(const std::vector<float> &vec, int numProviders, RandomStream &rand);
 
 // used on every call to iliView()
-int doesReport(int prevStatus, float restart, float restop);
-std::vector<int> oneStep(std::vector<int> prevStatus, std::vector<float> start, std::vector<float> stop);
-float average(std::vector<float> epi, std::vector<int> status);
+int doesReport(int prevStatus, float restart, float restop, gsl_rng * randGenerator);
+std::vector<int> oneStep(std::vector<int> prevStatus, std::vector<float> start, std::vector<float> stop, gsl_rng * randGenerator);
+float average(std::vector<float> epi, std::vector<int> status, RandomStream &rand);
 
 /*
 example for stand-alone version:
@@ -35,11 +48,16 @@ int main()
     std::vector<float> epi = repeat((float)10., 254);
     std::vector<float> pops = repeat((float)100., 254);
     
+    // random number generators
+    RandomStream rand(0, 0, 0);
+
+    gsl_rng * randGenerator = RandomStream(0, 0, 1).allocGslRng();
+
     // intializing
-    std::vector<Provider> providers = iliInit();
+    std::vector<Provider> providers = iliInit(rand);
     
     // filtering
-    std::vector<float> filtered = iliView(epi, pops, providers);
+    std::vector<float> filtered = iliView(epi, pops, providers, rand, randGenerator);
 
     for(unsigned int i=0; i<filtered.size(); i++)
     {
@@ -76,7 +94,25 @@ std::vector<float> repeat(float number, int times)
     return vec;
 }
 
-std::vector<float> getProviderStartStopProbabilities(std::string filename, int numProviders)
+std::vector<int> loadInts(std::string filename)
+{
+    std::ifstream ifs(filename.c_str());
+
+    std::vector<int> vec;
+
+    int n;
+
+    while(ifs >> n)
+    {
+        vec.push_back(n);
+    }
+
+    ifs.close();
+
+    return vec;
+}
+
+std::vector<float> loadFloats(std::string filename)
 {
     std::ifstream ifs(filename.c_str());
 
@@ -91,6 +127,57 @@ std::vector<float> getProviderStartStopProbabilities(std::string filename, int n
 
     ifs.close();
 
+    return vec;
+}
+
+void loadIliData()
+{
+    boost::mutex::scoped_lock lock(iliDataMutex);
+
+    if(iliDataLoaded == true)
+    {
+        return;
+    }
+
+    // a current input bundle replaces the text files
+    boost::shared_ptr<const InputBundle> bundle = InputBundle::getDataDirectoryBundle();
+
+    if(bundle != NULL && bundle->getValues("ili.numProviders", iliNumProviders) == true && bundle->getValues("ili.startProbabilities", iliProviderStartProbabilities) == true
+        && bundle->getValues("ili.stopProbabilities", iliProviderStopProbabilities) == true && bundle->getValues("ili.noise", iliNoiseVector) == true)
+    {
+        iliDataLoaded = true;
+        return;
+    }
+
+    iliNumProviders = loadInts(g_dataDirectory + "/" + iliNumProvidersFilename);
+
+    iliProviderStartProbabilities = loadFloats(g_dataDirectory + "/" + iliProviderStartProbabilitiesFilename);
+    iliProviderStopProbabilities = loadFloats(g_dataDirectory + "/" + iliProviderStopProbabilitiesFilename);
+
+    // also, ILI noise data
+    iliNoiseVector = loadFloats(g_dataDirectory + "/" + iliNoiseFilename);
+
+    iliDataLoaded = true;
+}
+
+bool addIliData(InputBundle &bundle)
+{
+    if(bundle.addSource(g_dataDirectory, iliNumProvidersFilename) != true || bundle.addSource(g_dataDirectory, iliProviderStartProbabilitiesFilename) != true
+        || bundle.addSource(g_dataDirectory, iliProviderStopProbabilitiesFilename) != true || bundle.addSource(g_dataDirectory, iliNoiseFilename) != true)
+    {
+        return false;
+    }
+
+    bundle.addValues("ili.numProviders", loadInts(g_dataDirectory + "/" + iliNumProvidersFilename));
+    bundle.addValues("ili.startProbabilities", loadFloats(g_dataDirectory + "/" + iliProviderStartProbabilitiesFilename));
+    bundle.addValues("ili.stopProbabilities", loadFloats(g_dataDirectory + "/" + iliProviderStopProbabilitiesFilename));
+    bundle.addValues("ili.noise", loadFloats(g_dataDirectory + "/" + iliNoiseFilename));
+
+    return true;
+}
+
+std::vector<float> getProviderStartStopProbabilities(const std::vector<float> &vec, int numProviders, RandomStream &rand)
+{
     std::vector<float> outVec;
 
     if(numProviders > 0)
@@ -99,7 +186,7 @@ std::vector<float> getProviderStartStopProbabilities(std::string filename, int n
 
         while(counter < numProviders)
         {
-            int selected = iliRand.randInt(vec.size()-1);
+            int selected = rand.randInt(vec.size()-1);
             outVec.push_back(vec[selected]);
             counter++;
         }
@@ -108,10 +195,10 @@ std::vector<float> getProviderStartStopProbabilities(std::string filename, int n
     return outVec;
 }
 
-int doesReport(int prevStatus, float restart, float restop)
+int doesReport(int prevStatus, float restart, float restop, gsl_rng * randGenerator)
 {
-    int numberRestart = (int)gsl_ran_binomial(iliRandGenerator, restart, 1);
-    int numberRestop = (int)gsl_ran_binomial(iliRandGenerator, restop, 1);
+    int numberRestart = (int)gsl_ran_binomial(randGenerator, restart, 1);
+    int numberRestop = (int)gsl_ran_binomial(randGenerator, restop, 1);
 
     int reportStatus;
 
@@ -123,28 +210,28 @@ int doesReport(int prevStatus, float restart, float restop)
     return reportStatus;
 }
 
-std::vector<int> oneStep(std::vector<int> prevStatus, std::vector<float> start, std::vector<float> stop)
+std::vector<int> oneStep(std::vector<int> prevStatus, std::vector<float> start, std::vector<float> stop, gsl_rng * randGenerator)
 {
     std::vector<int> doesRepi;
 
     for(int i=0; i<prevStatus.size(); i++)
     {
-        doesRepi.push_back(doesReport(prevStatus[i], start[i], stop[i]));
+        doesRepi.push_back(doesReport(prevStatus[i], start[i], stop[i], randGenerator));
     }
 
     return(doesRepi);
 }
 
-float average(std::vector<float> epi, std::vector<int> status)
+float average(std::vector<float> epi, std::vector<int> status, RandomStream &rand)
 {
     float sum = 0.;
     float counter = 0.;
 
     for(int i=0; i<epi.size(); i++)
     {
-        int selected = iliRand.randInt(iliNoiseVector.size()-1);
+        int selected = rand.randInt(iliNoiseVector.size()-1);
 
-        float noisei = iliRand.randNorm(0., iliNoiseVector[selected]);
+        float noisei = rand.randNorm(0., iliNoiseVector[selected]);
 
         float reporti = epi[i]+noisei;
 
@@ -158,55 +245,27 @@ float average(std::vector<float> epi, std::vector<int> status)
     return sum / counter;
 }
 
-std::vector<Provider> iliInit()
+std::vector<Provider> iliInit(RandomStream &rand)
 {
-    // setup random number generators
-    gsl_rng_env_setup();
-    iliRandGenerator = gsl_rng_alloc(gsl_rng_default);
-
-    std::ifstream ifs((g_dataDirectory + "/ILI/numCountyProviders.txt").c_str());
-
-    std::vector<int> numProviders;
-
-    int n;
-
-    while(ifs >> n)
-    {
-        numProviders.push_back(n);
-    }
-
-    ifs.close();
+    // load ILI data files (only done once)
+    loadIliData();
 
     std::vector<Provider> providers;
 
-    for(int i=0; i<numProviders.size(); i++)
+    for(int i=0; i<iliNumProviders.size(); i++)
     {
         Provider provider;
-        provider.starts = getProviderStartStopProbabilities(g_dataDirectory + "/ILI/providerStartProbabilities.txt", numProviders[i]);
-        provider.stops = getProviderStartStopProbabilities(g_dataDirectory + "/ILI/providerStopProbabilities.txt", numProviders[i]);
-        provider.status = repeat(1, numProviders[i]);
+        provider.starts = getProviderStartStopProbabilities(iliProviderStartProbabilities, iliNumProviders[i], rand);
+        provider.stops = getProviderStartStopProbabilities(iliProviderStopProbabilities, iliNumProviders[i], rand);
+        provider.status = repeat(1, iliNumProviders[i]);
 
         providers.push_back(provider);
     }
 
-    // also, initialize ILI noise data
-    iliNoiseVector.clear();
-
-    std::ifstream ifs2((g_dataDirectory + "/ILI/providerNoiseData.txt").c_str());
-
-    float n2;
-
-    while(ifs2 >> n2)
-    {
-        iliNoiseVector.push_back(n2);
-    }
-
-    ifs2.close();
-
     return(providers);
 }
 
-std::vector<float> iliView(std::vector<float> epi, std::vector<float> pop, std::vector<Provider> &providers)
+std::vector<float> iliView(std::vector<float> epi, std::vector<float> pop, std::vector<Provider> &providers, RandomStream &rand, gsl_rng * randGenerator)
 {
     std::vector<float> iliViewOut;
 
@@ -215,9 +274,9 @@ std::vector<float> iliView(std::vector<float> epi, std::vector<float> pop, std::
         if(providers[i].status.size() > 0)
         {
             std::vector<float> epii = repeat(epi[i], providers[i].starts.size());
-            std::vector<int> statusi = oneStep(providers[i].status, providers[i].starts, providers[i].stops);
+            std::vector<int> statusi = oneStep(providers[i].status, providers[i].starts, providers[i].stops, randGenerator);
 
-            float repi = average(epii, statusi) / pop[i];
+            float repi = average(epii, statusi, rand) / pop[i];
 
             iliViewOut.push_back(repi);
 
@@ -1,7 +1,11 @@
 #ifndef ILI_VIEW_H
 #define ILI_VIEW_H
 
+#include "../RandomStream.h"
 #include <vector>
+#include <gsl/gsl_rng.h>
+
+class InputBundle;
 
 struct Provider
 {
@@ -10,7 +14,12 @@ struct Provider
     std::vector<int> status;
 };
 
-extern std::vector<Provider> iliInit();
-extern std::vector<float> iliView(std::vector<float> epi, std::vector<float> pop, std::vector<Provider> &providers);
+// the random number generators are owned by the caller, so multiple simulations can run concurrently
+// the ILI data files are only read once per process
+extern std::vector<Provider> iliInit(RandomStream &rand);
+// read the ILI text files and add their data to an input bundle
+extern bool addIliData(InputBundle &bundle);
+
+extern std::vector<float> iliView(std::vector<float> epi, std::vector<float> pop, std::vector<Provider> &providers, RandomStream &rand, gsl_rng * randGenerator);
 
 #endif
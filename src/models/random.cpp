@@ -1,8 +1,8 @@
 #include "random.h"
-#include "MersenneTwister.h"
+#include "RandomStream.h"
 #include <cmath>
 
-double random_exponential(double lambda, MTRand * rand)
+double random_exponential(double lambda, RandomStream * rand)
 {
     return -log(rand->rand()) / lambda;
 }
@@ -1,8 +1,8 @@
 #ifndef RANDOM_H
 #define RANDOM_H
 
-class MTRand;
+class RandomStream;
 
-extern double random_exponential(double lambda, MTRand * rand);
+extern double random_exponential(double lambda, RandomStream * rand);
 
 #endif
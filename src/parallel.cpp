@@ -0,0 +1,211 @@
+#include "parallel.h"
+#include "log.h"
+#include <vector>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/once.hpp>
+
+// work of a parallelFor(), on the stack of its calling thread
+// all members are protected by the pool mutex
+struct ParallelForWork
+{
+    int n;
+    int next;
+    int numCompleted;
+
+    // pool threads working on this, and the most allowed
+    int numHelpers;
+    int maxHelpers;
+
+    boost::function<void (int)> function;
+
+    // signaled when all items are completed and no pool threads are working on this
+    boost::condition_variable done;
+};
+
+// worker threads shared by all parallelFor() calls
+// threads are created as needed and kept waiting for work between calls, so repeated calls (e.g. every time step)
+// don't pay for thread creation. the calling thread of a parallelFor() also works on its items, so nested and
+// concurrent calls (e.g. batch realizations each processing their nodes) always progress
+class ParallelForPool
+{
+    public:
+
+        ParallelForPool();
+
+        // run the items of <work> with this thread and up to work.maxHelpers pool threads, returning when all are completed
+        void run(ParallelForWork &work);
+
+    private:
+
+        boost::mutex mutex_;
+        boost::condition_variable workAvailable_;
+
+        boost::thread_group threads_;
+        int numThreads_;
+
+        // work with items not yet handed out
+        std::vector<ParallelForWork *> works_;
+
+        void worker();
+
+        // work on items of <work> until all are handed out; lock holds mutex_
+        void runItems(ParallelForWork &work, boost::mutex::scoped_lock &lock);
+};
+
+// the pool lives for the lifetime of the process, so waiting threads never see it destroyed
+static ParallelForPool * g_parallelForPool = NULL;
+static boost::once_flag g_parallelForPoolOnce = BOOST_ONCE_INIT;
+
+static void createParallelForPool()
+{
+    g_parallelForPool = new ParallelForPool();
+}
+
+ParallelForPool::ParallelForPool()
+{
+    numThreads_ = 0;
+}
+
+void ParallelForPool::run(ParallelForWork &work)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+
+    while(numThreads_ < work.maxHelpers)
+    {
+        threads_.create_thread(boost::bind(&ParallelForPool::worker, this));
+        numThreads_++;
+    }
+
+    works_.push_back(&work);
+    workAvailable_.notify_all();
+
+    runItems(work, lock);
+
+    while(work.numCompleted < work.n || work.numHelpers > 0)
+    {
+        work.done.wait(lock);
+    }
+}
+
+void ParallelForPool::worker()
+{
+    boost::mutex::scoped_lock lock(mutex_);
+
+    while(true)
+    {
+        ParallelForWork * work = NULL;
+
+        for(unsigned int i=0; i<works_.size(); i++)
+        {
+            if(works_[i]->numHelpers < works_[i]->maxHelpers)
+            {
+                work = works_[i];
+                break;
+            }
+        }
+
+        if(work == NULL)
+        {
+            workAvailable_.wait(lock);
+            continue;
+        }
+
+        work->numHelpers++;
+
+        runItems(*work, lock);
+
+        work->numHelpers--;
+
+        // the calling thread may return once this is signaled, so the work can't be used after
+        if(work->numCompleted == work->n && work->numHelpers == 0)
+        {
+            work->done.notify_all();
+        }
+    }
+}
+
+void ParallelForPool::runItems(ParallelForWork &work, boost::mutex::scoped_lock &lock)
+{
+    while(work.next < work.n)
+    {
+        int i = work.next;
+        work.next++;
+
+        // no more items to hand out
+        if(work.next == work.n)
+        {
+            works_.erase(std::find(works_.begin(), works_.end(), &work));
+        }
+
+        lock.unlock();
+
+        work.function(i);
+
+        lock.lock();
+
+        work.numCompleted++;
+    }
+
+    if(work.numCompleted == work.n && work.numHelpers == 0)
+    {
+        work.done.notify_all();
+    }
+}
+
+int getNumHardwareThreads()
+{
+    int numThreads = (int)boost::thread::hardware_concurrency();
+
+    if(numThreads < 1)
+    {
+        numThreads = 1;
+    }
+
+    return numThreads;
+}
+
+void parallelFor(int n, int numThreads, boost::function<void (int)> function)
+{
+    if(numThreads <= 0)
+    {
+        numThreads = getNumHardwareThreads();
+    }
+
+    // no need for more threads than work items
+    if(numThreads > n)
+    {
+        numThreads = n;
+    }
+
+    put_flog(LOG_DEBUG, "%i items, %i threads", n, numThreads);
+
+    // run serially in this thread if only one thread is needed
+    if(numThreads <= 1)
+    {
+        for(int i=0; i<n; i++)
+        {
+            function(i);
+        }
+
+        return;
+    }
+
+    boost::call_once(g_parallelForPoolOnce, &createParallelForPool);
+
+    ParallelForWork work;
+    work.n = n;
+    work.next = 0;
+    work.numCompleted = 0;
+    work.numHelpers = 0;
+
+    // this thread is one of the threads
+    work.maxHelpers = numThreads - 1;
+
+    work.function = function;
+
+    g_parallelForPool->run(work);
+}
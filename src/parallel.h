@@ -0,0 +1,16 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <boost/function.hpp>
+
+// number of hardware threads available (at least 1)
+extern int getNumHardwareThreads();
+
+// call function(i) for each i in [0, n) using up to numThreads threads: the calling thread and threads of a pool
+// the pool's threads are created on first use and reused by later calls
+// indices are handed out one at a time, so work of uneven length is balanced across threads
+// numThreads <= 0 uses one thread per hardware thread
+// returns after all calls have completed
+extern void parallelFor(int n, int numThreads, boost::function<void (int)> function);
+
+#endif
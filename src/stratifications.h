@@ -0,0 +1,11 @@
+#ifndef STRATIFICATIONS_H
+#define STRATIFICATIONS_H
+
+// must be defined at compile time, and match definition in stratifications file
+// stratifications: [age group][risk group][vaccinated]
+#define NUM_STRATIFICATION_DIMENSIONS 3
+#define STRATIFICATIONS_FILENAME "stratifications.csv"
+
+#define STRATIFICATIONS_ALL -1
+
+#endif